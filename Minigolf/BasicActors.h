@@ -3,6 +3,7 @@
 #include "PhysicsEngine.h"
 #include <iostream>
 #include <iomanip>
+#include <fstream>
 
 namespace PhysicsEngine
 {
@@ -66,6 +67,12 @@ namespace PhysicsEngine
 		//constructor
 		ConvexMesh(const std::vector<PxVec3>& verts, const PxTransform& pose=PxTransform(PxIdentity), PxReal density=1.f)
 			: DynamicActor(pose)
+		{
+			CreateShape(PxConvexMeshGeometry(Cook(verts)), density);
+		}
+
+		///Cook a convex hull of the points, for meshes shared by several shapes
+		static PxConvexMesh* Cook(const std::vector<PxVec3>& verts)
 		{
 			PxConvexMeshDesc mesh_desc;
 			mesh_desc.points.count = (PxU32)verts.size();
@@ -74,11 +81,11 @@ namespace PhysicsEngine
 			mesh_desc.flags = PxConvexFlag::eCOMPUTE_CONVEX;
 			mesh_desc.vertexLimit = 256;
 
-			CreateShape(PxConvexMeshGeometry(CookMesh(mesh_desc)), density);
+			return CookMesh(mesh_desc);
 		}
 
 		//mesh cooking (preparation)
-		PxConvexMesh* CookMesh(const PxConvexMeshDesc& mesh_desc)
+		static PxConvexMesh* CookMesh(const PxConvexMeshDesc& mesh_desc)
 		{
 			PxDefaultMemoryOutputStream stream;
 
@@ -91,38 +98,212 @@ namespace PhysicsEngine
 		}
 	};
 
+	///Cooking settings of a triangle mesh
+	struct TriangleMeshOptions {
+		bool fast_cooking;			// cook quicker at some cost in query speed, for large meshes loaded often
+		PxReal size_tradeoff;		// mid-phase tree: 0 for the smallest mesh, 1 for the fastest queries
+		PxReal weld_tolerance;		// merge vertices closer than this, 0 to keep them all
+		bool clean;					// remove duplicate and degenerate triangles, skip only for clean input
+
+		TriangleMeshOptions() : fast_cooking(false), size_tradeoff(0.55f), weld_tolerance(0.f), clean(true) {}
+	};
+
 	///The TriangleMesh class
 	class TriangleMesh : public StaticActor
 	{
 	public:
-		//constructor
-		TriangleMesh(const std::vector<PxVec3>& verts, const std::vector<PxU32>& trigs, const PxTransform& pose=PxTransform(PxIdentity))
-			: StaticActor(pose)
+		///Descriptor of vertices and indices, three per triangle, kept alive by the caller while cooking
+		template<class Index>
+		static PxTriangleMeshDesc Describe(const std::vector<PxVec3>& verts, const std::vector<Index>& trigs)
 		{
+			if (verts.empty() || (trigs.size() < 3) || (trigs.size() % 3))
+				throw new Exception("TriangleMesh::Describe, the indices do not make whole triangles.");
+
 			PxTriangleMeshDesc mesh_desc;
 			mesh_desc.points.count = (PxU32)verts.size();
 			mesh_desc.points.stride = sizeof(PxVec3);
 			mesh_desc.points.data = &verts.front();
-			mesh_desc.triangles.count = (PxU32)trigs.size();
-			mesh_desc.triangles.stride = 3*sizeof(PxU32);
+			mesh_desc.triangles.count = (PxU32)trigs.size() / 3;
+			mesh_desc.triangles.stride = 3 * sizeof(Index);
 			mesh_desc.triangles.data = &trigs.front();
+			if (sizeof(Index) == sizeof(PxU16))
+				mesh_desc.flags |= PxMeshFlag::e16_BIT_INDICES;
+			return mesh_desc;
+		}
+
+		//constructor, cooks the mesh for this actor only
+		TriangleMesh(const std::vector<PxVec3>& verts, const std::vector<PxU32>& trigs, const PxTransform& pose=PxTransform(PxIdentity),
+			const TriangleMeshOptions& options=TriangleMeshOptions())
+			: StaticActor(pose)
+		{
+			PxTriangleMesh* mesh = Cook(verts, trigs, options);
+			CreateShape(PxTriangleMeshGeometry(mesh));
+			//the shape holds its own reference
+			mesh->release();
+		}
 
-			CreateShape(PxTriangleMeshGeometry(CookMesh(mesh_desc)));
+		//constructor with 16 bit indices
+		TriangleMesh(const std::vector<PxVec3>& verts, const std::vector<PxU16>& trigs, const PxTransform& pose=PxTransform(PxIdentity),
+			const TriangleMeshOptions& options=TriangleMeshOptions())
+			: StaticActor(pose)
+		{
+			PxTriangleMesh* mesh = Cook(verts, trigs, options);
+			CreateShape(PxTriangleMeshGeometry(mesh));
+			//the shape holds its own reference
+			mesh->release();
+		}
+
+		//constructor sharing a mesh cooked once, e.g. by Cook
+		TriangleMesh(PxTriangleMesh* mesh, const PxTransform& pose=PxTransform(PxIdentity), const PxMeshScale& scale=PxMeshScale())
+			: StaticActor(pose)
+		{
+			CreateShape(PxTriangleMeshGeometry(mesh, scale));
+		}
+
+		///Cook a mesh from 32 bit indices, three per triangle
+		static PxTriangleMesh* Cook(const std::vector<PxVec3>& verts, const std::vector<PxU32>& trigs, const TriangleMeshOptions& options=TriangleMeshOptions())
+		{
+			return CookMesh(Describe(verts, trigs), options);
+		}
+
+		///Cook a mesh from 16 bit indices, three per triangle
+		static PxTriangleMesh* Cook(const std::vector<PxVec3>& verts, const std::vector<PxU16>& trigs, const TriangleMeshOptions& options=TriangleMeshOptions())
+		{
+			return CookMesh(Describe(verts, trigs), options);
+		}
+
+		///Cooking parameters with the options applied
+		static PxCookingParams CookingParams(PxCookingParams params, const TriangleMeshOptions& options)
+		{
+			params.meshCookingHint = options.fast_cooking ? PxMeshCookingHint::eCOOKING_PERFORMANCE : PxMeshCookingHint::eSIM_PERFORMANCE;
+			params.meshSizePerformanceTradeOff = options.size_tradeoff;
+			if (options.weld_tolerance > 0.f) {
+				params.meshPreprocessParams |= PxMeshPreprocessingFlag::eWELD_VERTICES;
+				params.meshWeldTolerance = options.weld_tolerance;
+			}
+			if (!options.clean)
+				params.meshPreprocessParams |= PxMeshPreprocessingFlag::eDISABLE_CLEAN_MESH;
+			return params;
 		}
 
 		//mesh cooking (preparation)
-		PxTriangleMesh* CookMesh(const PxTriangleMeshDesc& mesh_desc)
+		static PxTriangleMesh* CookMesh(const PxTriangleMeshDesc& mesh_desc, const TriangleMeshOptions& options=TriangleMeshOptions())
 		{
-			PxDefaultMemoryOutputStream stream;
+			PxCooking* cooking = GetCooking();
+			const PxCookingParams defaults = cooking->getParams();
 
-			if(!GetCooking()->cookTriangleMesh(mesh_desc, stream))
+			//the cooking object is shared, put its settings back afterwards
+			PxDefaultMemoryOutputStream stream;
+			cooking->setParams(CookingParams(defaults, options));
+			const bool cooked = cooking->cookTriangleMesh(mesh_desc, stream);
+			cooking->setParams(defaults);
+			if (!cooked)
 				throw new Exception("TriangleMesh::CookMesh, cooking failed.");
 
 			PxDefaultMemoryInputData input(stream.getData(), stream.getSize());
 
 			return GetPhysics()->createTriangleMesh(input);
 		}
+	};
+
+	///The HeightField class, a static grid of heights with a material per sample
+	class HeightField : public StaticActor
+	{
+		std::vector<PxVec4> material_colors;
+
+	public:
+		//constructor
+		// - heights in metres row by row, rows run along x and columns along z, spacing apart
+		// - materials: index of each sample into the materials given to Materials, empty for the first
+		HeightField(PxU32 rows, PxU32 columns, const std::vector<PxReal>& heights, const std::vector<PxU8>& materials = std::vector<PxU8>(),
+			PxReal spacing = 1.f, const PxTransform& pose = PxTransform(PxIdentity))
+			: StaticActor(pose)
+		{
+			if ((rows < 2) || (columns < 2) || (heights.size() != rows * columns) || (materials.size() && (materials.size() != heights.size())))
+				throw new Exception("HeightField::HeightField, the samples do not match the grid.");
+
+			//heights are stored as 16 bit integers, spread them over the whole range
+			PxReal largest = 0.f;
+			for (PxU32 i = 0; i < heights.size(); i++)
+				largest = PxMax(largest, PxAbs(heights[i]));
+			const PxReal height_scale = PxMax(largest, 0.001f) / 32767.f;
+
+			std::vector<PxHeightFieldSample> samples(heights.size());
+			for (PxU32 i = 0; i < samples.size(); i++) {
+				samples[i].height = (PxI16)PxClamp(heights[i] / height_scale + ((heights[i] < 0.f) ? -0.5f : 0.5f), -32767.f, 32767.f);
+				const PxU8 material = materials.size() ? materials[i] : 0;
+				//seven bits, the top one is the tessellation flag; 127 is PhysX's hole
+				if (material > 127)
+					throw new Exception("HeightField::HeightField, material indices go up to 127.");
+				samples[i].materialIndex0 = PxBitAndByte(material);
+				samples[i].materialIndex1 = PxBitAndByte(material);
+			}
+
+			PxHeightFieldDesc desc;
+			desc.format = PxHeightFieldFormat::eS16_TM;
+			desc.nbRows = rows;
+			desc.nbColumns = columns;
+			desc.samples.data = &samples.front();
+			desc.samples.stride = sizeof(PxHeightFieldSample);
 
+			PxHeightField* field = GetPhysics()->createHeightField(desc);
+			if (!field)
+				throw new Exception("HeightField::HeightField, could not create the heightfield.");
+
+			CreateShape(PxHeightFieldGeometry(field, PxMeshGeometryFlags(), height_scale, spacing, spacing));
+			//the shape holds its own reference
+			field->release();
+		}
+
+		///Materials the samples index, and the colour each is drawn in
+		void Materials(const std::vector<PxMaterial*>& materials, const std::vector<PxVec4>& colors)
+		{
+			if (materials.empty() || (materials.size() > 127))
+				throw new Exception("HeightField::Materials, give between 1 and 127 materials.");
+			GetShape()->setMaterials(&materials.front(), (PxU16)materials.size());
+			material_colors = colors;
+			RenderTable::MaterialColors(render_ids[0]) = &material_colors;
+		}
+
+		///Heights between 0 and 1 from a binary greyscale PGM image (P5, 8 or 16 bit),
+		///image rows become heightfield rows
+		static std::vector<PxReal> LoadHeights(const std::string& file, PxU32& rows, PxU32& columns)
+		{
+			std::ifstream in(file.c_str(), std::ios::binary);
+			if (!in)
+				throw new Exception("HeightField::LoadHeights, could not open " + file + ".");
+
+			//header fields, skipping comments
+			PxU32 fields[3];
+			std::string magic;
+			in >> magic;
+			for (PxU32 i = 0; (i < 3) && in; i++) {
+				in >> std::ws;
+				while (in.peek() == '#') {
+					in.ignore(1 << 16, '\n');
+					in >> std::ws;
+				}
+				in >> fields[i];
+			}
+			in.get();
+			if ((magic != "P5") || !in || (fields[2] == 0) || (fields[2] > 65535))
+				throw new Exception("HeightField::LoadHeights, " + file + " is not a binary PGM image.");
+
+			columns = fields[0];
+			rows = fields[1];
+			const PxU32 bytes = (fields[2] > 255) ? 2 : 1;
+			std::vector<unsigned char> pixels((size_t)rows * columns * bytes);
+			if (pixels.empty() || !in.read((char*)&pixels.front(), pixels.size()))
+				throw new Exception("HeightField::LoadHeights, " + file + " is truncated.");
+
+			std::vector<PxReal> heights((size_t)rows * columns);
+			for (size_t i = 0; i < heights.size(); i++) {
+				//16 bit samples are big endian
+				const PxU32 value = (bytes == 2) ? ((pixels[i * 2] << 8) | pixels[i * 2 + 1]) : pixels[i];
+				heights[i] = (PxReal)value / fields[2];
+			}
+			return heights;
+		}
 	};
 
 	class DistanceJoint : public Joint
@@ -264,23 +445,24 @@ namespace PhysicsEngine
 		}
 	};
 
+	///Two boxes held apart by springs, the parts are owned by the scene
 	class Trampoline {
 		vector<DistanceJoint*> springs;
 		Box *bottom, *top;
 
 	public:
-		Trampoline(PxTransform& pos = PxTransform(PxIdentity), const PxVec3& dimensions = PxVec3(1.0f, 1.0f, 1.0f), PxReal stiffness = 1.0f, PxReal damping = 1.0f, PxReal thickness = 0.1f) {
+		Trampoline(Scene* scene, const PxTransform& pos = PxTransform(PxIdentity), const PxVec3& dimensions = PxVec3(1.0f, 1.0f, 1.0f), PxReal stiffness = 1.0f, PxReal damping = 1.0f, PxReal thickness = 0.1f) {
 
-			bottom = new Box(PxTransform(PxVec3(pos.p.x, pos.p.y, pos.p.z)), PxVec3(dimensions.x, thickness, dimensions.z), 1.0f);
-			top = new Box(PxTransform(PxVec3(pos.p.x, pos.p.y + thickness, pos.p.z)), PxVec3(dimensions.x, thickness, dimensions.z), 0.1f);
+			bottom = scene->Create<Box>(PxTransform(PxVec3(pos.p.x, pos.p.y, pos.p.z)), PxVec3(dimensions.x, thickness, dimensions.z), 1.0f);
+			top = scene->Create<Box>(PxTransform(PxVec3(pos.p.x, pos.p.y + thickness, pos.p.z)), PxVec3(dimensions.x, thickness, dimensions.z), 0.1f);
 			top->Color(PxVec4(82.f / 255.f, 175.f / 255.f, 35.f / 255.f, 1.0f));
 
 			springs.resize(4);
 
-			springs[0] = new DistanceJoint(bottom, PxTransform(PxVec3(dimensions.x, thickness, dimensions.z)), top, PxTransform(PxVec3(dimensions.x, -dimensions.y, dimensions.z)));
-			springs[1] = new DistanceJoint(bottom, PxTransform(PxVec3(dimensions.x, thickness, -dimensions.z)), top, PxTransform(PxVec3(dimensions.x, -dimensions.y, -dimensions.z)));
-			springs[2] = new DistanceJoint(bottom, PxTransform(PxVec3(-dimensions.x, thickness, dimensions.z)), top, PxTransform(PxVec3(-dimensions.x, -dimensions.y, dimensions.z)));
-			springs[3] = new DistanceJoint(bottom, PxTransform(PxVec3(-dimensions.x, thickness, -dimensions.z)), top, PxTransform(PxVec3(-dimensions.x, -dimensions.y, -dimensions.z)));
+			springs[0] = scene->Create<DistanceJoint>(bottom, PxTransform(PxVec3(dimensions.x, thickness, dimensions.z)), top, PxTransform(PxVec3(dimensions.x, -dimensions.y, dimensions.z)));
+			springs[1] = scene->Create<DistanceJoint>(bottom, PxTransform(PxVec3(dimensions.x, thickness, -dimensions.z)), top, PxTransform(PxVec3(dimensions.x, -dimensions.y, -dimensions.z)));
+			springs[2] = scene->Create<DistanceJoint>(bottom, PxTransform(PxVec3(-dimensions.x, thickness, dimensions.z)), top, PxTransform(PxVec3(-dimensions.x, -dimensions.y, dimensions.z)));
+			springs[3] = scene->Create<DistanceJoint>(bottom, PxTransform(PxVec3(-dimensions.x, thickness, -dimensions.z)), top, PxTransform(PxVec3(-dimensions.x, -dimensions.y, -dimensions.z)));
 
 			for (unsigned int i = 0; i < springs.size(); i++) {
 				springs[i]->Stiffness(stiffness);
@@ -292,15 +474,13 @@ namespace PhysicsEngine
 			scene->Add(bottom);
 			scene->Add(top);
 		}
-
-		~Trampoline() {
-			for (unsigned int i = 0; i < springs.size(); i++)
-				delete springs[i];
-		}
 	};
 
 	class Cloth : public Actor {
 		PxClothMeshDesc mesh_desc;
+		PxClothParticle* vertices;
+		PxU32* quads;
+		PxClothFabric* fabric;
 
 	public:
 		//constructor
@@ -309,8 +489,8 @@ namespace PhysicsEngine
 			PxReal w_step = size.x / width;
 			PxReal h_step = size.y / height;
 
-			PxClothParticle* vertices = new PxClothParticle[(width + 1)*(height + 1) * 4];
-			PxU32* quads = new PxU32[width*height * 4];
+			vertices = new PxClothParticle[(width + 1)*(height + 1) * 4];
+			quads = new PxU32[width*height * 4];
 
 			for (PxU32 j = 0; j < (height + 1); j++) {
 				for (PxU32 i = 0; i < (width + 1); i++) {
@@ -349,19 +529,24 @@ namespace PhysicsEngine
 			mesh_desc.quads.stride = sizeof(PxU32) * 4;
 
 			//create cloth fabric (cooking)
-			PxClothFabric* fabric = PxClothFabricCreate(*GetPhysics(), mesh_desc, PxVec3(0, -1, 0));
+			fabric = PxClothFabricCreate(*GetPhysics(), mesh_desc, PxVec3(0, -1, 0));
 
 			//create cloth
 			actor = (PxActor*)GetPhysics()->createCloth(pose, *fabric, vertices, PxClothFlags());
 			//collisions with the scene objects
 			((PxCloth*)actor)->setClothFlag(PxClothFlag::eSCENE_COLLISION, true);
 
-			colors.push_back(default_color);
-			actor->userData = new UserData(&colors.back(), &mesh_desc);
+			render_ids.push_back(RenderTable::Add(default_color, &mesh_desc));
+			actor->userData = RenderTable::ToUserData(render_ids.back());
 		}
 
 		~Cloth() {
-			delete (UserData*)actor->userData;
+			//the fabric can only go once no cloth uses it
+			actor->release();
+			actor = 0;
+			fabric->release();
+			delete[] vertices;
+			delete[] quads;
 		}
 	};
 }
\ No newline at end of file
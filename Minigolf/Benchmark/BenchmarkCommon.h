@@ -0,0 +1,184 @@
+#pragma once
+
+#include "foundation/PxSimpleTypes.h"
+#include <vector>
+#include <string>
+#include <chrono>
+#include <algorithm>
+#include <ostream>
+#include <fstream>
+#include <iomanip>
+#include <cstdio>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>
+#include <direct.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Benchmark
+{
+	using namespace std;
+	using namespace physx;
+
+	typedef chrono::high_resolution_clock Clock;
+
+	///Microseconds elapsed since start
+	inline double MicrosecondsSince(const Clock::time_point& start) {
+		return chrono::duration<double, micro>(Clock::now() - start).count();
+	}
+
+	///Create a directory if it does not exist yet, its parent has to exist
+	inline void MakeDirectory(const string& path) {
+#ifdef _WIN32
+		_mkdir(path.c_str());
+#else
+		mkdir(path.c_str(), 0755);
+#endif
+	}
+
+	///Summary of a list of samples
+	struct Percentiles {
+		double mean, p50, p90, p99, max;
+
+		///Sorts the samples in place
+		static Percentiles From(vector<double>& samples) {
+			Percentiles p = { 0.0, 0.0, 0.0, 0.0, 0.0 };
+			if (samples.empty())
+				return p;
+			sort(samples.begin(), samples.end());
+			double sum = 0.0;
+			for (size_t i = 0; i < samples.size(); i++)
+				sum += samples[i];
+			p.mean = sum / samples.size();
+			p.p50 = samples[(size_t)(.50 * (samples.size() - 1) + .5)];
+			p.p90 = samples[(size_t)(.90 * (samples.size() - 1) + .5)];
+			p.p99 = samples[(size_t)(.99 * (samples.size() - 1) + .5)];
+			p.max = samples.back();
+			return p;
+		}
+	};
+
+	///Peak resident memory of the whole process in bytes
+	inline PxU64 PeakProcessMemory() {
+#ifdef _WIN32
+		PROCESS_MEMORY_COUNTERS counters;
+		if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+			return counters.PeakWorkingSetSize;
+		return 0;
+#else
+		rusage usage;
+		getrusage(RUSAGE_SELF, &usage);
+		return (PxU64)usage.ru_maxrss * 1024;
+#endif
+	}
+
+	///Current resident memory of the whole process in bytes
+	inline PxU64 ProcessMemory() {
+#ifdef _WIN32
+		PROCESS_MEMORY_COUNTERS counters;
+		if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+			return counters.WorkingSetSize;
+		return 0;
+#else
+		ifstream statm("/proc/self/statm");
+		PxU64 pages = 0, resident = 0;
+		statm >> pages >> resident;
+		return resident * (PxU64)sysconf(_SC_PAGESIZE);
+#endif
+	}
+
+	///Minimal streaming JSON writer
+	class JsonWriter {
+		ostream& out;
+		vector<bool> first;
+
+		void Separator(const char* key) {
+			if (!first.empty()) {
+				if (!first.back())
+					out << ",";
+				first.back() = false;
+				out << "\n" << string(first.size() * 2, ' ');
+			}
+			if (key)
+				out << "\"" << key << "\": ";
+		}
+
+		void Open(const char* key, char bracket) {
+			Separator(key);
+			out << bracket;
+			first.push_back(true);
+		}
+
+		void Close(char bracket) {
+			bool empty = first.back();
+			first.pop_back();
+			if (!empty)
+				out << "\n" << string(first.size() * 2, ' ');
+			out << bracket;
+			if (first.empty())
+				out << "\n";
+		}
+
+	public:
+		JsonWriter(ostream& _out) : out(_out) {
+			out << setprecision(6);
+		}
+
+		void BeginObject(const char* key = 0) { Open(key, '{'); }
+
+		void EndObject() { Close('}'); }
+
+		void BeginArray(const char* key = 0) { Open(key, '['); }
+
+		void EndArray() { Close(']'); }
+
+		void Value(const char* key, double value) { Separator(key); out << value; }
+
+		void Value(const char* key, PxU64 value) { Separator(key); out << value; }
+
+		void Value(const char* key, PxU32 value) { Separator(key); out << value; }
+
+		void Value(const char* key, bool value) { Separator(key); out << (value ? "true" : "false"); }
+
+		void Value(const char* key, const string& value) {
+			Separator(key);
+			out << "\"";
+			for (size_t i = 0; i < value.size(); i++) {
+				const unsigned char c = (unsigned char)value[i];
+				if ((c == '"') || (c == '\\'))
+					out << '\\' << (char)c;
+				else if (c == '\n')
+					out << "\\n";
+				else if (c == '\t')
+					out << "\\t";
+				else if (c < 0x20) {
+					char escaped[8];
+					snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+					out << escaped;
+				}
+				else
+					out << (char)c;
+			}
+			out << "\"";
+		}
+
+		void Value(const char* key, const Percentiles& value) {
+			BeginObject(key);
+			Value("mean", value.mean);
+			Value("p50", value.p50);
+			Value("p90", value.p90);
+			Value("p99", value.p99);
+			Value("max", value.max);
+			EndObject();
+		}
+	};
+}
@@ -0,0 +1,136 @@
+#include "ImportBenchmark.h"
+#include "BenchmarkCommon.h"
+#include "..\MeshImporter.h"
+#include <fstream>
+#include <random>
+#include <thread>
+#include <iostream>
+
+namespace Benchmark
+{
+	using namespace PhysicsEngine;
+
+	///Lumpy sphere as a binary PLY, about the given number of triangles
+	static void WriteRock(const string& file, PxU32 triangles, std::mt19937& random) {
+		const PxU32 stacks = PxMax((PxU32)PxSqrt(triangles / 4.0f), 3u);
+		const PxU32 slices = stacks * 2;
+		std::uniform_real_distribution<PxReal> bump(0.8f, 1.2f);
+
+		vector<PxVec3> vertices;
+		for (PxU32 i = 0; i <= stacks; i++) {
+			const PxReal theta = PxPi * i / stacks;
+			for (PxU32 j = 0; j < slices; j++) {
+				const PxReal phi = PxTwoPi * j / slices;
+				const PxReal r = ((i == 0) || (i == stacks)) ? 1.0f : bump(random);
+				vertices.push_back(PxVec3(PxSin(theta) * PxCos(phi), PxCos(theta), PxSin(theta) * PxSin(phi)) * r);
+			}
+		}
+
+		vector<PxI32> faces;
+		for (PxU32 i = 0; i < stacks; i++) {
+			for (PxU32 j = 0; j < slices; j++) {
+				const PxI32 a = i * slices + j, b = i * slices + (j + 1) % slices;
+				const PxI32 c = a + slices, d = b + slices;
+				const PxI32 quad[] = { a, b, c, b, d, c };
+				faces.insert(faces.end(), quad, quad + 6);
+			}
+		}
+
+		ofstream out(file.c_str(), ios::binary);
+		out << "ply\nformat binary_little_endian 1.0\nelement vertex " << vertices.size()
+			<< "\nproperty float x\nproperty float y\nproperty float z\nelement face " << faces.size() / 3
+			<< "\nproperty list uchar int vertex_indices\nend_header\n";
+		out.write((const char*)&vertices.front(), vertices.size() * sizeof(PxVec3));
+		for (size_t i = 0; i < faces.size(); i += 3) {
+			const unsigned char count = 3;
+			out.write((const char*)&count, 1);
+			out.write((const char*)&faces[i], 3 * sizeof(PxI32));
+		}
+	}
+
+	///Point cloud in a random box as an OBJ, cooked into its convex hull
+	static void WriteBoulder(const string& file, std::mt19937& random) {
+		std::uniform_real_distribution<PxReal> unit(-1.0f, 1.0f);
+		const PxVec3 size(1.0f + unit(random) * 0.5f, 1.0f + unit(random) * 0.5f, 1.0f + unit(random) * 0.5f);
+		ofstream out(file.c_str());
+		for (PxU32 i = 0; i < 500; i++)
+			out << "v " << unit(random) * size.x << " " << unit(random) * size.y << " " << unit(random) * size.z << "\n";
+	}
+
+	static void ReleaseMeshes(vector<ImportedMesh>& meshes) {
+		for (size_t i = 0; i < meshes.size(); i++) {
+			if (meshes[i].convex)
+				meshes[i].convex->release();
+			if (meshes[i].triangles)
+				meshes[i].triangles->release();
+		}
+		meshes.clear();
+	}
+
+	static void RunImport(const vector<MeshRequest>& requests, PxU32 threads, const string& cache, const char* mode, JsonWriter& json) {
+		ImportDesc import_desc;
+		import_desc.threads = threads;
+		import_desc.cache = cache;
+		MeshImporter importer(import_desc);
+
+		Clock::time_point start = Clock::now();
+		vector<ImportedMesh> meshes = importer.Import(requests);
+		const double import_us = MicrosecondsSince(start);
+		ReleaseMeshes(meshes);
+
+		json.BeginObject();
+		json.Value("threads", threads);
+		json.Value("cache", string(mode));
+		json.Value("import_ms", import_us / 1000.0);
+		json.Value("cooked", importer.Cooked());
+		json.Value("cache_hits", importer.CacheHits());
+		json.EndObject();
+	}
+
+	void RunImportBenchmark(const ImportBenchDesc& desc) {
+		MakeDirectory(desc.directory);
+		std::mt19937 random(desc.seed);
+		vector<MeshRequest> requests;
+		for (PxU32 i = 0; i < desc.assets; i++) {
+			const string name = desc.directory + "/asset" + to_string(i);
+			if (i % 2) {
+				WriteBoulder(name + ".obj", random);
+				requests.push_back(MeshRequest(name + ".obj", MESH_CONVEX));
+			}
+			else {
+				WriteRock(name + ".ply", desc.triangles, random);
+				requests.push_back(MeshRequest(name + ".ply", MESH_TRIANGLES));
+			}
+		}
+
+		const PxU32 most_threads = desc.threads ? desc.threads : PxMax(std::thread::hardware_concurrency(), 1u);
+		vector<PxU32> thread_counts;
+		for (PxU32 t = 1; t < most_threads; t *= 2)
+			thread_counts.push_back(t);
+		thread_counts.push_back(most_threads);
+
+		ofstream file;
+		if (desc.output.size())
+			file.open(desc.output.c_str());
+		JsonWriter json(desc.output.size() ? file : cout);
+
+		json.BeginObject();
+		json.Value("benchmark", string("import"));
+		json.Value("assets", desc.assets);
+		json.Value("triangles", desc.triangles);
+		json.Value("seed", desc.seed);
+		json.BeginArray("runs");
+		const string stamp = to_string(chrono::system_clock::now().time_since_epoch().count());
+		for (size_t i = 0; i < thread_counts.size(); i++) {
+			const PxU32 threads = thread_counts[i];
+			//a new cache per thread count and run, so that the cold pass finds it empty
+			const string cache = desc.directory + "/cache_" + to_string(threads) + "_" + stamp;
+			cerr << "importing with " << threads << " threads" << endl;
+			RunImport(requests, threads, "", "off", json);
+			RunImport(requests, threads, cache, "cold", json);
+			RunImport(requests, threads, cache, "warm", json);
+		}
+		json.EndArray();
+		json.EndObject();
+	}
+}
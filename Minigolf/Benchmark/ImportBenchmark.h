@@ -0,0 +1,27 @@
+#pragma once
+
+#include "foundation/PxSimpleTypes.h"
+#include <string>
+
+namespace Benchmark
+{
+	using namespace std;
+	using namespace physx;
+
+	///Import benchmark settings
+	struct ImportBenchDesc {
+		string directory;		// generated assets and caches, created if missing
+		string output;			// JSON file, empty for stdout
+		PxU32 assets;			// files per course, half convex hulls and half triangle meshes
+		PxU32 triangles;		// per triangle mesh asset, roughly
+		PxU32 threads;			// most cooking threads tried, 0 for one per core
+		PxU32 seed;
+
+		ImportBenchDesc() : directory("import_bench"), assets(200), triangles(20000), threads(0), seed(1) {}
+	};
+
+	///Generate a course worth of OBJ and PLY assets, import it with 1, 2, 4... threads
+	///without a cache, into an empty cache and from the filled cache, and write a JSON
+	///report; PhysX has to be initialised already
+	void RunImportBenchmark(const ImportBenchDesc& desc);
+}
@@ -0,0 +1,269 @@
+#include "PhysicsBenchmark.h"
+#include "BenchmarkCommon.h"
+#include "..\CourseGenerator.h"
+#include <fstream>
+#include <iostream>
+
+namespace Benchmark
+{
+	using namespace PhysicsEngine;
+
+	///Free spheres dropped onto the ground in a grid
+	class SpheresScene : public MyScene {
+		PxU32 count;
+
+	public:
+		SpheresScene(PxU32 _count) : count(_count) {}
+
+		virtual void CreateScene() {
+			AddGround();
+			PxMaterial* material = SharedMaterial(0.0f, 0.0f, 0.8f);
+			PxU32 side = (PxU32)PxCeil(PxSqrt((PxReal)count));
+			for (PxU32 i = 0; i < count; i++) {
+				Sphere* sphere = Create<Sphere>(PxTransform(PxVec3((i % side) * 4.0f, 50.0f, (i / side) * 4.0f)));
+				sphere->GetShape(0)->setMaterials(&material, 1);
+				Add(sphere);
+			}
+		}
+	};
+
+	///Copies of every jointed obstacle of the stock course
+	class JointsScene : public MyScene {
+		PxU32 copies;
+
+	public:
+		JointsScene(PxU32 _copies) : copies(_copies) {}
+
+		virtual void CreateScene() {
+			AddGround();
+			AddBall(PxVec3(-12.0f, 1.7f, 0.0f));
+			Add(Create<PathStart>(PxTransform(PxVec3(-12.0f, 1.0f, 0.0f))));
+
+			const PxQuat rot(1.5708f, PxVec3(0, 1, 0));
+			for (PxU32 i = 0; i < copies; i++) {
+				const PxReal x = i * 12.0f;
+
+				//D6 slider
+				Add(Create<PathStraight>(PxTransform(PxVec3(x, 1.0f, 0.0f))));
+				AddSlider(PxVec3(x, 1.0f, 0.0f));
+
+				//fixed and D6 doors
+				Add(Create<PathStraight>(PxTransform(PxVec3(x, 1.0f, -8.0f))));
+				AddDoors(PxVec3(x, 1.0f, -8.0f));
+
+				//revolute windmills
+				Add(Create<PathWindMill>(PxTransform(PxVec3(x, 1.0f, -16.0f))));
+				AddTallWindmill(PxVec3(x, 1.0f, -16.0f));
+				Add(Create<PathStraight>(PxTransform(PxVec3(x, 1.0f, -24.0f), rot)));
+				AddFlatWindmill(PxVec3(x, 1.0f, -24.0f));
+
+				//spherical dangles
+				Add(Create<PathStraight>(PxTransform(PxVec3(x, 1.0f, -32.0f), rot)));
+				AddDangles(PxVec3(x, 1.0f, -32.0f));
+			}
+		}
+	};
+
+	///Flags on poles blowing in the wind
+	class ClothScene : public MyScene {
+		PxU32 flags;
+		PxU32 size;
+
+	public:
+		ClothScene(PxU32 _flags, PxU32 _size) : flags(_flags), size(_size) {}
+
+		virtual void CreateScene() {
+			AddGround();
+			for (PxU32 i = 0; i < flags; i++) {
+				const PxVec3 pos(i * 4.0f, 0.0f, 0.0f);
+				Capsule* pole = Create<Capsule>(PxTransform(pos + PxVec3(0.0f, 3.0f, 0.0f), PxQuat(1.5708f, PxVec3(0, 0, 1))), PxVec2(0.05f, 3.0f));
+				pole->SetKinematic(true);
+				Add(pole);
+
+				Cloth* flag = Create<Cloth>(PxTransform(pos + PxVec3(0.0f, 5.5f, 0.0f), PxQuat(1.5708f, PxVec3(0, 0, 1))), PxVec2(1.5f, 1.5f), size, size);
+				((PxCloth*)flag->Get())->setExternalAcceleration(PxVec3(-10.0f, 3.0f, 5.0f));
+				Add(flag);
+			}
+		}
+	};
+
+	vector<string> PhysicsScenarios() {
+		vector<string> names;
+		names.push_back("course");
+		names.push_back("spheres");
+		names.push_back("joints");
+		names.push_back("cloth");
+		names.push_back("generated");
+		return names;
+	}
+
+	static MyScene* CreateScenario(const string& name, const PhysicsBenchDesc& desc) {
+		if (name == "course")
+			return new MyScene();
+		if (name == "spheres")
+			return new SpheresScene(desc.spheres);
+		if (name == "joints")
+			return new JointsScene(desc.copies);
+		if (name == "cloth")
+			return new ClothScene(desc.flags, desc.cloth_size);
+		if (name == "generated")
+			return new GeneratedScene(desc.tiles, desc.seed);
+		throw new Exception("Benchmark::CreateScenario, unknown scenario " + name + ".");
+	}
+
+	static void RunScenario(const string& name, const PhysicsBenchDesc& desc, JsonWriter& json) {
+		ResetMemoryPeak();
+		MemoryStats before = GetMemoryStats();
+
+		Clock::time_point start = Clock::now();
+		MyScene* scene = CreateScenario(name, desc);
+		scene->Init();
+		scene->Visualise(desc.visualise);
+		double setup_us = MicrosecondsSince(start);
+
+		PxScene* px_scene = scene->Get();
+		PxU32 actors = px_scene->getNbActors(PxActorTypeSelectionFlag::eRIGID_DYNAMIC | PxActorTypeSelectionFlag::eRIGID_STATIC |
+			PxActorTypeSelectionFlag::eCLOTH);
+		PxU32 dynamics = px_scene->getNbActors(PxActorTypeSelectionFlag::eRIGID_DYNAMIC);
+		PxU32 constraints = px_scene->getNbConstraints();
+
+		//same opening shot every run so that the ball takes the same path
+		if ((name != "spheres") && (name != "cloth"))
+			scene->Shoot(PxVec3(0.0f, 0.0f, -1.0f), 30.0f);
+
+		for (PxU32 i = 0; i < desc.warmup; i++)
+			scene->Update(desc.delta_time);
+
+		MemoryStats measured = GetMemoryStats();
+
+		vector<double> step_us;
+		step_us.reserve(desc.steps);
+		for (PxU32 i = 0; i < desc.steps; i++) {
+			Clock::time_point step_start = Clock::now();
+			scene->Update(desc.delta_time);
+			step_us.push_back(MicrosecondsSince(step_start));
+		}
+
+		MemoryStats after = GetMemoryStats();
+		vector<AllocationStats> by_name = GetAllocationStats();
+
+		Clock::time_point teardown_start = Clock::now();
+		delete scene;
+		double teardown_us = MicrosecondsSince(teardown_start);
+
+		MemoryStats released = GetMemoryStats();
+
+		json.BeginObject();
+		json.Value("name", name);
+		json.Value("actors", actors);
+		json.Value("dynamic_actors", dynamics);
+		json.Value("constraints", constraints);
+		json.Value("warmup", desc.warmup);
+		json.Value("steps", desc.steps);
+		json.Value("setup_ms", setup_us / 1000.0);
+		json.Value("teardown_ms", teardown_us / 1000.0);
+		json.Value("step_us", Percentiles::From(step_us));
+		json.Value("allocations_setup", measured.allocations - before.allocations);
+		json.Value("allocations_measured", after.allocations - measured.allocations);
+		json.Value("allocations_per_step", desc.steps ? (double)(after.allocations - measured.allocations) / desc.steps : 0.0);
+		json.Value("physx_live_bytes", after.live_bytes);
+		json.Value("physx_peak_bytes", after.peak_bytes);
+		json.Value("physx_unreleased_bytes", released.live_bytes - PxMin(released.live_bytes, before.live_bytes));
+		json.Value("physx_arena_bytes", after.arena_bytes);
+		json.Value("physx_arenas_after_teardown", released.arenas);
+		json.BeginArray("physx_by_name");
+		for (size_t i = 0; (i < by_name.size()) && (i < 10); i++) {
+			json.BeginObject();
+			json.Value("name", by_name[i].name);
+			json.Value("allocations", by_name[i].allocations);
+			json.Value("peak_bytes", by_name[i].peak_bytes);
+			json.Value("live_count", by_name[i].live_count);
+			json.EndObject();
+		}
+		json.EndArray();
+		json.Value("process_peak_bytes", PeakProcessMemory());
+		json.EndObject();
+	}
+
+	///Reset the stock course over and over, memory has to stay flat
+	static void RunSoak(const PhysicsBenchDesc& desc, JsonWriter& json) {
+		const PxU32 sample_every = 1000;
+
+		MyScene* scene = new MyScene();
+		scene->Init();
+		PxU32 actors = scene->Get()->getNbActors(PxActorTypeSelectionFlag::eRIGID_DYNAMIC | PxActorTypeSelectionFlag::eRIGID_STATIC |
+			PxActorTypeSelectionFlag::eCLOTH);
+
+		//the first reset fills the pools, measure growth from there
+		scene->Reset();
+		MemoryStats first = GetMemoryStats();
+		PxU64 first_process = ProcessMemory();
+
+		vector<double> reset_us;
+		reset_us.reserve(desc.resets);
+		json.BeginObject();
+		json.Value("name", string("soak"));
+		json.Value("actors", actors);
+		json.Value("resets", desc.resets);
+		json.BeginArray("samples");
+		for (PxU32 i = 1; i <= desc.resets; i++) {
+			Clock::time_point start = Clock::now();
+			scene->Reset();
+			reset_us.push_back(MicrosecondsSince(start));
+
+			if ((i % sample_every == 0) || (i == desc.resets)) {
+				MemoryStats stats = GetMemoryStats();
+				json.BeginObject();
+				json.Value("resets", i);
+				json.Value("physx_live_bytes", stats.live_bytes);
+				json.Value("physx_live_allocations", stats.allocations - stats.deallocations);
+				json.Value("process_bytes", ProcessMemory());
+				json.EndObject();
+				cerr << "soak " << i << "/" << desc.resets << endl;
+			}
+		}
+		json.EndArray();
+
+		MemoryStats last = GetMemoryStats();
+		PxU64 last_process = ProcessMemory();
+		delete scene;
+		MemoryStats released = GetMemoryStats();
+
+		json.Value("reset_us", Percentiles::From(reset_us));
+		json.Value("physx_live_growth_bytes", (double)last.live_bytes - (double)first.live_bytes);
+		json.Value("process_growth_bytes", (double)last_process - (double)first_process);
+		json.Value("physx_arenas_after_teardown", released.arenas);
+		json.Value("process_peak_bytes", PeakProcessMemory());
+		json.EndObject();
+	}
+
+	void RunPhysicsBenchmark(const PhysicsBenchDesc& desc) {
+		vector<string> scenarios;
+		if (desc.scenario == "all")
+			scenarios = PhysicsScenarios();
+		else
+			scenarios.push_back(desc.scenario);
+
+		ofstream file;
+		if (desc.output.size())
+			file.open(desc.output.c_str());
+		JsonWriter json(desc.output.size() ? file : cout);
+
+		json.BeginObject();
+		json.Value("benchmark", string("physics"));
+		json.Value("delta_time", (double)desc.delta_time);
+		json.Value("seed", desc.seed);
+		json.Value("arena", ArenaMode());
+		json.Value("visualise", desc.visualise);
+		json.BeginArray("scenarios");
+		for (PxU32 i = 0; i < scenarios.size(); i++) {
+			cerr << "running " << scenarios[i] << endl;
+			if (scenarios[i] == "soak")
+				RunSoak(desc, json);
+			else
+				RunScenario(scenarios[i], desc, json);
+		}
+		json.EndArray();
+		json.EndObject();
+	}
+}
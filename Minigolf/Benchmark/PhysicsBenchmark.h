@@ -0,0 +1,38 @@
+#pragma once
+
+#include "foundation/PxSimpleTypes.h"
+#include <string>
+#include <vector>
+
+namespace Benchmark
+{
+	using namespace std;
+	using namespace physx;
+
+	///Physics benchmark settings
+	struct PhysicsBenchDesc {
+		string scenario;		// scenario name or "all"
+		string output;			// JSON file, empty for stdout
+		PxU32 warmup;			// steps before measuring
+		PxU32 steps;			// measured steps
+		PxU32 spheres;			// "spheres": number of free spheres
+		PxU32 copies;			// "joints": copies of the obstacle set
+		PxU32 flags;			// "cloth": number of flags
+		PxU32 cloth_size;		// "cloth": quads along each side of a flag
+		PxU32 tiles;			// "generated": number of path pieces
+		PxU32 seed;				// "generated": layout seed
+		PxU32 resets;			// "soak": number of course resets
+		bool visualise;			// fill the debug render buffer every step
+		PxReal delta_time;
+
+		PhysicsBenchDesc() : scenario("all"), warmup(60), steps(600), spheres(500), copies(8), flags(8),
+			cloth_size(20), tiles(200), seed(1), resets(10000), visualise(false), delta_time(1.f / 60.f) {}
+	};
+
+	///Names of the scenarios run by "all", "soak" is run on its own
+	vector<string> PhysicsScenarios();
+
+	///Run the scenarios headless and write a JSON report,
+	///PhysX has to be initialised already
+	void RunPhysicsBenchmark(const PhysicsBenchDesc& desc);
+}
@@ -0,0 +1,228 @@
+#include "RenderBenchmark.h"
+#include "BenchmarkCommon.h"
+#include "..\CourseGenerator.h"
+#include "..\CameraPath.h"
+#include "..\Extras\Renderer.h"
+#include "..\Extras\HUD.h"
+#include <fstream>
+#include <iostream>
+
+namespace Benchmark
+{
+	using namespace PhysicsEngine;
+	using namespace VisualDebugger;
+
+	///A render mode of the visual debugger, shadows and culling are measured separately
+	struct RenderPass {
+		const char* mode;
+		bool normal;
+		bool debug;
+		bool shadows;
+		bool culling;
+	};
+
+	static const RenderPass passes[] = {
+		{ "NORMAL", true, false, true, true },
+		{ "NORMAL", true, false, true, false },
+		{ "NORMAL", true, false, false, true },
+		{ "DEBUG", false, true, false, true },
+		{ "BOTH", true, true, true, true },
+	};
+
+	static MyScene* CreateCourse(const string& name, const RenderBenchDesc& desc) {
+		if (name == "course")
+			return new MyScene();
+		if (name == "generated")
+			return new GeneratedScene(desc.tiles, desc.seed);
+		if (name == "green")
+			return new GeneratedGreen(desc.green_size, desc.seed);
+		throw new Exception("Benchmark::CreateCourse, unknown course " + name + ".");
+	}
+
+	///Bounds of the static actors apart from the infinite ground plane
+	static PxBounds3 CourseBounds(PxScene* scene) {
+		PxBounds3 bounds = PxBounds3::empty();
+		vector<PxActor*> actors(scene->getNbActors(PxActorTypeSelectionFlag::eRIGID_STATIC));
+		if (actors.size())
+			scene->getActors(PxActorTypeSelectionFlag::eRIGID_STATIC, &actors.front(), (PxU32)actors.size());
+		for (size_t i = 0; i < actors.size(); i++) {
+			PxRigidActor* actor = (PxRigidActor*)actors[i];
+			PxShape* shape;
+			actor->getShapes(&shape, 1);
+			if (shape->getGeometryType() != PxGeometryType::ePLANE)
+				bounds.include(actor->getWorldBounds());
+		}
+		return bounds;
+	}
+
+	///Same text load as the in-game help screen
+	static void AddHelpText(HUD& hud) {
+		hud.AddLine(0, "Simulation");
+		hud.AddLine(0, "   F10 - pause");
+		hud.AddLine(0, "Gameplay");
+		hud.AddLine(0, "Right click to move camera");
+		hud.AddLine(0, "Hold space to increase strength");
+		hud.AddLine(0, "    Release to shoot");
+		hud.AddLine(0, "");
+		hud.AddLine(0, "Display");
+		hud.AddLine(0, "   F5 - Help on/off");
+		hud.AddLine(0, "   F6 - Shadows on/off");
+		hud.AddLine(0, "   F7 - Render mode");
+		hud.AddLine(0, "   F8 - Free cam on/off");
+		hud.AddLine(0, "   F4 - Profiler on/off");
+		hud.AddLine(0, "   1-4 - Debug shapes/axes/joints/cloth");
+		hud.AddLine(0, "");
+		hud.AddLine(0, "Shot Increment Power: 0.400000");
+		hud.AddLine(0, "Shots taken: 0");
+		hud.AddLine(0, "Shot Power: 0");
+		hud.FontSize(0.015f);
+		hud.Color(PxVec3(0.f, 0.f, 0.f));
+		hud.ActiveScreen(0);
+	}
+
+	static void RunPass(const string& course, const RenderPass& pass, const RenderBenchDesc& desc, JsonWriter& json) {
+		Clock::time_point init_start = Clock::now();
+		MyScene* scene = CreateCourse(course, desc);
+		scene->Init();
+		double init_us = MicrosecondsSince(init_start);
+
+		Clock::time_point build_start = Clock::now();
+		{
+			vector<PxActor*> actors = scene->GetAllActors();
+			if (actors.size())
+				Renderer::BuildStatic(&actors[0], (PxU32)actors.size());
+		}
+		double build_us = MicrosecondsSince(build_start);
+
+		CameraPath path;
+		if (desc.camera_path.size())
+			path = CameraPath::Load(desc.camera_path);
+		else
+			path = CameraPath::Flyover(CourseBounds(scene->Get()), desc.frames * desc.delta_time);
+
+		HUD hud;
+		AddHelpText(hud);
+		Renderer::ShowShadows(pass.shadows);
+		//the debug buffer is only generated when it is drawn, as in the game
+		scene->Visualise(pass.debug);
+		const bool culling = Renderer::Culling();
+		Renderer::Culling(culling && pass.culling);
+
+		//same opening shot as the physics benchmark so that something moves
+		scene->Shoot(PxVec3(0.0f, 0.0f, -1.0f), 30.0f);
+
+		vector<double> frame_us, actors_us, debug_us, text_us, step_us;
+		frame_us.reserve(desc.frames);
+		double draw_calls = 0.0, vertices = 0.0, shadow_draw_calls = 0.0, shadow_vertices = 0.0;
+		double culled_shapes = 0.0, drawn_shapes = 0.0;
+
+		for (PxU32 i = 0; i < desc.frames; i++) {
+			PxVec3 eye, dir;
+			path.Sample(i * desc.delta_time, eye, dir);
+
+			Renderer::ResetStats();
+			Clock::time_point frame_start = Clock::now();
+			Renderer::Start(eye, dir);
+
+			Clock::time_point start = Clock::now();
+			if (pass.debug) {
+				Renderer::Render(scene->Get()->getRenderBuffer());
+				debug_us.push_back(MicrosecondsSince(start));
+				scene->VisualisationBox(PxBounds3::centerExtents(eye, PxVec3(desc.visualisation_extent)));
+			}
+
+			start = Clock::now();
+			if (pass.normal) {
+				vector<PxActor*> actors = scene->GetAllActors();
+				if (actors.size())
+					Renderer::Render(&actors[0], (PxU32)actors.size());
+				actors_us.push_back(MicrosecondsSince(start));
+			}
+
+			start = Clock::now();
+			hud.Render();
+			text_us.push_back(MicrosecondsSince(start));
+
+			Renderer::Finish();
+			frame_us.push_back(MicrosecondsSince(frame_start));
+
+			const Renderer::RenderStats& stats = Renderer::Stats();
+			draw_calls += stats.draw_calls;
+			vertices += stats.vertices;
+			shadow_draw_calls += stats.shadow_draw_calls;
+			shadow_vertices += stats.shadow_vertices;
+			culled_shapes += stats.culled_shapes;
+			drawn_shapes += stats.drawn_shapes;
+
+			//outside the frame time, keeps the dynamics and the debug buffer changing
+			start = Clock::now();
+			scene->Update(desc.delta_time);
+			step_us.push_back(MicrosecondsSince(start));
+		}
+
+		Renderer::Culling(culling);
+		Renderer::ReleaseStatic();
+		delete scene;
+
+		const double frames = PxMax(desc.frames, 1u);
+		json.BeginObject();
+		json.Value("mode", string(pass.mode));
+		json.Value("shadows", pass.shadows);
+		json.Value("culling", culling && pass.culling);
+		json.Value("frames", desc.frames);
+		json.Value("scene_init_ms", init_us / 1000.0);
+		json.Value("static_build_ms", build_us / 1000.0);
+		json.Value("frame_us", Percentiles::From(frame_us));
+		json.Value("actors_us", Percentiles::From(actors_us));
+		json.Value("debug_us", Percentiles::From(debug_us));
+		json.Value("text_us", Percentiles::From(text_us));
+		json.Value("step_us", Percentiles::From(step_us));
+		json.Value("draw_calls_per_frame", draw_calls / frames);
+		json.Value("vertices_per_frame", vertices / frames);
+		json.Value("shadow_draw_calls_per_frame", shadow_draw_calls / frames);
+		json.Value("shadow_vertices_per_frame", shadow_vertices / frames);
+		json.Value("culled_shapes_per_frame", culled_shapes / frames);
+		json.Value("drawn_shapes_per_frame", drawn_shapes / frames);
+		json.EndObject();
+	}
+
+	void RunRenderBenchmark(const RenderBenchDesc& desc) {
+		vector<string> courses;
+		if (desc.course == "all") {
+			courses.push_back("course");
+			courses.push_back("generated");
+			courses.push_back("green");
+		}
+		else
+			courses.push_back(desc.course);
+
+		ofstream file;
+		if (desc.output.size())
+			file.open(desc.output.c_str());
+		JsonWriter json(desc.output.size() ? file : cout);
+
+		json.BeginObject();
+		json.Value("benchmark", string("render"));
+		json.Value("width", desc.width);
+		json.Value("height", desc.height);
+		json.Value("retained_static", Renderer::RetainStatic());
+		json.Value("batched_shapes", Renderer::BatchShapes());
+		json.Value("cull_distance", (double)Renderer::CullDistance());
+		json.Value("camera_path", desc.camera_path.size() ? desc.camera_path : string("flyover"));
+		json.BeginArray("courses");
+		for (size_t i = 0; i < courses.size(); i++) {
+			json.BeginObject();
+			json.Value("name", courses[i]);
+			json.BeginArray("passes");
+			for (size_t j = 0; j < sizeof(passes) / sizeof(passes[0]); j++) {
+				cerr << "rendering " << courses[i] << " " << passes[j].mode << (passes[j].shadows ? "" : " without shadows")
+					<< (passes[j].culling ? "" : " without culling") << endl;
+				RunPass(courses[i], passes[j], desc, json);
+			}
+			json.EndArray();
+			json.EndObject();
+		}
+		json.EndArray();
+		json.EndObject();
+	}
+}
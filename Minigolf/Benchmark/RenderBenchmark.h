@@ -0,0 +1,33 @@
+#pragma once
+
+#include "foundation/PxSimpleTypes.h"
+#include <string>
+#include <vector>
+
+namespace Benchmark
+{
+	using namespace std;
+	using namespace physx;
+
+	///Render benchmark settings
+	struct RenderBenchDesc {
+		string course;			// "course", "generated", "green" or "all"
+		string camera_path;		// recorded camera path, empty for a flyover
+		string output;			// JSON file, empty for stdout
+		PxU32 frames;			// frames per render mode
+		PxU32 width;			// offscreen size
+		PxU32 height;
+		PxU32 tiles;			// "generated": number of path pieces
+		PxU32 seed;				// "generated" and "green": layout seed
+		PxU32 green_size;		// "green": heightfield samples along each side
+		PxReal visualisation_extent;	// half size of the debug geometry box around the camera
+		PxReal delta_time;
+
+		RenderBenchDesc() : course("all"), frames(600), width(1280), height(720), tiles(200), seed(1),
+			green_size(1024), visualisation_extent(40.f), delta_time(1.f / 60.f) {}
+	};
+
+	///Replay a camera path over the courses in every render mode and write
+	///a JSON report, PhysX and an offscreen renderer have to be initialised already
+	void RunRenderBenchmark(const RenderBenchDesc& desc);
+}
@@ -4,27 +4,32 @@ namespace VisualDebugger
 {
 	using namespace physx;
 
-	Camera::Camera(const PxVec3 &_eye, const PxVec3& _dir, PxReal _speed, PxRigidDynamic* targetActor)
+	Camera::Camera(const PxVec3 &_eye, const PxVec3& _dir, PxReal _speed)
 	{
 		eye_init = _eye;
 		dir_init = _dir.getNormalized();
 		speed_init = _speed;
-		
-		this->targetActor = targetActor;
 
 		Reset();
 	}
 
 	void Camera::Reset()
 	{
+		eye = eye_init;
+		goal = eye_init;
+
 		x = eye.y;
 		y = eye.x;
 
+		//the follow orbit starts at the eye's offset from the origin
+		const float RAD2DEG = 57.2958f;
 		camx = eye.x;
 		camy = eye.y;
 		camz = eye.z;
-		
-		eye = eye_init;
+		const PxReal length = eye.magnitude();
+		theta = atan2f(camz, camx) * RAD2DEG;
+		azimuth = (length > 0.f) ? asinf(camy / length) * RAD2DEG : 0.f;
+
 		dir = dir_init;
 		speed = speed_init;
 	}
@@ -120,9 +125,30 @@ namespace VisualDebugger
 		dir = PxVec3(-camx, -camy, -camz);
 	}
 
-	void Camera::UpdatePosition(float deltatime) {
-		PxVec3 lerp = Lerp(eye, targetActor->getGlobalPose().p + PxVec3(camx, camy, camz), deltatime);
+	void Camera::UpdatePosition(const PxVec3& target, float deltatime, PxReal clear) {
+		const PxVec3 offset = Offset();
+		const PxReal length = offset.magnitude();
+		goal = (clear < length) ? target + offset * (clear / length) : target + offset;
+		PxVec3 lerp = Lerp(eye, goal, deltatime);
 		eye = lerp;
+
+		//pull in at once when blocked, the lerp eases it back out
+		const PxVec3 from_target = eye - target;
+		if (from_target.magnitude() > clear)
+			eye = target + from_target.getNormalized() * clear;
+	}
+
+	PxVec3 Camera::Offset() const {
+		return PxVec3(camx, camy, camz);
+	}
+
+	PxReal Camera::CollisionRadius() const {
+		return collision_radius;
+	}
+
+	bool Camera::Moving() const {
+		//within a hundredth of a unit is close enough to stop drawing
+		return (goal - eye).magnitudeSquared() > 1e-4f;
 	}
 
 	PxVec3 Camera::Lerp(PxVec3 start, PxVec3 end, float percent) {
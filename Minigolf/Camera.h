@@ -20,11 +20,10 @@ namespace VisualDebugger
 		PxReal x = 0.0f;
 		PxReal y = 0.0f;
 
-		PxRigidDynamic* targetActor;
-
-
 		float mouseSensitivity = 0.2f;
 		float distance = 10.0f;
+		//kept between the eye and static geometry, about the size of the near plane
+		PxReal collision_radius = 0.5f;
 
 		float theta;
 		float azimuth;
@@ -33,9 +32,12 @@ namespace VisualDebugger
 		float camy;
 		float camz;
 
+		//where UpdatePosition is taking the eye
+		PxVec3 goal;
+
 	public:
 		///constructor
-		Camera(const PxVec3& _eye, const PxVec3& _dir, const PxReal _speed, PxRigidDynamic* targetActor);
+		Camera(const PxVec3& _eye, const PxVec3& _dir, const PxReal _speed);
 
 		
 
@@ -83,9 +85,20 @@ namespace VisualDebugger
 
 		void UpdateCamera(float mouseX, float mouseY);
 
-		void UpdatePosition(float deltatime);
+		///follow the target, the ball's position; the eye stays within clear of the target,
+		///how far a sweep towards it got before static shapes were in the way
+		void UpdatePosition(const PxVec3& target, float deltatime, PxReal clear = PX_MAX_F32);
+
+		///where the eye is heading, relative to the target
+		PxVec3 Offset() const;
+
+		///kept between the eye and static geometry
+		PxReal CollisionRadius() const;
 
 		PxVec3 Lerp(PxVec3 start, PxVec3 end, float percent);
 
+		///is the eye still easing towards where UpdatePosition is taking it
+		bool Moving() const;
+
 	};
 }
\ No newline at end of file
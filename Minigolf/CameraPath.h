@@ -0,0 +1,147 @@
+#pragma once
+
+#include "foundation/PxVec3.h"
+#include "foundation/PxBounds3.h"
+#include "foundation/PxMath.h"
+#include "Exception.h"
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+
+namespace VisualDebugger
+{
+	using namespace physx;
+	using namespace std;
+
+	///Camera placement at a point in time
+	struct CameraKey {
+		PxReal time;
+		PxVec3 eye;
+		PxVec3 dir;
+	};
+
+	///A shot taken at a point in time
+	struct ShotEvent {
+		PxReal time;
+		PxVec3 dir;
+		PxReal strength;
+	};
+
+	///Recorded camera movement and shots, replayed by the render benchmark and by capture.
+	///
+	///Stored as text, one "time eye.x eye.y eye.z dir.x dir.y dir.z" line per key
+	///and one "shot time dir.x dir.y dir.z strength" line per shot.
+	class CameraPath
+	{
+		vector<CameraKey> keys;
+		vector<ShotEvent> shots;
+
+	public:
+		///Append a key, times have to be increasing
+		void Add(PxReal time, const PxVec3& eye, const PxVec3& dir) {
+			CameraKey key = { time, eye, dir };
+			keys.push_back(key);
+		}
+
+		///Append a shot, times have to be increasing
+		void AddShot(PxReal time, const PxVec3& dir, PxReal strength) {
+			ShotEvent shot = { time, dir, strength };
+			shots.push_back(shot);
+		}
+
+		const vector<ShotEvent>& Shots() const { return shots; }
+
+		bool Empty() const { return keys.empty(); }
+
+		PxReal Duration() const { return keys.empty() ? 0.0f : keys.back().time; }
+
+		///Interpolated placement, clamped to the ends of the path
+		void Sample(PxReal time, PxVec3& eye, PxVec3& dir) const {
+			if (keys.empty())
+				throw new Exception("CameraPath::Sample, the path is empty.");
+
+			size_t next = 0;
+			while ((next < keys.size()) && (keys[next].time < time))
+				next++;
+
+			if (next == 0) {
+				eye = keys.front().eye;
+				dir = keys.front().dir;
+				return;
+			}
+			if (next == keys.size()) {
+				eye = keys.back().eye;
+				dir = keys.back().dir;
+				return;
+			}
+
+			const CameraKey& a = keys[next - 1];
+			const CameraKey& b = keys[next];
+			PxReal t = (b.time > a.time) ? (time - a.time) / (b.time - a.time) : 1.0f;
+			eye = a.eye + (b.eye - a.eye) * t;
+			dir = (a.dir + (b.dir - a.dir) * t).getNormalized();
+		}
+
+		void Save(const string& file) const {
+			ofstream out(file.c_str());
+			if (!out)
+				throw new Exception("CameraPath::Save, could not open " + file + ".");
+			for (size_t i = 0; i < keys.size(); i++) {
+				const CameraKey& k = keys[i];
+				out << k.time << " " << k.eye.x << " " << k.eye.y << " " << k.eye.z << " "
+					<< k.dir.x << " " << k.dir.y << " " << k.dir.z << "\n";
+			}
+			for (size_t i = 0; i < shots.size(); i++) {
+				const ShotEvent& s = shots[i];
+				out << "shot " << s.time << " " << s.dir.x << " " << s.dir.y << " " << s.dir.z << " " << s.strength << "\n";
+			}
+		}
+
+		static CameraPath Load(const string& file) {
+			ifstream in(file.c_str());
+			if (!in)
+				throw new Exception("CameraPath::Load, could not open " + file + ".");
+			CameraPath path;
+			string line;
+			while (getline(in, line)) {
+				istringstream fields(line);
+				if (line.compare(0, 4, "shot") == 0) {
+					string tag;
+					ShotEvent s;
+					if (fields >> tag >> s.time >> s.dir.x >> s.dir.y >> s.dir.z >> s.strength)
+						path.shots.push_back(s);
+				}
+				else {
+					CameraKey k;
+					if (fields >> k.time >> k.eye.x >> k.eye.y >> k.eye.z >> k.dir.x >> k.dir.y >> k.dir.z)
+						path.keys.push_back(k);
+				}
+			}
+			if (path.Empty())
+				throw new Exception("CameraPath::Load, no keys in " + file + ".");
+			return path;
+		}
+
+		///Glide along the longer side of the bounds looking ahead and down,
+		///used when no recorded path is given
+		static CameraPath Flyover(const PxBounds3& bounds, PxReal duration) {
+			const PxVec3 extents = bounds.getExtents();
+			const PxVec3 center = bounds.getCenter();
+			const PxVec3 axis = (extents.x > extents.z) ? PxVec3(1.0f, 0.0f, 0.0f) : PxVec3(0.0f, 0.0f, 1.0f);
+			const PxVec3 side = PxVec3(axis.z, 0.0f, axis.x);
+			const PxReal length = PxMax(extents.x, extents.z);
+			const PxReal height = bounds.maximum.y + 12.0f;
+
+			CameraPath path;
+			const PxU32 segments = 32;
+			for (PxU32 i = 0; i <= segments; i++) {
+				PxReal s = (PxReal)i / segments;
+				PxVec3 eye = center + axis * (length * (2.0f * s - 1.0f)) + side * (PxSin(s * PxTwoPi) * 6.0f);
+				eye.y = height;
+				path.Add(s * duration, eye, (axis - PxVec3(0.0f, 0.6f, 0.0f)).getNormalized());
+			}
+			return path;
+		}
+	};
+}
@@ -34,6 +34,16 @@ namespace PhysicsEngine {
 	};
 
 
+	///Wedge hull cooked once per PhysX instance and shared by all the pieces, owned by the engine
+	inline PxConvexMesh* WedgeMesh() {
+		PxConvexMesh* mesh = (PxConvexMesh*)SharedObject("wedge");
+		if (!mesh) {
+			mesh = ConvexMesh::Cook(wedge_verticies);
+			SharedObject("wedge", mesh);
+		}
+		return mesh;
+	}
+
 	// Done
 	class PathStraight : public StaticActor {
 	public: 
@@ -54,17 +64,17 @@ namespace PhysicsEngine {
 
 			if (surface == S_SAND) {
 				Color(color_palette[5], 0);
-				PxMaterial* sandMaterial = CreateMaterial(PX_MAX_F32, PX_MAX_F32, 0.0f);
+				PxMaterial* sandMaterial = SharedMaterial(PX_MAX_F32, PX_MAX_F32, 0.0f);
 				GetShape(0)->setMaterials(&sandMaterial, 1);
 			}
 			else if (surface == S_ICE) {
 				Color(color_palette[6], 0);
-				PxMaterial* iceMaterial = CreateMaterial(0.0f, 0.0f, 0.1f);
+				PxMaterial* iceMaterial = SharedMaterial(0.0f, 0.0f, 0.1f);
 				GetShape(0)->setMaterials(&iceMaterial, 1);
 			}
 			else {
 				Color(color_palette[1], 0);
-				PxMaterial* normalMaterial = CreateMaterial(0.4f, 2.1f, 0.1f);
+				PxMaterial* normalMaterial = SharedMaterial(0.4f, 2.1f, 0.1f);
 				GetShape(0)->setMaterials(&normalMaterial, 1);
 			}
 		}
@@ -141,13 +151,9 @@ namespace PhysicsEngine {
 			GetShape(4)->setLocalPose(PxTransform(0.0f, -0.3f, 3.8f));			
 
 			if (slanted) {
-				PxShape* wedge = ConvexMesh(wedge_verticies).GetShape(0);
-				PxConvexMeshGeometry wedge2;
-				if (wedge->getConvexMeshGeometry(wedge2)) {
-					CreateShape(wedge2);
-					GetShape(5)->setLocalPose(PxTransform(PxVec3(-1.8f, 0.7f, -1.8f), PxQuat(-1.5708f, PxVec3(0, 1, 0))));
-					Color(color_palette[2], 5);
-				}
+				CreateShape(PxConvexMeshGeometry(WedgeMesh()));
+				GetShape(5)->setLocalPose(PxTransform(PxVec3(-1.8f, 0.7f, -1.8f), PxQuat(-1.5708f, PxVec3(0, 1, 0))));
+				Color(color_palette[2], 5);
 			}
 
 			Color(color_palette[2], 0);
@@ -295,21 +301,13 @@ namespace PhysicsEngine {
 			GetShape(4)->setLocalPose(PxTransform(0.0f, -0.3f, 3.8f));
 
 			
-			PxShape* wedgeRight = ConvexMesh(wedge_verticies).GetShape(0);
-			PxConvexMeshGeometry wedgeRightGeom;
-			if (wedgeRight->getConvexMeshGeometry(wedgeRightGeom)) {
-				CreateShape(wedgeRightGeom);
-				GetShape(5)->setLocalPose(PxTransform(PxVec3(1.8f, 0.7f, -1.8f), PxQuat(-1.5708f, PxVec3(0, 1, 0))));
-				Color(color_palette[2], 5);
-			}
+			CreateShape(PxConvexMeshGeometry(WedgeMesh()));				// WEDGE RIGHT
+			GetShape(5)->setLocalPose(PxTransform(PxVec3(1.8f, 0.7f, -1.8f), PxQuat(-1.5708f, PxVec3(0, 1, 0))));
+			Color(color_palette[2], 5);
 
-			PxShape* wedgeLeft = ConvexMesh(wedge_verticies).GetShape(0);
-			PxConvexMeshGeometry wedgeLeftGeom;
-			if (wedgeLeft->getConvexMeshGeometry(wedgeLeftGeom)) {
-				CreateShape(wedgeLeftGeom);
-				GetShape(6)->setLocalPose(PxTransform(PxVec3(-1.8f, 0.7f, -1.8f), PxQuat(3.14159f, PxVec3(0, 1, 0))));
-				Color(color_palette[2], 6);
-			}
+			CreateShape(PxConvexMeshGeometry(WedgeMesh()));				// WEDGE LEFT
+			GetShape(6)->setLocalPose(PxTransform(PxVec3(-1.8f, 0.7f, -1.8f), PxQuat(3.14159f, PxVec3(0, 1, 0))));
+			Color(color_palette[2], 6);
 			
 
 			Color(color_palette[2], 0);
@@ -0,0 +1,211 @@
+#pragma once
+
+#include "MyPhysicsEngine.h"
+#include <random>
+
+namespace PhysicsEngine
+{
+	///Course laid out from the stock path pieces by a seeded random walk.
+	///
+	///The path snakes back and forth in legs running along the z axis, joined
+	///by corners and a single cross piece, and finishes in a hole once the tile
+	///budget is used up. The same seed always gives the same course.
+	class GeneratedScene : public MyScene
+	{
+		enum Heading {
+			H_NORTH,	// -z
+			H_EAST,		// +x
+			H_SOUTH,	// +z
+			H_WEST		// -x
+		};
+
+		PxU32 tile_count;
+		PxU32 seed;
+		PxU32 leg_length;
+		std::mt19937 random;
+
+		static PxVec3 Step(Heading heading) {
+			static const PxVec3 steps[] = { PxVec3(0.0f, 0.0f, -8.0f), PxVec3(8.0f, 0.0f, 0.0f), PxVec3(0.0f, 0.0f, 8.0f), PxVec3(-8.0f, 0.0f, 0.0f) };
+			return steps[heading];
+		}
+
+		static Heading Opposite(Heading heading) {
+			return (Heading)((heading + 2) % 4);
+		}
+
+		///Rotation of a PathCorner joining the two sides
+		static PxQuat CornerRotation(Heading from, Heading to) {
+			//open sides of a corner rotated by k quarter turns about y
+			static const Heading openings[4][2] = { { H_SOUTH, H_EAST }, { H_EAST, H_NORTH }, { H_NORTH, H_WEST }, { H_WEST, H_SOUTH } };
+			const Heading entry = Opposite(from);
+			for (PxU32 k = 0; k < 4; k++) {
+				if (((openings[k][0] == entry) && (openings[k][1] == to)) || ((openings[k][0] == to) && (openings[k][1] == entry)))
+					return PxQuat(k * 1.5708f, PxVec3(0, 1, 0));
+			}
+			return PxQuat(PxIdentity);
+		}
+
+		///A piece of a leg along the z axis
+		void AddLegTile(const PxVec3& tile) {
+			PxU32 pick = random() % 100;
+			if (pick < 50) {
+				Add(Create<PathStraight>(PxTransform(tile)));
+			}
+			else if (pick < 60) {
+				Add(Create<PathStraight>(PxTransform(tile), S_SAND));
+			}
+			else if (pick < 70) {
+				Add(Create<PathStraight>(PxTransform(tile), S_ICE));
+			}
+			else if (pick < 78) {
+				Add(Create<PathStraight>(PxTransform(tile)));
+				AddSlider(tile);
+			}
+			else if (pick < 84) {
+				Add(Create<PathStraight>(PxTransform(tile)));
+				AddDoors(tile);
+			}
+			else if (pick < 90) {
+				Add(Create<PathWindMill>(PxTransform(tile)));
+				AddTallWindmill(tile);
+			}
+			else if (pick < 96) {
+				Add(Create<PathTunnel>(PxTransform(tile)));
+			}
+			else {
+				Add(Create<PathSharpIncline>(PxTransform(tile)));
+			}
+		}
+
+		///A piece crossing over to the next leg
+		void AddCrossTile(const PxVec3& tile) {
+			const PxQuat rot(1.5708f, PxVec3(0, 1, 0));
+			Add(Create<PathStraight>(PxTransform(tile, rot)));
+			PxU32 pick = random() % 3;
+			if (pick == 1)
+				AddDangles(tile);
+			else if (pick == 2)
+				AddFlatWindmill(tile);
+		}
+
+	public:
+		///tiles: number of path pieces, leg: pieces per leg along z
+		GeneratedScene(PxU32 tiles = 200, PxU32 _seed = 1, PxU32 leg = 12)
+			: tile_count(tiles), seed(_seed), leg_length(PxMax(leg, 1u)) {
+		}
+
+		virtual void CreateScene() {
+			random.seed(seed);
+
+			AddGround();
+			AddBall(PxVec3(0.0f, 1.7f, 0.0f));
+
+			PxVec3 tile(0.0f, 1.0f, 0.0f);
+			Add(Create<PathStart>(PxTransform(tile)));
+
+			Heading heading = H_NORTH;
+			PxU32 placed = 1;
+			PxU32 in_leg = 0;
+
+			//keep going until the budget is spent and the path points north again
+			while ((placed + 1 < tile_count) || (heading != H_NORTH)) {
+				tile += Step(heading);
+				placed++;
+
+				if (in_leg < leg_length) {
+					AddLegTile(tile);
+					in_leg++;
+					continue;
+				}
+
+				//turn east, cross over, and turn into the next leg
+				Heading next = (heading == H_NORTH) ? H_SOUTH : H_NORTH;
+				Add(Create<PathCorner>(PxTransform(tile, CornerRotation(heading, H_EAST))));
+
+				tile += Step(H_EAST);
+				AddCrossTile(tile);
+
+				tile += Step(H_EAST);
+				Add(Create<PathCorner>(PxTransform(tile, CornerRotation(H_EAST, next))));
+
+				placed += 2;
+				heading = next;
+				in_leg = 0;
+			}
+
+			tile += Step(heading);
+			Add(Create<PathHole>(PxTransform(tile)));
+			AddFinish(tile);
+		}
+	};
+
+	///Rolling practice green on a single heightfield, with sand in the hollows and ice on the crests.
+	///
+	///Heights are a sum of seeded waves, longest first, so the same seed always gives the same green.
+	class GeneratedGreen : public MyScene
+	{
+		PxU32 samples;
+		PxU32 seed;
+		PxReal spacing;
+
+	public:
+		///samples: heights along each side, spacing: metres between them
+		GeneratedGreen(PxU32 _samples = 1024, PxU32 _seed = 1, PxReal _spacing = 0.25f)
+			: samples(PxMax(_samples, 2u)), seed(_seed), spacing(_spacing) {
+		}
+
+		virtual void CreateScene() {
+			std::mt19937 random(seed);
+			std::uniform_real_distribution<PxReal> unit(0.0f, 1.0f);
+
+			const PxReal size = (samples - 1) * spacing;
+			const PxU32 wave_count = 6;
+			PxVec3 waves[wave_count];		// direction times frequency in x and z, phase in y
+			PxReal amplitudes[wave_count];
+			for (PxU32 i = 0; i < wave_count; i++) {
+				const PxReal angle = unit(random) * PxTwoPi;
+				const PxReal frequency = PxTwoPi * (i + 1) * 1.7f / size;
+				waves[i] = PxVec3(PxCos(angle) * frequency, unit(random) * PxTwoPi, PxSin(angle) * frequency);
+				amplitudes[i] = 1.5f / (i + 1);
+			}
+
+			std::vector<PxReal> heights(samples * samples);
+			PxReal lowest = PX_MAX_F32, highest = -PX_MAX_F32;
+			for (PxU32 r = 0; r < samples; r++) {
+				for (PxU32 c = 0; c < samples; c++) {
+					PxReal h = 0.0f;
+					for (PxU32 i = 0; i < wave_count; i++)
+						h += amplitudes[i] * PxSin(waves[i].x * r * spacing + waves[i].z * c * spacing + waves[i].y);
+					heights[r * samples + c] = h;
+					lowest = PxMin(lowest, h);
+					highest = PxMax(highest, h);
+				}
+			}
+
+			//keep clear of the ground plane, touching it resets the ball
+			std::vector<PxU8> materials(heights.size());
+			for (PxU32 i = 0; i < heights.size(); i++) {
+				const PxReal t = (heights[i] - lowest) / PxMax(highest - lowest, 0.001f);
+				materials[i] = (t < 0.15f) ? S_SAND : ((t > 0.9f) ? S_ICE : S_NORMAL);
+				heights[i] += 0.5f - lowest;
+			}
+
+			AddGround();
+			const PxU32 center = (samples / 2) * samples + samples / 2;
+			AddBall(PxVec3(0.0f, heights[center] + 1.0f, 0.0f));
+
+			HeightField* green = Create<HeightField>(samples, samples, heights, materials, spacing,
+				PxTransform(PxVec3(-0.5f * size, 0.0f, -0.5f * size)));
+			std::vector<PxMaterial*> surfaces(3);
+			surfaces[S_NORMAL] = SharedMaterial(0.4f, 2.1f, 0.1f);
+			surfaces[S_SAND] = SharedMaterial(PX_MAX_F32, PX_MAX_F32, 0.0f);
+			surfaces[S_ICE] = SharedMaterial(0.0f, 0.0f, 0.1f);
+			std::vector<PxVec4> colors(3);
+			colors[S_NORMAL] = color_palette[1];
+			colors[S_SAND] = color_palette[5];
+			colors[S_ICE] = color_palette[6];
+			green->Materials(surfaces, colors);
+			Add(green);
+		}
+	};
+}
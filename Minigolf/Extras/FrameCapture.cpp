@@ -0,0 +1,252 @@
+#include "FrameCapture.h"
+#include "..\Exception.h"
+#include <GL/glut.h>
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <iostream>
+
+#ifdef USE_OSMESA
+#include <GL/osmesa.h>
+#elif !defined(_WIN32)
+#include <GL/glx.h>
+#endif
+
+//pixel buffer objects are GL 2.1, looked up at run time like any extension
+#ifndef APIENTRY
+#define APIENTRY
+#endif
+#ifndef GL_PIXEL_PACK_BUFFER
+#define GL_PIXEL_PACK_BUFFER 0x88EB
+#endif
+#ifndef GL_STREAM_READ
+#define GL_STREAM_READ 0x88E1
+#endif
+#ifndef GL_READ_ONLY
+#define GL_READ_ONLY 0x88B8
+#endif
+
+#ifdef _WIN32
+#define popen _popen
+#define pclose _pclose
+//binary, so that frames are not mangled by newline translation
+#define PIPE_MODE "wb"
+#else
+//glibc rejects "wb"
+#define PIPE_MODE "w"
+#endif
+
+namespace VisualDebugger
+{
+	typedef void (APIENTRY *GenBuffersProc)(GLsizei n, GLuint* buffers);
+	typedef void (APIENTRY *DeleteBuffersProc)(GLsizei n, const GLuint* buffers);
+	typedef void (APIENTRY *BindBufferProc)(GLenum target, GLuint buffer);
+	typedef void (APIENTRY *BufferDataProc)(GLenum target, ptrdiff_t size, const void* data, GLenum usage);
+	typedef void* (APIENTRY *MapBufferProc)(GLenum target, GLenum access);
+	typedef GLboolean (APIENTRY *UnmapBufferProc)(GLenum target);
+
+	static GenBuffersProc GenBuffers = 0;
+	static DeleteBuffersProc DeleteBuffers = 0;
+	static BindBufferProc BindBuffer = 0;
+	static BufferDataProc BufferData = 0;
+	static MapBufferProc MapBuffer = 0;
+	static UnmapBufferProc UnmapBuffer = 0;
+
+	static void* GetProc(const char* name)
+	{
+#ifdef USE_OSMESA
+		return (void*)OSMesaGetProcAddress(name);
+#elif defined(_WIN32)
+		return (void*)wglGetProcAddress(name);
+#else
+		return (void*)glXGetProcAddressARB((const GLubyte*)name);
+#endif
+	}
+
+	///Look up the buffer functions once, false if the driver has none
+	static bool LoadBufferFunctions()
+	{
+		if (!GenBuffers)
+		{
+			GenBuffers = (GenBuffersProc)GetProc("glGenBuffers");
+			DeleteBuffers = (DeleteBuffersProc)GetProc("glDeleteBuffers");
+			BindBuffer = (BindBufferProc)GetProc("glBindBuffer");
+			BufferData = (BufferDataProc)GetProc("glBufferData");
+			MapBuffer = (MapBufferProc)GetProc("glMapBuffer");
+			UnmapBuffer = (UnmapBufferProc)GetProc("glUnmapBuffer");
+		}
+		return GenBuffers && DeleteBuffers && BindBuffer && BufferData && MapBuffer && UnmapBuffer;
+	}
+
+	FrameCapture::FrameCapture(const string& output, int _width, int _height)
+		: name(output), width(_width), height(_height), pipe(0), sequence_width(0), sequence_zeros(false), async(false),
+		submitted(0), written(0)
+	{
+		if (output.compare(0, 5, "pipe:") == 0)
+		{
+			format = PIPE;
+			pipe = popen(output.substr(5).c_str(), PIPE_MODE);
+			if (!pipe)
+				throw new Exception("FrameCapture::FrameCapture, could not start " + output.substr(5) + ".");
+		}
+		else if (output.find('%') != string::npos)
+		{
+			format = PPM_SEQUENCE;
+			ParseSequence(output);
+		}
+		else
+		{
+			format = ((output.size() > 4) && (output.compare(output.size() - 4, 4, ".raw") == 0)) ? RAW : PPM_STREAM;
+			file.open(output.c_str(), ios::binary);
+			if (!file)
+				throw new Exception("FrameCapture::FrameCapture, could not open " + output + ".");
+		}
+
+		const ptrdiff_t frame_size = (ptrdiff_t)width * height * 3;
+		if (LoadBufferFunctions())
+		{
+			GenBuffers(ring_size, pbos);
+			for (PxU32 i = 0; i < ring_size; i++)
+			{
+				BindBuffer(GL_PIXEL_PACK_BUFFER, pbos[i]);
+				BufferData(GL_PIXEL_PACK_BUFFER, frame_size, 0, GL_STREAM_READ);
+			}
+			BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+			async = (glGetError() == GL_NO_ERROR);
+			if (!async)
+				DeleteBuffers(ring_size, pbos);
+		}
+		if (!async)
+			pixels.resize(frame_size);
+	}
+
+	void FrameCapture::ParseSequence(const string& pattern)
+	{
+		//a single %d, optionally zero padded to a width, and %% for a percent sign
+		bool found = false;
+		string* part = &sequence_prefix;
+		for (size_t i = 0; i < pattern.size(); i++)
+		{
+			if (pattern[i] != '%')
+			{
+				*part += pattern[i];
+				continue;
+			}
+			if ((i + 1 < pattern.size()) && (pattern[i + 1] == '%'))
+			{
+				*part += '%';
+				i++;
+				continue;
+			}
+			size_t end = i + 1;
+			while ((end < pattern.size()) && isdigit((unsigned char)pattern[end]))
+				end++;
+			if (found || (end == pattern.size()) || (pattern[end] != 'd'))
+				throw new Exception("FrameCapture::ParseSequence, " + pattern + " needs exactly one %d or %0Nd.");
+			sequence_zeros = (end > i + 1) && (pattern[i + 1] == '0');
+			sequence_width = (end > i + 1) ? std::min(atoi(pattern.substr(i + 1, end - i - 1).c_str()), 20) : 0;
+			found = true;
+			part = &sequence_suffix;
+			i = end;
+		}
+		if (!found)
+			throw new Exception("FrameCapture::ParseSequence, " + pattern + " needs exactly one %d or %0Nd.");
+	}
+
+	FrameCapture::~FrameCapture()
+	{
+		//the frames still in flight are written out, a failure is reported rather than thrown
+		try
+		{
+			Flush();
+		}
+		catch (Exception* exc)
+		{
+			cerr << exc->what() << endl;
+			delete exc;
+		}
+		if (async)
+			DeleteBuffers(ring_size, pbos);
+		if (pipe)
+			pclose(pipe);
+	}
+
+	void FrameCapture::Frame()
+	{
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+		if (!async)
+		{
+			glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, &pixels.front());
+			submitted++;
+			Write(&pixels.front());
+			return;
+		}
+
+		//the ring is full, the oldest frame has had time to arrive
+		if (submitted - written == ring_size)
+			WriteOldest();
+
+		BindBuffer(GL_PIXEL_PACK_BUFFER, pbos[submitted % ring_size]);
+		glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, 0);
+		BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		submitted++;
+	}
+
+	void FrameCapture::Flush()
+	{
+		while (async && (written < submitted))
+			WriteOldest();
+		if (file.is_open())
+			file.flush();
+		if (pipe)
+			fflush(pipe);
+	}
+
+	void FrameCapture::WriteOldest()
+	{
+		BindBuffer(GL_PIXEL_PACK_BUFFER, pbos[written % ring_size]);
+		const unsigned char* data = (const unsigned char*)MapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+		if (!data)
+			throw new Exception("FrameCapture::WriteOldest, could not map the pixel buffer.");
+		Write(data);
+		UnmapBuffer(GL_PIXEL_PACK_BUFFER);
+		BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	}
+
+	void FrameCapture::Write(const unsigned char* bottom_up)
+	{
+		ofstream sequence_file;
+		if (format == PPM_SEQUENCE)
+		{
+			char number[32];
+			snprintf(number, sizeof(number), sequence_zeros ? "%0*u" : "%*u", sequence_width, written);
+			const string path = sequence_prefix + number + sequence_suffix;
+			sequence_file.open(path.c_str(), ios::binary);
+			if (!sequence_file)
+				throw new Exception("FrameCapture::Write, could not open " + path + ".");
+		}
+		ostream* out = (format == PPM_SEQUENCE) ? (ostream*)&sequence_file : (ostream*)&file;
+
+		char header[64];
+		int header_size = snprintf(header, sizeof(header), "P6\n%d %d\n255\n", width, height);
+		if (format == PIPE)
+		{
+			bool ok = fwrite(header, 1, header_size, pipe) == (size_t)header_size;
+			//GL rows are bottom up
+			for (int y = height - 1; ok && (y >= 0); y--)
+				ok = fwrite(bottom_up + (size_t)y * width * 3, 1, (size_t)width * 3, pipe) == (size_t)width * 3;
+			if (!ok)
+				throw new Exception("FrameCapture::Write, could not write to " + name + ".");
+		}
+		else
+		{
+			if (format != RAW)
+				out->write(header, header_size);
+			for (int y = height - 1; y >= 0; y--)
+				out->write((const char*)bottom_up + (size_t)y * width * 3, (streamsize)width * 3);
+			if (!*out)
+				throw new Exception("FrameCapture::Write, could not write to " + name + ".");
+		}
+		written++;
+	}
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "PxPhysicsAPI.h"
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstdio>
+
+namespace VisualDebugger
+{
+	using namespace physx;
+	using namespace std;
+
+	///Reads rendered frames back and streams them out, for replay videos.
+	///
+	///The output is chosen by name:
+	///  "pipe:command"	PPM frames written to the standard input of a process,
+	///					e.g. "pipe:ffmpeg -f image2pipe -c:v ppm -i - clip.mp4"
+	///  "name%05d.ppm"	one PPM file per frame, with a single %d or %0Nd
+	///  "name.raw"		raw top-down RGB24 frames, one after another
+	///  anything else	a PPM stream, one frame after another
+	///
+	///Frames are read into a ring of pixel buffer objects and written a few frames
+	///later, so reading back does not wait for the frame to finish. Without pixel
+	///buffer objects each frame is read back straight away.
+	class FrameCapture
+	{
+		enum Format { PPM_STREAM, PPM_SEQUENCE, RAW, PIPE };
+
+		static const PxU32 ring_size = 3;
+
+		Format format;
+		string name;
+		int width;
+		int height;
+		ofstream file;
+		FILE* pipe;
+		//file names of a PPM sequence, around the frame number
+		string sequence_prefix;
+		string sequence_suffix;
+		int sequence_width;
+		bool sequence_zeros;
+
+		bool async;
+		unsigned int pbos[ring_size];
+		PxU32 submitted;		// frames read into the ring
+		PxU32 written;			// frames written out
+		vector<unsigned char> pixels;
+
+		void Write(const unsigned char* bottom_up);
+
+		void ParseSequence(const string& pattern);
+
+		void WriteOldest();
+
+	public:
+		///Output name as above, width and height of the frames
+		FrameCapture(const string& output, int width, int height);
+
+		///Write the frames still in flight
+		~FrameCapture();
+
+		///Read back the frame just rendered, call before swapping or finishing
+		void Frame();
+
+		///Write every frame read so far
+		void Flush();
+
+		///Frames written out
+		PxU32 Written() const { return written; }
+
+		///Are the frames read through pixel buffer objects
+		bool Async() const { return async; }
+	};
+}
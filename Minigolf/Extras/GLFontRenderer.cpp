@@ -37,18 +37,86 @@ bool GLFontRenderer::init()
 }
 
 void GLFontRenderer::print(float x, float y, float fontSize, const char* pString, bool forceMonoSpace, int monoSpaceWidth, bool doOrthoProj)
+{
+	// kept between calls so that printing does not allocate
+	static std::vector<float> vertList;
+	static std::vector<float> textureCoordList;
+
+	vertList.clear();
+	textureCoordList.clear();
+	layout(x, y, fontSize, pString, vertList, textureCoordList, forceMonoSpace, monoSpaceWidth);
+	draw(vertList.size() ? &vertList.front() : 0, textureCoordList.size() ? &textureCoordList.front() : 0, (unsigned int)vertList.size()/3, doOrthoProj);
+}
+
+unsigned int GLFontRenderer::layout(float x, float y, float fontSize, const char* pString, std::vector<float>& vertList, std::vector<float>& textureCoordList, bool forceMonoSpace, int monoSpaceWidth)
 {
 	x = x*m_screenWidth;
 	y = y*m_screenHeight;
 	fontSize = fontSize*m_screenHeight;
 
+	const float glyphHeightUV = ((float)OGL_FONT_CHARS_PER_COL)/OGL_FONT_TEXTURE_HEIGHT*2-0.01f;
+	const float glyphWidthUV = ((float)OGL_FONT_CHARS_PER_ROW)/OGL_FONT_TEXTURE_WIDTH;
+
+	float translate = 0.0f;
+	float translateDown = 0.0f;
+	unsigned int count = 0;
+
+	unsigned int num = (unsigned int)strlen(pString);
+	vertList.reserve(vertList.size() + num*3*6);
+	textureCoordList.reserve(textureCoordList.size() + num*2*6);
+
+	for(unsigned int i=0;i<num; i++)
+	{
+		if (pString[i] == '\n') {
+			translateDown-=0.005f*m_screenHeight+fontSize;
+			translate = 0.0f;
+			continue;
+		}
+
+		int c = pString[i]-OGL_FONT_CHAR_BASE;
+		if (c < OGL_FONT_CHARS_PER_ROW*OGL_FONT_CHARS_PER_COL) {
+
+			count++;
+
+			float glyphWidth = (float)GLFontGlyphWidth[c];
+			if(forceMonoSpace){
+				glyphWidth = (float)monoSpaceWidth;
+			}
+			
+			glyphWidth = glyphWidth*(fontSize/(((float)OGL_FONT_TEXTURE_WIDTH)/OGL_FONT_CHARS_PER_ROW))-0.01f;
+
+			float cxUV = float((c)%OGL_FONT_CHARS_PER_ROW)/OGL_FONT_CHARS_PER_ROW+0.008f;
+			float cyUV = float((c)/OGL_FONT_CHARS_PER_ROW)/OGL_FONT_CHARS_PER_COL+0.008f;
+
+			const float left = x+translate;
+			const float right = x+fontSize+translate;
+			const float bottom = y+translateDown;
+			const float top = y+fontSize+translateDown;
+
+			const float glyphVerts[] = {
+				left, bottom, 0,	right, top, 0,		left, top, 0,
+				left, bottom, 0,	right, bottom, 0,	right, top, 0 };
+			const float glyphUVs[] = {
+				cxUV, cyUV+glyphHeightUV,				cxUV+glyphWidthUV, cyUV,	cxUV, cyUV,
+				cxUV, cyUV+glyphHeightUV,				cxUV+glyphWidthUV, cyUV+glyphHeightUV,	cxUV+glyphWidthUV, cyUV };
+			vertList.insert(vertList.end(), glyphVerts, glyphVerts + 18);
+			textureCoordList.insert(textureCoordList.end(), glyphUVs, glyphUVs + 12);
+
+			translate+=glyphWidth;
+		}
+	}
+
+	return count*6;
+}
+
+void GLFontRenderer::draw(const float* pVertList, const float* pTextureCoordList, unsigned int vertexCount, bool doOrthoProj)
+{
 	if(!m_isInit)
 	{
 		m_isInit = init();
 	}
 
-	unsigned int num = (unsigned int)strlen(pString);
-	if(m_isInit && num > 0)
+	if(m_isInit && vertexCount > 0)
 	{
 		glBlendFunc(GL_SRC_ALPHA,GL_ONE_MINUS_SRC_ALPHA);
 		glDisable(GL_DEPTH_TEST);
@@ -73,94 +141,14 @@ void GLFontRenderer::print(float x, float y, float fontSize, const char* pString
 
 		glColor4f(m_color[0], m_color[1], m_color[2], m_color[3]);
 
-		const float glyphHeightUV = ((float)OGL_FONT_CHARS_PER_COL)/OGL_FONT_TEXTURE_HEIGHT*2-0.01f;
-
-		float translate = 0.0f;
-
-		float* pVertList = new float[num*3*6];
-    	float* pTextureCoordList = new float[num*2*6];
-		int vertIndex = 0;
-    	int textureCoordIndex = 0;
-
-		float translateDown = 0.0f;
-		unsigned int count = 0;
-
-		for(unsigned int i=0;i<num; i++)
-		{
-			const float glyphWidthUV = ((float)OGL_FONT_CHARS_PER_ROW)/OGL_FONT_TEXTURE_WIDTH;
-
-			if (pString[i] == '\n') {
-				translateDown-=0.005f*m_screenHeight+fontSize;
-				translate = 0.0f;
-				continue;
-			}
-
-			int c = pString[i]-OGL_FONT_CHAR_BASE;
-			if (c < OGL_FONT_CHARS_PER_ROW*OGL_FONT_CHARS_PER_COL) {
-
-				count++;
-
-				float glyphWidth = (float)GLFontGlyphWidth[c];
-				if(forceMonoSpace){
-					glyphWidth = (float)monoSpaceWidth;
-				}
-				
-				glyphWidth = glyphWidth*(fontSize/(((float)OGL_FONT_TEXTURE_WIDTH)/OGL_FONT_CHARS_PER_ROW))-0.01f;
-
-				float cxUV = float((c)%OGL_FONT_CHARS_PER_ROW)/OGL_FONT_CHARS_PER_ROW+0.008f;
-				float cyUV = float((c)/OGL_FONT_CHARS_PER_ROW)/OGL_FONT_CHARS_PER_COL+0.008f;
-
-				pTextureCoordList[textureCoordIndex++] = cxUV;
-				pTextureCoordList[textureCoordIndex++] = cyUV+glyphHeightUV;
-				pVertList[vertIndex++] = x+0+translate;
-				pVertList[vertIndex++] = y+0+translateDown;
-				pVertList[vertIndex++] = 0;
-
-				pTextureCoordList[textureCoordIndex++] = cxUV+glyphWidthUV;
-				pTextureCoordList[textureCoordIndex++] = cyUV;
-				pVertList[vertIndex++] = x+fontSize+translate;
-				pVertList[vertIndex++] = y+fontSize+translateDown;
-				pVertList[vertIndex++] = 0;
-
-				pTextureCoordList[textureCoordIndex++] = cxUV;
-				pTextureCoordList[textureCoordIndex++] = cyUV;
-				pVertList[vertIndex++] = x+0+translate;
-				pVertList[vertIndex++] = y+fontSize+translateDown;
-				pVertList[vertIndex++] = 0;
-
-				pTextureCoordList[textureCoordIndex++] = cxUV;
-				pTextureCoordList[textureCoordIndex++] = cyUV+glyphHeightUV;
-				pVertList[vertIndex++] = x+0+translate;
-				pVertList[vertIndex++] = y+0+translateDown;
-				pVertList[vertIndex++] = 0;
-
-				pTextureCoordList[textureCoordIndex++] = cxUV+glyphWidthUV;
-				pTextureCoordList[textureCoordIndex++] = cyUV+glyphHeightUV;
-				pVertList[vertIndex++] = x+fontSize+translate;
-				pVertList[vertIndex++] = y+0+translateDown;
-				pVertList[vertIndex++] = 0;
-
-				pTextureCoordList[textureCoordIndex++] = cxUV+glyphWidthUV;
-				pTextureCoordList[textureCoordIndex++] = cyUV;
-				pVertList[vertIndex++] = x+fontSize+translate;
-				pVertList[vertIndex++] = y+fontSize+translateDown;
-				pVertList[vertIndex++] = 0;
-
-				translate+=glyphWidth;
-			}
-		}
-
 		glEnableClientState(GL_VERTEX_ARRAY);
 		glVertexPointer(3, GL_FLOAT, 0, pVertList);
 		glEnableClientState(GL_TEXTURE_COORD_ARRAY);
 		glTexCoordPointer(2, GL_FLOAT, 0, pTextureCoordList);
-		glDrawArrays(GL_TRIANGLES, 0, count*6);
+		glDrawArrays(GL_TRIANGLES, 0, vertexCount);
 		glDisableClientState(GL_TEXTURE_COORD_ARRAY);
 		glDisableClientState(GL_VERTEX_ARRAY);
 
-		delete[] pVertList;
-		delete[] pTextureCoordList;
-
 		if(doOrthoProj)
 		{
 			glMatrixMode(GL_PROJECTION);
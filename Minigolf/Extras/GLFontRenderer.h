@@ -9,6 +9,8 @@
 #ifndef __GL_FONT_RENDERER__
 #define __GL_FONT_RENDERER__
 
+#include <vector>
+
 class GLFontRenderer{
 	
 private:
@@ -23,6 +25,10 @@ public:
 	
 	static bool init();
 	static void print(float x, float y, float fontSize, const char* pString, bool forceMonoSpace=false, int monoSpaceWidth=11, bool doOrthoProj=true);
+	// append the glyph triangles of a string in screen pixels, returns the number of vertices added
+	static unsigned int layout(float x, float y, float fontSize, const char* pString, std::vector<float>& vertList, std::vector<float>& textureCoordList, bool forceMonoSpace=false, int monoSpaceWidth=11);
+	// draw laid out glyphs with one call
+	static void draw(const float* pVertList, const float* pTextureCoordList, unsigned int vertexCount, bool doOrthoProj=true);
 	static void setScreenResolution(int screenWidth, int screenHeight);
 	static void setColor(float r, float g, float b, float a);
 	
@@ -12,14 +12,20 @@ namespace VisualDebugger
 	class HUDScreen
 	{
 		vector<string> content;
+		//glyphs of all lines, rebuilt when the text, the font size or the window changes
+		Renderer::TextLayout layout;
+		PxReal layout_font_size;
+		PxVec2 layout_position;
+		bool dirty;
 
 	public:
 		int id;
 		PxReal font_size;
 		PxVec3 color;
+		PxVec2 position;		// top left corner of the text, 0-1 across the window
 
 		HUDScreen(int screen_id, const PxVec3& _color=PxVec3(1.f,1.f,1.f), const PxReal& _font_size=0.024f) :
-			id(screen_id), color(_color), font_size(_font_size)
+			id(screen_id), color(_color), font_size(_font_size), position(0.01f, 0.98f), layout_font_size(0.f), layout_position(0.f, 0.f), dirty(true)
 		{
 		}
 
@@ -27,24 +33,37 @@ namespace VisualDebugger
 		void AddLine(string line)
 		{
 			content.push_back(line);
+			dirty = true;
 		}
 
 		///Change a line of text by index
 		void ChangeLine(string newText, PxReal idx) {
+			if (content[idx] == newText)
+				return;
 			content[idx] = newText;
+			dirty = true;
 		}
 		 
 		///Render the screen
 		void Render()
 		{
-			for (unsigned int i = 0; i < content.size(); i++)
-				Renderer::RenderText(content[i], PxVec2(0.01f, (1.f-(i+1)*font_size) - 0.02f), color, font_size);
+			if (dirty || (layout_font_size != font_size) || (layout_position != position) || !Renderer::TextCurrent(layout))
+			{
+				Renderer::ClearText(layout);
+				for (unsigned int i = 0; i < content.size(); i++)
+					Renderer::LayoutText(layout, content[i], PxVec2(position.x, position.y - (i+1)*font_size), font_size);
+				layout_font_size = font_size;
+				layout_position = position;
+				dirty = false;
+			}
+			Renderer::RenderText(layout, color);
 		}
 
 		///Clear content of the screen
 		void Clear()
 		{
 			content.clear();
+			dirty = true;
 		}
 	};
 
@@ -167,6 +186,16 @@ namespace VisualDebugger
 			}
 		}
 
+		///Change the position for a specified screen (-1 = all)
+		void Position(PxVec2 position, unsigned int screen_id=-1)
+		{
+			for (unsigned int i = 0; i < screens.size(); i++)
+			{
+				if ((screen_id == -1) || (screens[i]->id == screen_id))
+					screens[i]->position = position;
+			}
+		}
+
 		///Render the active screen
 		void Render()
 		{
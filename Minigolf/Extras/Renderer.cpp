@@ -1,7 +1,26 @@
 #include "Renderer.h"
 #include <iostream>
 #include <vector>
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+#include <mutex>
 #include "UserData.h"
+#include "..\Exception.h"
+
+#ifdef USE_OSMESA
+#include <GL/osmesa.h>
+#endif
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2)) || defined(__SSE2__)
+#define RENDERER_SSE2
+#include <emmintrin.h>
+#endif
+
+//GL 1.2 and the size argument of glColorPointer from GL_ARB_vertex_array_bgra
+#ifndef GL_BGRA
+#define GL_BGRA 0x80E1
+#endif
 
 using namespace std;
 
@@ -12,7 +31,257 @@ namespace VisualDebugger
 		PxVec4 default_color = PxVec4(0.8f, 0.8f, 0.8f, 1.0f);
 		PxVec3 background_color = PxVec3(0.f,0.f,0.f);
 		int render_detail = 10;
+		PxVec3 camera_eye = PxVec3(0.f, 0.f, 0.f);
+		PxVec3 camera_dir = PxVec3(0.f, 0.f, -1.f);
+		//level of detail, pose and render entry of the shape being drawn one by one
+		PxU32 current_lod = 0;
+		PxTransform current_pose = PxTransform(PxIdentity);
+		PxU32 current_id = RenderTable::NONE;
+		bool culling = true;
+		PxReal cull_distance = 0.f;
+
+		///View volume of the current frame, planes facing inwards
+		struct Frustum
+		{
+			PxVec3 normals[6];
+			PxReal offsets[6];
+
+			void Set(const PxVec3& eye, const PxVec3& dir, PxReal aspect, PxReal near_distance, PxReal far_distance)
+			{
+				const PxVec3 f = dir.getNormalized();
+				const PxVec3 r = f.cross(PxVec3(0.f, 1.f, 0.f)).getNormalized();
+				const PxVec3 u = r.cross(f);
+				const PxReal v = PxTan(PxPi / 6.f);
+				const PxReal h = v * aspect;
+
+				normals[0] = u.cross(f + r * h).getNormalized();		// right
+				normals[1] = (f - r * h).cross(u).getNormalized();		// left
+				normals[2] = (f + u * v).cross(r).getNormalized();		// top
+				normals[3] = r.cross(f - u * v).getNormalized();		// bottom
+				normals[4] = f;											// near
+				normals[5] = -f;										// far
+				for (PxU32 i = 0; i < 4; i++)
+					offsets[i] = -normals[i].dot(eye);
+				offsets[4] = -f.dot(eye + f * near_distance);
+				offsets[5] = f.dot(eye + f * far_distance);
+			}
+
+			///False if the box is completely outside a plane
+			bool Intersects(const PxBounds3& box) const
+			{
+				for (PxU32 i = 0; i < 6; i++)
+				{
+					const PxVec3& n = normals[i];
+					const PxVec3 corner(n.x >= 0.f ? box.maximum.x : box.minimum.x,
+						n.y >= 0.f ? box.maximum.y : box.minimum.y,
+						n.z >= 0.f ? box.maximum.z : box.minimum.z);
+					if (n.dot(corner) + offsets[i] < 0.f)
+						return false;
+				}
+				return true;
+			}
+		};
+
+		Frustum frustum;
+
+		///Inside the frustum and the cull distance
+		bool Visible(const PxBounds3& box)
+		{
+			if (!culling)
+				return true;
+			if (cull_distance > 0.f)
+			{
+				const PxVec3 nearest(PxClamp(camera_eye.x, box.minimum.x, box.maximum.x),
+					PxClamp(camera_eye.y, box.minimum.y, box.maximum.y),
+					PxClamp(camera_eye.z, box.minimum.z, box.maximum.z));
+				if ((nearest - camera_eye).magnitudeSquared() > cull_distance * cull_distance)
+					return false;
+			}
+			return frustum.Intersects(box);
+		}
 		bool show_shadows = true;
+		int window_width = 512;
+		int window_height = 512;
+		bool offscreen = false;
+		RenderStats stats = { 0, 0, 0, 0, 0, 0 };
+		bool shadow_pass = false;
+		//light direction of the planar shadows
+		const PxVec3 shadow_direction(-1.0f, -0.7071067f, 1.f);
+		bool retain_static = true;
+		bool batch_shapes = true;
+
+#ifdef USE_OSMESA
+		OSMesaContext osmesa_context = 0;
+		std::vector<GLubyte> osmesa_buffer;
+#endif
+
+		///Add to the submitted geometry counters
+		void Count(PxU32 draw_calls, PxU32 vertices)
+		{
+			stats.draw_calls += draw_calls;
+			stats.vertices += vertices;
+			if (shadow_pass)
+			{
+				stats.shadow_draw_calls += draw_calls;
+				stats.shadow_vertices += vertices;
+			}
+		}
+
+		///Shared shape of unit size, side moves capsule vertices to their end
+		struct UnitMesh
+		{
+			std::vector<PxVec3> positions;
+			std::vector<PxVec3> normals;
+			std::vector<PxReal> sides;
+			std::vector<GLuint> indices;
+
+			void Vertex(const PxVec3& position, const PxVec3& normal, PxReal side)
+			{
+				positions.push_back(position);
+				normals.push_back(normal);
+				sides.push_back(side);
+			}
+		};
+
+		///Shapes of one kind gathered for a single draw call
+		struct ShapeBatch
+		{
+			std::vector<PxVec3> positions;
+			std::vector<PxVec3> normals;
+			std::vector<PxVec4> colors;
+			std::vector<GLuint> indices;
+
+			void Clear()
+			{
+				positions.clear();
+				normals.clear();
+				colors.clear();
+				indices.clear();
+			}
+		};
+
+		enum BatchType { BATCH_BOX, BATCH_SPHERE, BATCH_CAPSULE, BATCH_TYPES };
+
+		//round shapes halve their tessellation at every level
+		const PxU32 lod_levels = 4;
+		UnitMesh unit_meshes[BATCH_TYPES][lod_levels];
+		int unit_detail = 0;
+		//opaque shapes first, then the translucent ones
+		ShapeBatch batches[2][BATCH_TYPES];
+
+		///Box with half extents of 1
+		void BuildUnitBox(UnitMesh& mesh)
+		{
+			for (PxU32 axis = 0; axis < 3; axis++)
+			{
+				for (int side = -1; side <= 1; side += 2)
+				{
+					PxVec3 n(0.f), u(0.f), v(0.f);
+					n[axis] = (PxReal)side;
+					u[(axis + 1) % 3] = (PxReal)side;
+					v[(axis + 2) % 3] = 1.f;
+					GLuint first = (GLuint)mesh.positions.size();
+					mesh.Vertex(n - u - v, n, 0.f);
+					mesh.Vertex(n + u - v, n, 0.f);
+					mesh.Vertex(n + u + v, n, 0.f);
+					mesh.Vertex(n - u + v, n, 0.f);
+					const GLuint quad[] = { 0, 1, 2, 0, 2, 3 };
+					for (PxU32 i = 0; i < 6; i++)
+						mesh.indices.push_back(first + quad[i]);
+				}
+			}
+		}
+
+		///Unit sphere around the x axis, split at x = 0 into halves that capsules pull apart
+		void BuildUnitRound(UnitMesh& mesh, bool cylinder, int detail)
+		{
+			const int slices = PxMax(detail, 3);
+			const int stacks = PxMax(detail / 2, 1) * 2;
+
+			//rings from +x to -x, the middle ring twice, once for each half
+			std::vector<GLuint> rings;
+			for (int i = 0; i <= stacks; i++)
+			{
+				const int copies = (i == stacks / 2) ? 2 : 1;
+				for (int c = 0; c < copies; c++)
+				{
+					const PxReal side = ((i < stacks / 2) || ((i == stacks / 2) && (c == 0))) ? 1.f : -1.f;
+					const PxReal theta = PxPi * i / stacks;
+					rings.push_back((GLuint)mesh.positions.size());
+					for (int j = 0; j <= slices; j++)
+					{
+						const PxReal phi = PxTwoPi * j / slices;
+						PxVec3 n(PxCos(theta), PxSin(theta) * PxCos(phi), PxSin(theta) * PxSin(phi));
+						mesh.Vertex(n, n, side);
+					}
+				}
+			}
+
+			for (PxU32 r = 0; r + 1 < rings.size(); r++)
+			{
+				//the band between the two middle rings is the capsule's cylinder
+				if ((r == (PxU32)stacks / 2) && !cylinder)
+					continue;
+				for (int j = 0; j < slices; j++)
+				{
+					const GLuint a = rings[r] + j, b = rings[r + 1] + j;
+					const GLuint quad[] = { a, b, b + 1, a, b + 1, a + 1 };
+					for (PxU32 i = 0; i < 6; i++)
+						mesh.indices.push_back(quad[i]);
+				}
+			}
+		}
+
+		///Tessellate the unit meshes for the current render detail
+		void BuildUnitMeshes()
+		{
+			if (unit_detail == render_detail)
+				return;
+			for (PxU32 level = 0; level < lod_levels; level++)
+			{
+				for (PxU32 i = 0; i < BATCH_TYPES; i++)
+					unit_meshes[i][level] = UnitMesh();
+				const int detail = PxMax(render_detail >> level, 4);
+				BuildUnitBox(unit_meshes[BATCH_BOX][level]);
+				BuildUnitRound(unit_meshes[BATCH_SPHERE][level], false, detail);
+				BuildUnitRound(unit_meshes[BATCH_CAPSULE][level], true, detail);
+			}
+			unit_detail = render_detail;
+		}
+
+		///Level of detail by the radius in pixels of a shape's bounding sphere,
+		///full detail from 48 pixels down to a quarter of it below 6
+		PxU32 SelectLod(const PxVec3& center, PxReal radius)
+		{
+			const PxReal distance = PxMax((center - camera_eye).magnitude(), 0.01f);
+			//the projection has a 60 degree vertical field of view
+			const PxReal pixels = radius * window_height / (2.f * PxTan(PxPi / 6.f) * distance);
+			if (pixels >= 48.f)
+				return 0;
+			if (pixels >= 16.f)
+				return 1;
+			if (pixels >= 6.f)
+				return 2;
+			return 3;
+		}
+
+		///Draw a unit mesh in the current frame, capsule halves moved apart by stretch
+		void DrawUnitMesh(const UnitMesh& mesh, PxReal scale, PxReal stretch)
+		{
+			static std::vector<PxVec3> positions;
+			positions.resize(mesh.positions.size());
+			for (PxU32 i = 0; i < positions.size(); i++)
+				positions[i] = mesh.positions[i] * scale + PxVec3(mesh.sides[i] * stretch, 0.f, 0.f);
+
+			glEnableClientState(GL_VERTEX_ARRAY);
+			glEnableClientState(GL_NORMAL_ARRAY);
+			glVertexPointer(3, GL_FLOAT, sizeof(PxVec3), &positions.front());
+			glNormalPointer(GL_FLOAT, sizeof(PxVec3), &mesh.normals.front());
+			glDrawElements(GL_TRIANGLES, (GLsizei)mesh.indices.size(), GL_UNSIGNED_INT, &mesh.indices.front());
+			glDisableClientState(GL_NORMAL_ARRAY);
+			glDisableClientState(GL_VERTEX_ARRAY);
+			Count(1, (PxU32)mesh.indices.size());
+		}
 
 		static float gPlaneData[]={
 			-1.f, 0.f, -1.f, 0.f, 1.f, 0.f, -1.f, 0.f, 1.f, 0.f, 1.f, 0.f,
@@ -30,205 +299,1245 @@ namespace VisualDebugger
 			glDrawArrays(GL_TRIANGLES, 0, 6);
 			glDisableClientState(GL_VERTEX_ARRAY);
 			glDisableClientState(GL_NORMAL_ARRAY);
+			Count(1, 6);
 		}
 
 		void DrawSphere(const PxGeometryHolder& geometry)
 		{
-			glutSolidSphere(geometry.sphere().radius, render_detail, render_detail);
+			BuildUnitMeshes();
+			DrawUnitMesh(unit_meshes[BATCH_SPHERE][current_lod], geometry.sphere().radius, 0.f);
 		}
 
 		void DrawBox(const PxGeometryHolder& geometry)
 		{
 			PxVec3 half_size = geometry.box().halfExtents;
 			glScalef(half_size.x, half_size.y, half_size.z);
-			glutSolidCube(2.f);		
+			BuildUnitMeshes();
+			DrawUnitMesh(unit_meshes[BATCH_BOX][0], 1.f, 0.f);
 		}
 
 		void DrawCapsule(const PxGeometryHolder& geometry)
 		{
-			const PxF32 radius = geometry.capsule().radius;
-			const PxF32 halfHeight = geometry.capsule().halfHeight;
+			BuildUnitMeshes();
+			DrawUnitMesh(unit_meshes[BATCH_CAPSULE][current_lod], geometry.capsule().radius, geometry.capsule().halfHeight);
+		}
+
+		void DrawConvexMesh(const PxGeometryHolder& geometry)
+		{
+			PxConvexMesh* mesh = geometry.convexMesh().convexMesh;
+			PxU32 num_polys = mesh->getNbPolygons();
+			const PxVec3* verts = mesh->getVertices();
+			const PxU8* indicies = mesh->getIndexBuffer();
+
+			for (PxU32 i = 0; i < num_polys; i++)
+			{
+				PxHullPolygon face;
+				if (mesh->getPolygonData(i,face))
+				{
+					glBegin(GL_POLYGON);
+					glNormal3f(face.mPlane[0],face.mPlane[1],face.mPlane[2]);
+					const PxU8* faceIdx = indicies + face.mIndexBase;
+					for (PxU32 j = 0; j < face.mNbVerts; j++)
+					{
+						PxVec3 v = verts[faceIdx[j]];
+						glVertex3f(v.x,v.y,v.z);
+					}
+					glEnd();
+					Count(1, face.mNbVerts);
+				}
+			}
+		}
+
+		///Display list of a triangle mesh, compiled the first time it is drawn and shared by its shapes
+		struct TriangleMeshList
+		{
+			GLuint list;
+			PxU32 triangles;
+			PxU32 vertices;
+		};
+
+		std::unordered_map<const PxTriangleMesh*, TriangleMeshList> triangle_mesh_lists;
+
+		///Index of a corner, the cooked mesh keeps 16 or 32 bit indices
+		inline PxU32 TriangleIndex(const PxTriangleMesh* mesh, PxU32 corner)
+		{
+			if (mesh->getTriangleMeshFlags() & PxTriangleMeshFlag::eHAS_16BIT_TRIANGLE_INDICES)
+				return ((const PxU16*)mesh->getTriangles())[corner];
+			return ((const PxU32*)mesh->getTriangles())[corner];
+		}
+
+		const TriangleMeshList& TriangleMeshListFor(const PxTriangleMesh* mesh)
+		{
+			TriangleMeshList& entry = triangle_mesh_lists[mesh];
+			if (entry.list)
+				return entry;
+
+			entry.triangles = mesh->getNbTriangles();
+			entry.vertices = mesh->getNbVertices();
+
+			//flat shaded, three corners of their own per triangle
+			const PxVec3* verts = mesh->getVertices();
+			std::vector<PxVec3> positions(entry.triangles * 3);
+			std::vector<PxVec3> normals(entry.triangles * 3);
+			for (PxU32 i = 0; i < entry.triangles * 3; i += 3)
+			{
+				const PxVec3 v0 = verts[TriangleIndex(mesh, i)];
+				const PxVec3 v1 = verts[TriangleIndex(mesh, i + 1)];
+				const PxVec3 v2 = verts[TriangleIndex(mesh, i + 2)];
+				const PxVec3 n = (v1 - v0).cross(v2 - v0).getNormalized();
+				positions[i] = v0;
+				positions[i + 1] = v1;
+				positions[i + 2] = v2;
+				normals[i] = normals[i + 1] = normals[i + 2] = n;
+			}
+
+			entry.list = glGenLists(1);
+			glEnableClientState(GL_VERTEX_ARRAY);
+			glEnableClientState(GL_NORMAL_ARRAY);
+			glVertexPointer(3, GL_FLOAT, sizeof(PxVec3), &positions.front());
+			glNormalPointer(GL_FLOAT, sizeof(PxVec3), &normals.front());
+			glNewList(entry.list, GL_COMPILE);
+			glDrawArrays(GL_TRIANGLES, 0, (GLsizei)positions.size());
+			glEndList();
+			glDisableClientState(GL_NORMAL_ARRAY);
+			glDisableClientState(GL_VERTEX_ARRAY);
+			return entry;
+		}
+
+		void DrawTriangleMesh(const PxGeometryHolder& geometry)
+		{
+			const PxTriangleMeshGeometry& mesh_geometry = geometry.triangleMesh();
+			const TriangleMeshList& list = TriangleMeshListFor(mesh_geometry.triangleMesh);
+
+			const bool scaled = !mesh_geometry.scale.isIdentity();
+			if (scaled)
+			{
+				PxMat44 scale(mesh_geometry.scale.toMat33(), PxVec3(0.f));
+				glPushMatrix();
+				glMultMatrixf((float*)&scale);
+			}
+			glCallList(list.list);
+			if (scaled)
+				glPopMatrix();
+			Count(1, list.triangles * 3);
+		}
+
+		///Heightfield samples as vertex arrays, drawn in square chunks with a level of detail each.
+		///
+		///Every chunk draws straight from the shared arrays, so the strip indices only depend
+		///on the chunk size and level. Skirts hanging from the chunk edges cover the cracks
+		///between neighbours drawn at different levels.
+		struct HeightFieldMesh
+		{
+			struct Chunk
+			{
+				PxU32 row, column;			// first sample
+				PxU32 rows, columns;		// cells
+				PxU32 first_skirt;			// first skirt vertex
+				PxBounds3 bounds;			// in the space of the shape
+			};
+
+			const PxHeightField* field;
+			PxU32 timestamp;
+			PxReal row_scale, height_scale, column_scale;
+			const std::vector<PxVec4>* material_colors;
+			PxU32 columns;							// samples per row, the row stride of the arrays
+			std::vector<PxVec3> positions;
+			std::vector<PxVec3> normals;
+			std::vector<PxVec4> colors;				// empty when drawn in the shape colour
+			std::vector<PxVec3> skirt_positions;	// top and bottom of every edge sample, interleaved
+			std::vector<PxVec3> skirt_normals;
+			std::vector<PxVec4> skirt_colors;
+			std::vector<Chunk> chunks;
+
+			HeightFieldMesh() : field(0), material_colors(0) {}
+		};
+
+		///Strip indices of one chunk size and level, relative to the first sample and skirt vertex
+		struct HeightFieldPattern
+		{
+			std::vector<PxU32> surface;
+			std::vector<PxU32> skirt;
+		};
+
+		static const PxU32 heightfield_chunk = 64;
+		static const PxU32 heightfield_levels = 4;
+		std::unordered_map<const PxHeightField*, HeightFieldMesh> heightfield_meshes;
+		std::unordered_map<PxU64, HeightFieldPattern> heightfield_patterns;
+
+		///Sample offsets along a chunk side at a level, the far edge always included
+		void LevelSteps(PxU32 cells, PxU32 step, std::vector<PxU32>& steps)
+		{
+			steps.clear();
+			for (PxU32 i = 0; i < cells; i += step)
+				steps.push_back(i);
+			steps.push_back(cells);
+		}
+
+		///Samples around the edge of a chunk, as row and column offsets
+		void ChunkEdge(PxU32 rows, PxU32 columns, std::vector<std::pair<PxU32, PxU32> >& edge)
+		{
+			edge.clear();
+			for (PxU32 c = 0; c < columns; c++)
+				edge.push_back(std::make_pair(0u, c));
+			for (PxU32 r = 0; r < rows; r++)
+				edge.push_back(std::make_pair(r, columns));
+			for (PxU32 c = columns; c > 0; c--)
+				edge.push_back(std::make_pair(rows, c));
+			for (PxU32 r = rows; r > 0; r--)
+				edge.push_back(std::make_pair(r, 0u));
+		}
+
+		const HeightFieldPattern& HeightFieldPatternFor(PxU32 rows, PxU32 columns, PxU32 stride, PxU32 level)
+		{
+			const PxU64 key = ((PxU64)stride << 32) | (rows << 16) | (columns << 2) | level;
+			HeightFieldPattern& pattern = heightfield_patterns[key];
+			if (pattern.surface.size())
+				return pattern;
+
+			const PxU32 step = 1 << level;
+			std::vector<PxU32> row_steps, column_steps;
+			LevelSteps(rows, step, row_steps);
+			LevelSteps(columns, step, column_steps);
+
+			//one strip, rows joined by two degenerate triangles; the row below comes first to face up
+			for (PxU32 i = 0; i + 1 < row_steps.size(); i++)
+			{
+				if (i > 0)
+				{
+					pattern.surface.push_back(pattern.surface.back());
+					pattern.surface.push_back(row_steps[i + 1] * stride);
+				}
+				for (PxU32 j = 0; j < column_steps.size(); j++)
+				{
+					pattern.surface.push_back(row_steps[i + 1] * stride + column_steps[j]);
+					pattern.surface.push_back(row_steps[i] * stride + column_steps[j]);
+				}
+			}
+
+			//the skirt follows the edge samples this level draws, back to the start
+			std::vector<std::pair<PxU32, PxU32> > edge;
+			ChunkEdge(rows, columns, edge);
+			for (PxU32 k = 0; k <= edge.size(); k++)
+			{
+				const std::pair<PxU32, PxU32>& sample = edge[k % edge.size()];
+				const bool on_row = (sample.first % step == 0) || (sample.first == rows);
+				const bool on_column = (sample.second % step == 0) || (sample.second == columns);
+				if (on_row && on_column)
+				{
+					pattern.skirt.push_back((k % edge.size()) * 2);
+					pattern.skirt.push_back((k % edge.size()) * 2 + 1);
+				}
+			}
+			return pattern;
+		}
+
+		///Vertex arrays of a heightfield, rebuilt when its samples, scale or colours change
+		HeightFieldMesh& HeightFieldMeshFor(const PxHeightFieldGeometry& geometry, PxU32 id)
+		{
+			const PxHeightField* field = geometry.heightField;
+			const std::vector<PxVec4>* material_colors = (id != RenderTable::NONE) ? RenderTable::MaterialColors(id) : 0;
+			HeightFieldMesh& mesh = heightfield_meshes[field];
+			if ((mesh.field == field) && (mesh.timestamp == field->getTimestamp()) && (mesh.material_colors == material_colors) &&
+				(mesh.row_scale == geometry.rowScale) && (mesh.height_scale == geometry.heightScale) && (mesh.column_scale == geometry.columnScale) &&
+				(mesh.columns == field->getNbColumns()) && (mesh.positions.size() == field->getNbRows() * field->getNbColumns()))
+				return mesh;
+
+			const PxU32 rows = field->getNbRows();
+			const PxU32 columns = field->getNbColumns();
+			mesh.field = field;
+			mesh.timestamp = field->getTimestamp();
+			mesh.row_scale = geometry.rowScale;
+			mesh.height_scale = geometry.heightScale;
+			mesh.column_scale = geometry.columnScale;
+			mesh.material_colors = material_colors;
+			mesh.columns = columns;
+
+			std::vector<PxHeightFieldSample> samples(rows * columns);
+			field->saveCells(&samples.front(), (PxU32)(samples.size() * sizeof(PxHeightFieldSample)));
+
+			mesh.positions.resize(samples.size());
+			for (PxU32 r = 0; r < rows; r++)
+			{
+				for (PxU32 c = 0; c < columns; c++)
+					mesh.positions[r * columns + c] = PxVec3(r * mesh.row_scale, samples[r * columns + c].height * mesh.height_scale, c * mesh.column_scale);
+			}
+
+			//central differences, one sided at the border
+			mesh.normals.resize(samples.size());
+			for (PxU32 r = 0; r < rows; r++)
+			{
+				const PxU32 r0 = (r > 0) ? r - 1 : r, r1 = PxMin(r + 1, rows - 1);
+				for (PxU32 c = 0; c < columns; c++)
+				{
+					const PxU32 c0 = (c > 0) ? c - 1 : c, c1 = PxMin(c + 1, columns - 1);
+					const PxReal dx = (mesh.positions[r1 * columns + c].y - mesh.positions[r0 * columns + c].y) / ((r1 - r0) * mesh.row_scale);
+					const PxReal dz = (mesh.positions[r * columns + c1].y - mesh.positions[r * columns + c0].y) / ((c1 - c0) * mesh.column_scale);
+					mesh.normals[r * columns + c] = PxVec3(-dx, 1.f, -dz).getNormalized();
+				}
+			}
+
+			mesh.colors.clear();
+			if (material_colors && material_colors->size())
+			{
+				mesh.colors.resize(samples.size());
+				for (PxU32 i = 0; i < samples.size(); i++)
+				{
+					const PxU8 material = samples[i].materialIndex0;
+					mesh.colors[i] = (*material_colors)[(material < material_colors->size()) ? material : 0];
+				}
+			}
+
+			mesh.chunks.clear();
+			mesh.skirt_positions.clear();
+			mesh.skirt_normals.clear();
+			mesh.skirt_colors.clear();
+			std::vector<std::pair<PxU32, PxU32> > edge;
+			for (PxU32 r = 0; r + 1 < rows; r += heightfield_chunk)
+			{
+				for (PxU32 c = 0; c + 1 < columns; c += heightfield_chunk)
+				{
+					HeightFieldMesh::Chunk chunk = { r, c, PxMin(heightfield_chunk, rows - 1 - r), PxMin(heightfield_chunk, columns - 1 - c),
+						(PxU32)mesh.skirt_positions.size(), PxBounds3::empty() };
+					for (PxU32 i = 0; i <= chunk.rows; i++)
+					{
+						for (PxU32 j = 0; j <= chunk.columns; j++)
+							chunk.bounds.include(mesh.positions[(r + i) * columns + c + j]);
+					}
+
+					//deep enough to cover any neighbour within the chunk's own height range
+					const PxReal bottom = chunk.bounds.minimum.y - 0.1f;
+					ChunkEdge(chunk.rows, chunk.columns, edge);
+					for (PxU32 k = 0; k < edge.size(); k++)
+					{
+						const PxU32 index = (r + edge[k].first) * columns + c + edge[k].second;
+						const PxVec3& top = mesh.positions[index];
+						mesh.skirt_positions.push_back(top);
+						mesh.skirt_positions.push_back(PxVec3(top.x, bottom, top.z));
+						mesh.skirt_normals.push_back(mesh.normals[index]);
+						mesh.skirt_normals.push_back(mesh.normals[index]);
+						if (mesh.colors.size())
+						{
+							mesh.skirt_colors.push_back(mesh.colors[index]);
+							mesh.skirt_colors.push_back(mesh.colors[index]);
+						}
+					}
+					chunk.bounds.minimum.y = bottom;
+					mesh.chunks.push_back(chunk);
+				}
+			}
+			return mesh;
+		}
+
+		///Meshes and heightfields the SDK has freed, reported from any thread and dropped
+		///from the caches on the render thread before their address can be reused
+		class ReleasedGeometry : public PxDeletionListener
+		{
+		public:
+			std::mutex lock;
+			std::vector<const PxBase*> released;
+
+			virtual void onRelease(const PxBase* observed, void*, PxDeletionEventFlag::Enum)
+			{
+				if (observed->is<PxHeightField>() || observed->is<PxTriangleMesh>())
+				{
+					std::lock_guard<std::mutex> guard(lock);
+					released.push_back(observed);
+				}
+			}
+		};
+
+		ReleasedGeometry released_geometry;
+		PxPhysics* released_geometry_physics = 0;
+
+		void DropReleasedGeometry()
+		{
+			std::vector<const PxBase*> released;
+			{
+				std::lock_guard<std::mutex> guard(released_geometry.lock);
+				released.swap(released_geometry.released);
+			}
+			for (PxU32 i = 0; i < released.size(); i++)
+			{
+				if (released[i]->is<PxHeightField>())
+				{
+					heightfield_meshes.erase(static_cast<const PxHeightField*>(released[i]));
+					continue;
+				}
+				std::unordered_map<const PxTriangleMesh*, TriangleMeshList>::iterator list = triangle_mesh_lists.find(static_cast<const PxTriangleMesh*>(released[i]));
+				if (list == triangle_mesh_lists.end())
+					continue;
+				glDeleteLists(list->second.list, 1);
+				triangle_mesh_lists.erase(list);
+			}
+		}
+
+		void DrawHeightField(const PxGeometryHolder& geometry)
+		{
+			HeightFieldMesh& mesh = HeightFieldMeshFor(geometry.heightField(), current_id);
+			const bool colored = mesh.colors.size() > 0;
+			//the camera in the space of the shape
+			const PxVec3 eye = current_pose.transformInv(camera_eye);
+			const PxReal cell_size = PxMax(mesh.row_scale, mesh.column_scale);
+
+			glEnableClientState(GL_VERTEX_ARRAY);
+			glEnableClientState(GL_NORMAL_ARRAY);
+			if (colored)
+				glEnableClientState(GL_COLOR_ARRAY);
+
+			for (PxU32 i = 0; i < mesh.chunks.size(); i++)
+			{
+				const HeightFieldMesh::Chunk& chunk = mesh.chunks[i];
+				if (!Visible(PxBounds3::transformFast(current_pose, chunk.bounds)))
+					continue;
+
+				//coarser while a cell would still cover a few pixels, like SelectLod
+				const PxVec3 nearest(PxClamp(eye.x, chunk.bounds.minimum.x, chunk.bounds.maximum.x),
+					PxClamp(eye.y, chunk.bounds.minimum.y, chunk.bounds.maximum.y),
+					PxClamp(eye.z, chunk.bounds.minimum.z, chunk.bounds.maximum.z));
+				const PxReal distance = PxMax((nearest - eye).magnitude(), 0.01f);
+				const PxReal pixels = cell_size * window_height / (2.f * PxTan(PxPi / 6.f) * distance);
+				PxU32 level = 0;
+				while ((level + 1 < heightfield_levels) && (pixels * (2 << level) < 8.f))
+					level++;
+
+				const HeightFieldPattern& pattern = HeightFieldPatternFor(chunk.rows, chunk.columns, mesh.columns, level);
+				const PxU32 first = chunk.row * mesh.columns + chunk.column;
+				glVertexPointer(3, GL_FLOAT, sizeof(PxVec3), &mesh.positions[first]);
+				glNormalPointer(GL_FLOAT, sizeof(PxVec3), &mesh.normals[first]);
+				if (colored)
+					glColorPointer(4, GL_FLOAT, sizeof(PxVec4), &mesh.colors[first]);
+				glDrawElements(GL_TRIANGLE_STRIP, (GLsizei)pattern.surface.size(), GL_UNSIGNED_INT, &pattern.surface.front());
+
+				glVertexPointer(3, GL_FLOAT, sizeof(PxVec3), &mesh.skirt_positions[chunk.first_skirt]);
+				glNormalPointer(GL_FLOAT, sizeof(PxVec3), &mesh.skirt_normals[chunk.first_skirt]);
+				if (colored)
+					glColorPointer(4, GL_FLOAT, sizeof(PxVec4), &mesh.skirt_colors[chunk.first_skirt]);
+				glDrawElements(GL_TRIANGLE_STRIP, (GLsizei)pattern.skirt.size(), GL_UNSIGNED_INT, &pattern.skirt.front());
+
+				Count(2, (PxU32)(pattern.surface.size() + pattern.skirt.size()));
+			}
+
+			if (colored)
+				glDisableClientState(GL_COLOR_ARRAY);
+			glDisableClientState(GL_NORMAL_ARRAY);
+			glDisableClientState(GL_VERTEX_ARRAY);
+		}
+
+		void RenderGeometry(const PxGeometryHolder& geometry)
+		{
+			switch(geometry.getType())
+			{
+			case PxGeometryType::ePLANE:
+				DrawPlane();
+				break;
+			case PxGeometryType::eSPHERE:
+				DrawSphere(geometry);
+				break;
+			case PxGeometryType::eBOX:			
+				DrawBox(geometry);
+				break;
+			case PxGeometryType::eCAPSULE:
+				DrawCapsule(geometry);
+				break;
+			case PxGeometryType::eCONVEXMESH:
+				DrawConvexMesh(geometry);
+				break;
+			case PxGeometryType::eTRIANGLEMESH:
+				DrawTriangleMesh(geometry);
+				break;
+			case PxGeometryType::eHEIGHTFIELD:
+				DrawHeightField(geometry);
+				break;
+			default:
+				break;
+			}
+		}
+
+		///Positions and normals of a cloth, kept between frames
+		struct ClothBuffers
+		{
+			std::vector<PxVec4> positions;		// inverse weight in w, not drawn
+			std::vector<PxVec4> normals;
+			const PxCloth* cloth;
+			bool asleep;						// built after the cloth fell asleep
+		};
+
+		static_assert(sizeof(PxClothParticle) == sizeof(PxVec4), "PxClothParticle layout changed");
+
+		std::unordered_map<PxU32, ClothBuffers> cloth_buffers;
+		bool cache_sleeping_cloth = true;
+
+		///Sum the face normals of the quads into their corners and normalise
+		void BuildClothNormals(ClothBuffers& buffers, const PxU32* quads, PxU32 quad_count)
+		{
+			const PxU32 count = (PxU32)buffers.positions.size();
+			buffers.normals.assign(count, PxVec4(0.f));
+			const PxVec4* p = &buffers.positions.front();
+			PxVec4* n = &buffers.normals.front();
+
+#ifdef RENDERER_SSE2
+			for (PxU32 i = 0; i < quad_count * 4; i += 4)
+			{
+				const __m128 v0 = _mm_loadu_ps(&p[quads[i]].x);
+				const __m128 a = _mm_sub_ps(_mm_loadu_ps(&p[quads[i + 2]].x), v0);
+				const __m128 b = _mm_sub_ps(_mm_loadu_ps(&p[quads[i + 1]].x), v0);
+				//a x b, the w lanes cancel out
+				const __m128 a_yzx = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1));
+				const __m128 b_yzx = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1));
+				const __m128 c = _mm_sub_ps(_mm_mul_ps(a, b_yzx), _mm_mul_ps(a_yzx, b));
+				const __m128 face = _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 0, 2, 1));
+				for (PxU32 k = 0; k < 4; k++)
+				{
+					float* corner = &n[quads[i + k]].x;
+					_mm_storeu_ps(corner, _mm_add_ps(_mm_loadu_ps(corner), face));
+				}
+			}
+
+			//four normals at a time, transposed to x, y, z and w rows
+			PxU32 i = 0;
+			for (; i + 4 <= count; i += 4)
+			{
+				__m128 x = _mm_loadu_ps(&n[i].x);
+				__m128 y = _mm_loadu_ps(&n[i + 1].x);
+				__m128 z = _mm_loadu_ps(&n[i + 2].x);
+				__m128 w = _mm_loadu_ps(&n[i + 3].x);
+				_MM_TRANSPOSE4_PS(x, y, z, w);
+				__m128 length2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z));
+				length2 = _mm_max_ps(length2, _mm_set1_ps(1e-20f));
+				//one Newton step on top of the estimate
+				__m128 inverse = _mm_rsqrt_ps(length2);
+				inverse = _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(0.5f), inverse),
+					_mm_sub_ps(_mm_set1_ps(3.f), _mm_mul_ps(_mm_mul_ps(length2, inverse), inverse)));
+				x = _mm_mul_ps(x, inverse);
+				y = _mm_mul_ps(y, inverse);
+				z = _mm_mul_ps(z, inverse);
+				_MM_TRANSPOSE4_PS(x, y, z, w);
+				_mm_storeu_ps(&n[i].x, x);
+				_mm_storeu_ps(&n[i + 1].x, y);
+				_mm_storeu_ps(&n[i + 2].x, z);
+				_mm_storeu_ps(&n[i + 3].x, w);
+			}
+			for (; i < count; i++)
+				n[i] = PxVec4(n[i].getXYZ().getNormalized(), 0.f);
+#else
+			for (PxU32 i = 0; i < quad_count * 4; i += 4)
+			{
+				const PxVec3 v0 = p[quads[i]].getXYZ();
+				const PxVec3 face = (p[quads[i + 2]].getXYZ() - v0).cross(p[quads[i + 1]].getXYZ() - v0);
+				for (PxU32 k = 0; k < 4; k++)
+					n[quads[i + k]] += PxVec4(face, 0.f);
+			}
+			for (PxU32 i = 0; i < count; i++)
+				n[i] = PxVec4(n[i].getXYZ().getNormalized(), 0.f);
+#endif
+		}
+
+		///Draw a cloth from its particles, read from the live cloth when particles is 0
+		void RenderCloth(const PxCloth* cloth, PxU32 id, const PxTransform& pose, bool sleeping, PxU32 particle_count, const void* particles)
+		{
+			PxClothMeshDesc* mesh_desc = RenderTable::ClothMesh(id);
+			PxVec4* color = &RenderTable::Color(id);
+
+			PxU32 quad_count = mesh_desc->quads.count;
+			PxU32* quads = (PxU32*)mesh_desc->quads.data;
+
+			ClothBuffers& buffers = cloth_buffers[id];
+			const bool asleep = cache_sleeping_cloth && sleeping;
+			const bool cached = (buffers.cloth == cloth) && (buffers.positions.size() == particle_count) && buffers.asleep;
+
+			//a sleeping cloth does not move, keep what was built once it fell asleep
+			if (!(asleep && cached))
+			{
+				PxClothParticleData* particle_data = 0;
+				if (!particles)
+				{
+					particle_data = cloth->lockParticleData();
+					if (!particle_data)
+						return;
+					particles = particle_data->particles;
+				}
+				buffers.positions.resize(particle_count);
+				if (particle_count)
+					memcpy(&buffers.positions.front(), particles, particle_count * sizeof(PxClothParticle));
+				if (particle_data)
+					particle_data->unlock();
+
+				buffers.cloth = cloth;
+				buffers.asleep = asleep;
+				if (particle_count)
+					BuildClothNormals(buffers, quads, quad_count);
+			}
+			if (!particle_count)
+				return;
+
+			PxMat44 shapePose(pose);
+
+			glColor4f(color->x, color->y, color->z, color->w);
+
+			glPushMatrix();						
+			glMultMatrixf((float*)&shapePose);
+
+			glEnableClientState(GL_VERTEX_ARRAY);
+			glEnableClientState(GL_NORMAL_ARRAY);
+
+			glVertexPointer(3, GL_FLOAT, sizeof(PxVec4), &buffers.positions.front());
+			glNormalPointer(GL_FLOAT, sizeof(PxVec4), &buffers.normals.front());
+
+			glDrawElements(GL_QUADS, quad_count*4, GL_UNSIGNED_INT, quads);
+			Count(1, quad_count*4);
+
+			glDisableClientState(GL_NORMAL_ARRAY);
+			glDisableClientState(GL_VERTEX_ARRAY);
+
+			glPopMatrix();
+		}
+
+		void RenderCloth(const PxCloth* cloth)
+		{
+			RenderCloth(cloth, RenderTable::FromUserData(cloth->userData), cloth->getGlobalPose(), cloth->isSleeping(), cloth->getNbParticles(), 0);
+		}
+
+		///Static shapes merged by area, kept in display lists
+		struct StaticChunk
+		{
+			///A shape of the chunk and the colour its vertices were baked with
+			struct Part
+			{
+				PxU32 id;
+				PxU32 first_vertex;
+				PxU32 vertex_count;
+				PxVec4 color;
+			};
+
+			std::vector<PxVec3> positions;
+			std::vector<PxVec3> normals;
+			std::vector<PxVec4> colors;
+			std::vector<GLuint> indices;
+			std::vector<Part> parts;
+			PxBounds3 bounds;
+			GLuint list;
+
+			StaticChunk() : bounds(PxBounds3::empty()), list(0) {}
+		};
+
+		///Bounding volume tree over the static chunks, leaves hold one chunk
+		struct ChunkNode
+		{
+			PxBounds3 bounds;
+			int children[2];
+			int chunk;
+		};
+
+		const PxReal static_chunk_size = 32.f;
+		std::vector<StaticChunk> static_chunks;
+		std::vector<ChunkNode> chunk_tree;
+		std::vector<PxU32> visible_chunks;
+		GLuint static_shadow_texture = 0;
+		PxBounds3 static_shadow_bounds;
+
+		///Colour to draw with, highlighted shapes brighter
+		PxVec4 DrawColor(PxVec4 color, PxU32 flags)
+		{
+			if (flags & RenderTable::HIGHLIGHT)
+				color += PxVec4(.2f, .2f, .2f, 1.0f);
+			return color;
+		}
+
+		PxVec4 ShapeColor(PxU32 id)
+		{
+			return DrawColor(RenderTable::Color(id), RenderTable::Flags(id));
+		}
+
+		///Append one face, a convex polygon
+		void AddPolygon(StaticChunk& chunk, const PxVec3* verts, PxU32 count, const PxVec3& normal)
+		{
+			GLuint first = (GLuint)chunk.positions.size();
+			for (PxU32 i = 0; i < count; i++)
+			{
+				chunk.positions.push_back(verts[i]);
+				chunk.normals.push_back(normal);
+			}
+			for (PxU32 i = 2; i < count; i++)
+			{
+				chunk.indices.push_back(first);
+				chunk.indices.push_back(first + i - 1);
+				chunk.indices.push_back(first + i);
+			}
+		}
+
+		///Append the faces of a shape in world space, false for shapes drawn one by one
+		bool AddShape(StaticChunk& chunk, const PxShape* shape, const PxTransform& pose)
+		{
+			PxGeometryHolder h = shape->getGeometry();
+			switch (h.getType())
+			{
+			case PxGeometryType::eBOX:
+			{
+				const PxVec3 half_size = h.box().halfExtents;
+				for (PxU32 axis = 0; axis < 3; axis++)
+				{
+					for (int side = -1; side <= 1; side += 2)
+					{
+						PxVec3 n(0.f), u(0.f), v(0.f);
+						n[axis] = (PxReal)side;
+						u[(axis + 1) % 3] = (PxReal)side;
+						v[(axis + 2) % 3] = 1.f;
+						PxVec3 c = n.multiply(half_size);
+						u = u.multiply(half_size);
+						v = v.multiply(half_size);
+						PxVec3 face[4] = { pose.transform(c - u - v), pose.transform(c + u - v), pose.transform(c + u + v), pose.transform(c - u + v) };
+						AddPolygon(chunk, face, 4, pose.q.rotate(n));
+					}
+				}
+				return true;
+			}
+			case PxGeometryType::eCONVEXMESH:
+			{
+				PxConvexMesh* mesh = h.convexMesh().convexMesh;
+				const PxVec3* verts = mesh->getVertices();
+				const PxU8* indicies = mesh->getIndexBuffer();
+				std::vector<PxVec3> face;
+				for (PxU32 i = 0; i < mesh->getNbPolygons(); i++)
+				{
+					PxHullPolygon polygon;
+					if (!mesh->getPolygonData(i, polygon))
+						continue;
+					face.clear();
+					for (PxU32 j = 0; j < polygon.mNbVerts; j++)
+						face.push_back(pose.transform(verts[indicies[polygon.mIndexBase + j]]));
+					AddPolygon(chunk, &face.front(), (PxU32)face.size(),
+						pose.q.rotate(PxVec3(polygon.mPlane[0], polygon.mPlane[1], polygon.mPlane[2])));
+				}
+				return true;
+			}
+			case PxGeometryType::eTRIANGLEMESH:
+			{
+				PxTriangleMesh* mesh = h.triangleMesh().triangleMesh;
+				const PxVec3* verts = mesh->getVertices();
+				const PxMat33 scale = h.triangleMesh().scale.toMat33();
+				for (PxU32 i = 0; i < mesh->getNbTriangles() * 3; i += 3)
+				{
+					PxVec3 face[3];
+					for (PxU32 j = 0; j < 3; j++)
+						face[j] = pose.transform(scale * verts[TriangleIndex(mesh, i + j)]);
+					AddPolygon(chunk, face, 3, (face[1] - face[0]).cross(face[2] - face[0]).getNormalized());
+				}
+				return true;
+			}
+			default:
+				return false;
+			}
+		}
+
+		///Recompile the display lists of a chunk from its arrays
+		void CompileChunk(StaticChunk& chunk)
+		{
+			if (!chunk.list)
+				chunk.list = glGenLists(1);
+
+			glEnableClientState(GL_VERTEX_ARRAY);
+			glEnableClientState(GL_NORMAL_ARRAY);
+			glEnableClientState(GL_COLOR_ARRAY);
+			glVertexPointer(3, GL_FLOAT, sizeof(PxVec3), &chunk.positions.front());
+			glNormalPointer(GL_FLOAT, sizeof(PxVec3), &chunk.normals.front());
+			glColorPointer(4, GL_FLOAT, sizeof(PxVec4), &chunk.colors.front());
+
+			glNewList(chunk.list, GL_COMPILE);
+			glDrawElements(GL_TRIANGLES, (GLsizei)chunk.indices.size(), GL_UNSIGNED_INT, &chunk.indices.front());
+			glEndList();
+
+			glDisableClientState(GL_COLOR_ARRAY);
+			glDisableClientState(GL_NORMAL_ARRAY);
+			glDisableClientState(GL_VERTEX_ARRAY);
+		}
+
+		///Split the chunks at the median of their longest axis, returns the node index
+		int BuildChunkTree(std::vector<PxU32>& chunks, PxU32 first, PxU32 count)
+		{
+			ChunkNode node;
+			node.bounds = PxBounds3::empty();
+			node.children[0] = node.children[1] = -1;
+			node.chunk = -1;
+			for (PxU32 i = first; i < first + count; i++)
+				node.bounds.include(static_chunks[chunks[i]].bounds);
+
+			const int index = (int)chunk_tree.size();
+			chunk_tree.push_back(node);
+			if (count == 1)
+			{
+				chunk_tree[index].chunk = chunks[first];
+				return index;
+			}
+
+			const PxVec3 extents = node.bounds.getExtents();
+			const PxU32 axis = (extents.x > extents.z) ? 0 : 2;
+			std::sort(chunks.begin() + first, chunks.begin() + first + count, [axis](PxU32 a, PxU32 b) {
+				return static_chunks[a].bounds.getCenter()[axis] < static_chunks[b].bounds.getCenter()[axis];
+			});
+			const int left = BuildChunkTree(chunks, first, count / 2);
+			const int right = BuildChunkTree(chunks, first + count / 2, count - count / 2);
+			chunk_tree[index].children[0] = left;
+			chunk_tree[index].children[1] = right;
+			return index;
+		}
+
+		///Shapes under a node, for the culling counters
+		PxU32 CountParts(const ChunkNode& node)
+		{
+			if (node.chunk >= 0)
+				return (PxU32)static_chunks[node.chunk].parts.size();
+			return CountParts(chunk_tree[node.children[0]]) + CountParts(chunk_tree[node.children[1]]);
+		}
+
+		///Collect the chunks in view, skipping whole branches outside it
+		void CullChunks()
+		{
+			visible_chunks.clear();
+			if (chunk_tree.empty())
+				return;
+
+			int stack[64];
+			int depth = 0;
+			stack[depth++] = 0;
+			while (depth)
+			{
+				const ChunkNode& node = chunk_tree[stack[--depth]];
+				if (!Visible(node.bounds))
+				{
+					stats.culled_shapes += CountParts(node);
+					continue;
+				}
+				if (node.chunk >= 0)
+					visible_chunks.push_back(node.chunk);
+				else
+				{
+					stack[depth++] = node.children[0];
+					stack[depth++] = node.children[1];
+				}
+			}
+		}
+
+		///Cast along the shadow direction onto the y = 0 plane
+		PxVec3 ProjectShadow(const PxVec3& p)
+		{
+			return PxVec3(p.x - shadow_direction.x * p.y / shadow_direction.y, 0.f, p.z - shadow_direction.z * p.y / shadow_direction.y);
+		}
+
+		///Rasterise the shadows of the static chunks into a ground texture, drawn as one quad
+		void BakeStaticShadows()
+		{
+			PxBounds3 bounds = PxBounds3::empty();
+			for (PxU32 i = 0; i < static_chunks.size(); i++)
+			{
+				for (PxU32 j = 0; j < static_chunks[i].positions.size(); j++)
+					bounds.include(ProjectShadow(static_chunks[i].positions[j]));
+			}
+			if (bounds.isEmpty())
+				return;
+
+			//about ten texels per unit, power of two sides for GL 1.x
+			const PxReal margin = 1.f;
+			bounds.minimum -= PxVec3(margin, 0.f, margin);
+			bounds.maximum += PxVec3(margin, 0.f, margin);
+			PxU32 width = 64, height = 64;
+			while ((width < 2048) && (width < (bounds.maximum.x - bounds.minimum.x) * 10.f))
+				width *= 2;
+			while ((height < 2048) && (height < (bounds.maximum.z - bounds.minimum.z) * 10.f))
+				height *= 2;
+			const PxReal texel_x = (bounds.maximum.x - bounds.minimum.x) / width;
+			const PxReal texel_z = (bounds.maximum.z - bounds.minimum.z) / height;
+
+			std::vector<GLubyte> mask(width * height, 0);
+			for (PxU32 i = 0; i < static_chunks.size(); i++)
+			{
+				const StaticChunk& chunk = static_chunks[i];
+				for (PxU32 j = 0; j < chunk.indices.size(); j += 3)
+				{
+					//faces turned away from the light are covered by the others
+					if (chunk.normals[chunk.indices[j]].dot(shadow_direction) > 0.f)
+						continue;
+
+					PxVec3 t[3];
+					for (PxU32 k = 0; k < 3; k++)
+					{
+						PxVec3 p = ProjectShadow(chunk.positions[chunk.indices[j + k]]);
+						t[k] = PxVec3((p.x - bounds.minimum.x) / texel_x, (p.z - bounds.minimum.z) / texel_z, 0.f);
+					}
+					const PxReal area = (t[1].x - t[0].x) * (t[2].y - t[0].y) - (t[1].y - t[0].y) * (t[2].x - t[0].x);
+					if (PxAbs(area) < 1e-6f)
+						continue;
+
+					const int x0 = PxMax((int)PxFloor(PxMin(t[0].x, PxMin(t[1].x, t[2].x))), 0);
+					const int x1 = PxMin((int)PxCeil(PxMax(t[0].x, PxMax(t[1].x, t[2].x))), (int)width - 1);
+					const int y0 = PxMax((int)PxFloor(PxMin(t[0].y, PxMin(t[1].y, t[2].y))), 0);
+					const int y1 = PxMin((int)PxCeil(PxMax(t[0].y, PxMax(t[1].y, t[2].y))), (int)height - 1);
+					for (int y = y0; y <= y1; y++)
+					{
+						for (int x = x0; x <= x1; x++)
+						{
+							const PxReal px = x + .5f, py = y + .5f;
+							bool inside = true;
+							for (PxU32 k = 0; k < 3; k++)
+							{
+								const PxVec3& a = t[k];
+								const PxVec3& b = t[(k + 1) % 3];
+								if (((b.x - a.x) * (py - a.y) - (b.y - a.y) * (px - a.x)) * area < 0.f)
+									inside = false;
+							}
+							if (inside)
+								mask[y * width + x] = 255;
+						}
+					}
+				}
+			}
+
+			glGenTextures(1, &static_shadow_texture);
+			glBindTexture(GL_TEXTURE_2D, static_shadow_texture);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_ALPHA, width, height, 0, GL_ALPHA, GL_UNSIGNED_BYTE, &mask.front());
+			glBindTexture(GL_TEXTURE_2D, 0);
+			static_shadow_bounds = bounds;
+		}
+
+		///Draw the baked static shadows, one textured quad on the ground
+		void RenderStaticShadows(const PxVec4& shadow_color)
+		{
+			if (!static_shadow_texture)
+				return;
+
+			const PxVec3& a = static_shadow_bounds.minimum;
+			const PxVec3& b = static_shadow_bounds.maximum;
+			glDisable(GL_LIGHTING);
+			glEnable(GL_TEXTURE_2D);
+			glBindTexture(GL_TEXTURE_2D, static_shadow_texture);
+			glEnable(GL_ALPHA_TEST);
+			glAlphaFunc(GL_GREATER, .5f);
+			glColor4f(shadow_color.x, shadow_color.y, shadow_color.z, shadow_color.w);
+			glBegin(GL_QUADS);
+			glTexCoord2f(0.f, 0.f); glVertex3f(a.x, 0.f, a.z);
+			glTexCoord2f(0.f, 1.f); glVertex3f(a.x, 0.f, b.z);
+			glTexCoord2f(1.f, 1.f); glVertex3f(b.x, 0.f, b.z);
+			glTexCoord2f(1.f, 0.f); glVertex3f(b.x, 0.f, a.z);
+			glEnd();
+			shadow_pass = true;
+			Count(1, 4);
+			shadow_pass = false;
+			glDisable(GL_ALPHA_TEST);
+			glBindTexture(GL_TEXTURE_2D, 0);
+			glDisable(GL_TEXTURE_2D);
+			glEnable(GL_LIGHTING);
+		}
+
+		void ReleaseStatic()
+		{
+			for (PxU32 i = 0; i < static_chunks.size(); i++)
+			{
+				if (static_chunks[i].list)
+					glDeleteLists(static_chunks[i].list, 1);
+			}
+			static_chunks.clear();
+			chunk_tree.clear();
+			heightfield_meshes.clear();
+			for (std::unordered_map<const PxTriangleMesh*, TriangleMeshList>::iterator i = triangle_mesh_lists.begin(); i != triangle_mesh_lists.end(); ++i)
+				glDeleteLists(i->second.list, 1);
+			triangle_mesh_lists.clear();
+			if (static_shadow_texture)
+				glDeleteTextures(1, &static_shadow_texture);
+			static_shadow_texture = 0;
+		}
+
+		void BuildStatic(PxActor** actors, const PxU32 numActors)
+		{
+			ReleaseStatic();
+
+			//chunk index of every occupied grid cell
+			std::vector<std::pair<std::pair<int, int>, PxU32> > cells;
+
+			for (PxU32 i = 0; i < numActors; i++)
+			{
+				if (actors[i]->getType() != PxActorType::eRIGID_STATIC)
+					continue;
+
+				PxRigidActor* rigid_actor = (PxRigidActor*)actors[i];
+				PxVec3 center = rigid_actor->getGlobalPose().p;
+				std::pair<int, int> cell((int)PxFloor(center.x / static_chunk_size), (int)PxFloor(center.z / static_chunk_size));
+
+				PxU32 chunk_index = (PxU32)static_chunks.size();
+				for (PxU32 j = 0; j < cells.size(); j++)
+				{
+					if (cells[j].first == cell)
+						chunk_index = cells[j].second;
+				}
+
+				std::vector<PxShape*> shapes(rigid_actor->getNbShapes());
+				rigid_actor->getShapes((PxShape**)&shapes.front(), (PxU32)shapes.size());
+
+				for (PxU32 j = 0; j < shapes.size(); j++)
+				{
+					PxU32 id = RenderTable::FromUserData(shapes[j]->userData);
+					if (id == RenderTable::NONE)
+						continue;
+
+					if (chunk_index == static_chunks.size())
+					{
+						static_chunks.push_back(StaticChunk());
+						cells.push_back(std::make_pair(cell, chunk_index));
+					}
 
-			//Sphere
-			glPushMatrix();
-			glTranslatef(halfHeight,0.f, 0.f);
-			glutSolidSphere(radius, render_detail, render_detail);		
-			glPopMatrix();
+					StaticChunk& chunk = static_chunks[chunk_index];
+					StaticChunk::Part part = { id, (PxU32)chunk.positions.size(), 0, ShapeColor(id) };
+					if (!AddShape(chunk, shapes[j], PxShapeExt::getGlobalPose(*shapes[j], *rigid_actor)))
+						continue;
+
+					part.vertex_count = (PxU32)chunk.positions.size() - part.first_vertex;
+					for (PxU32 k = part.first_vertex; k < chunk.positions.size(); k++)
+						chunk.bounds.include(chunk.positions[k]);
+					chunk.colors.resize(chunk.positions.size(), part.color);
+					chunk.parts.push_back(part);
+					RenderTable::Flags(id) |= RenderTable::RETAINED;
+				}
+			}
 
-			//Sphere
-			glPushMatrix();
-			glTranslatef(-halfHeight,0.f,0.f);
-			glutSolidSphere(radius, render_detail, render_detail);		
-			glPopMatrix();
+			//a chunk of planes only stays empty
+			for (PxU32 i = 0; i < static_chunks.size(); i++)
+			{
+				if (static_chunks[i].indices.size())
+					CompileChunk(static_chunks[i]);
+			}
 
-			//Cylinder
-			glPushMatrix();
-			glTranslatef(-halfHeight,0.f,0.f);
-			glRotatef(90.f,0.f,1.f,0.f);
+			std::vector<PxU32> chunks;
+			for (PxU32 i = 0; i < static_chunks.size(); i++)
+			{
+				if (static_chunks[i].list)
+					chunks.push_back(i);
+			}
+			if (chunks.size())
+				BuildChunkTree(chunks, 0, (PxU32)chunks.size());
 
-			GLUquadric* qobj = gluNewQuadric();
-			gluQuadricNormals(qobj, GLU_SMOOTH);
-			gluCylinder(qobj, radius, radius, halfHeight*2.f, render_detail, render_detail);
-			gluDeleteQuadric(qobj);
-			glPopMatrix();
+			BakeStaticShadows();
 		}
 
-		void DrawConvexMesh(const PxGeometryHolder& geometry)
+		///Draw the retained chunks, recompiling those whose colours were changed
+		void RenderStatic(const PxVec4& shadow_color)
 		{
-			PxConvexMesh* mesh = geometry.convexMesh().convexMesh;
-			PxU32 num_polys = mesh->getNbPolygons();
-			const PxVec3* verts = mesh->getVertices();
-			const PxU8* indicies = mesh->getIndexBuffer();
-
-			for (PxU32 i = 0; i < num_polys; i++)
+			CullChunks();
+			for (PxU32 i = 0; i < visible_chunks.size(); i++)
 			{
-				PxHullPolygon face;
-				if (mesh->getPolygonData(i,face))
+				StaticChunk& chunk = static_chunks[visible_chunks[i]];
+				stats.drawn_shapes += (PxU32)chunk.parts.size();
+
+				bool changed = false;
+				for (PxU32 j = 0; j < chunk.parts.size(); j++)
 				{
-					glBegin(GL_POLYGON);
-					glNormal3f(face.mPlane[0],face.mPlane[1],face.mPlane[2]);
-					const PxU8* faceIdx = indicies + face.mIndexBase;
-					for (PxU32 j = 0; j < face.mNbVerts; j++)
+					StaticChunk::Part& part = chunk.parts[j];
+					PxVec4 color = ShapeColor(part.id);
+					if (color != part.color)
 					{
-						PxVec3 v = verts[faceIdx[j]];
-						glVertex3f(v.x,v.y,v.z);
+						part.color = color;
+						std::fill(chunk.colors.begin() + part.first_vertex, chunk.colors.begin() + part.first_vertex + part.vertex_count, color);
+						changed = true;
 					}
-					glEnd();
 				}
+				if (changed)
+					CompileChunk(chunk);
+
+				glEnable(GL_BLEND);
+				glCallList(chunk.list);
+				Count(1, (PxU32)chunk.indices.size());
 			}
+
+			if (show_shadows)
+				RenderStaticShadows(shadow_color);
 		}
 
-		void DrawTriangleMesh(const PxGeometryHolder& geometry)
+		void RetainStatic(bool value)
 		{
-			PxTriangleMesh* mesh = geometry.triangleMesh().triangleMesh;
-			const PxVec3* verts = mesh->getVertices();
-			PxU16* trigs = (PxU16*)mesh->getTriangles();
-			const PxU32 num_trigs = mesh->getNbTriangles();
+			retain_static = value;
+		}
 
-			for (PxU32 i = 0; i < num_trigs*3; i+=3)
-			{
-				PxVec3 v0 = verts[trigs[i]];
-				PxVec3 v1 = verts[trigs[i+1]];
-				PxVec3 v2 = verts[trigs[i+2]];
-				PxVec3 n = (v1-v0).cross(v2-v0);
-				n.normalize();
-				glBegin(GL_POLYGON);
-				glNormal3f(n.x, n.y, n.z);
-				glVertex3f(v0.x, v0.y, v0.z);
-				glVertex3f(v1.x, v1.y, v1.z);
-				glVertex3f(v2.x, v2.y, v2.z);
-				glEnd();
-			}
+		bool RetainStatic() { return retain_static; }
+
+		void CacheSleepingCloth(bool value)
+		{
+			cache_sleeping_cloth = value;
 		}
 
-		void DrawHeightField(const PxGeometryHolder& geometry)
+		bool CacheSleepingCloth() { return cache_sleeping_cloth; }
+
+		void Culling(bool value)
 		{
-			//TODO
+			culling = value;
 		}
 
-		void RenderGeometry(const PxGeometryHolder& geometry)
+		bool Culling() { return culling; }
+
+		void CullDistance(PxReal value)
 		{
-			switch(geometry.getType())
+			cull_distance = value;
+		}
+
+		PxReal CullDistance() { return cull_distance; }
+
+		///Queue a box, sphere or capsule, false for other geometry
+		bool Batch(const PxGeometryHolder& h, const PxTransform& pose, const PxVec4& color)
+		{
+			BatchType type;
+			PxVec3 scale;
+			PxReal stretch = 0.f;
+			switch (h.getType())
 			{
-			case PxGeometryType::ePLANE:
-				DrawPlane();
+			case PxGeometryType::eBOX:
+				type = BATCH_BOX;
+				scale = h.box().halfExtents;
 				break;
 			case PxGeometryType::eSPHERE:
-				DrawSphere(geometry);
-				break;
-			case PxGeometryType::eBOX:			
-				DrawBox(geometry);
+				type = BATCH_SPHERE;
+				scale = PxVec3(h.sphere().radius);
 				break;
 			case PxGeometryType::eCAPSULE:
-				DrawCapsule(geometry);
-				break;
-			case PxGeometryType::eCONVEXMESH:
-				DrawConvexMesh(geometry);
-				break;
-			case PxGeometryType::eTRIANGLEMESH:
-				DrawTriangleMesh(geometry);
-				break;
-			case PxGeometryType::eHEIGHTFIELD:
-				DrawHeightField(geometry);
+				type = BATCH_CAPSULE;
+				scale = PxVec3(h.capsule().radius);
+				stretch = h.capsule().halfHeight;
 				break;
 			default:
-				break;
+				return false;
 			}
-		}
 
-		void RenderCloth(const PxCloth* cloth)
-		{
-			PxClothMeshDesc* mesh_desc = ((UserData*)cloth->userData)->cloth_mesh_desc;
-			PxVec4* color = ((UserData*)cloth->userData)->color;
-
-			PxU32 quad_count = mesh_desc->quads.count;
-			PxU32* quads = (PxU32*)mesh_desc->quads.data;
-
-			std::vector<PxVec3> verts(cloth->getNbParticles());
-			std::vector<PxVec3> norms(verts.size(), PxVec3(0.f,0.f,0.f));
-
-			//get verts data
-			cloth->lockParticleData();
-
-			PxClothParticleData* particle_data = cloth->lockParticleData();
-			if (!particle_data)
-				return;
-			// copy vertex positions
-			for (PxU32 j = 0; j < verts.size(); j++)
-				verts[j] = particle_data->particles[j].pos;
-
-			particle_data->unlock();
+			BuildUnitMeshes();
+			const UnitMesh& mesh = unit_meshes[type][(type == BATCH_BOX) ? 0 : SelectLod(pose.p, scale.x + stretch)];
+			ShapeBatch& batch = batches[color.w < 1.f ? 1 : 0][type];
 
-			for (PxU32 i = 0; i < quad_count*4; i+=4)
+			const GLuint first = (GLuint)batch.positions.size();
+			for (PxU32 i = 0; i < mesh.positions.size(); i++)
 			{
-				PxVec3 v0 = verts[quads[i]];
-				PxVec3 v1 = verts[quads[i+1]];
-				PxVec3 v2 = verts[quads[i+2]];
-				PxVec3 n = -((v1-v0).cross(v2-v0));
-
-				norms[quads[i]] += n;
-				norms[quads[i+1]] += n;
-				norms[quads[i+2]] += n;
-				norms[quads[i+3]] += n;
+				batch.positions.push_back(pose.transform(mesh.positions[i].multiply(scale) + PxVec3(mesh.sides[i] * stretch, 0.f, 0.f)));
+				batch.normals.push_back(pose.q.rotate(mesh.normals[i]));
 			}
+			batch.colors.resize(batch.positions.size(), color);
+			for (PxU32 i = 0; i < mesh.indices.size(); i++)
+				batch.indices.push_back(first + mesh.indices[i]);
+			return true;
+		}
 
-			for (PxU32 i = 0; i < norms.size(); i++)
-				norms[i].normalize();
-
-			PxTransform pose = cloth->getGlobalPose();
-			PxMat44 shapePose(pose);
-
-			glColor4f(color->x, color->y, color->z, color->w);
-
-			glPushMatrix();						
-			glMultMatrixf((float*)&shapePose);
-
+		///Draw and empty the queued shapes, one call per kind and pass
+		void RenderBatches(const PxVec4& shadow_color)
+		{
+			glEnable(GL_BLEND);
 			glEnableClientState(GL_VERTEX_ARRAY);
 			glEnableClientState(GL_NORMAL_ARRAY);
-
-			glVertexPointer(3, GL_FLOAT, sizeof(PxVec3), &verts.front());
-			glNormalPointer(GL_FLOAT, sizeof(PxVec3), &norms.front());
-
-			glDrawElements(GL_QUADS, quad_count*4, GL_UNSIGNED_INT, quads);
-
+			glEnableClientState(GL_COLOR_ARRAY);
+			for (PxU32 pass = 0; pass < 2; pass++)
+			{
+				for (PxU32 type = 0; type < BATCH_TYPES; type++)
+				{
+					ShapeBatch& batch = batches[pass][type];
+					if (batch.indices.empty())
+						continue;
+					glVertexPointer(3, GL_FLOAT, sizeof(PxVec3), &batch.positions.front());
+					glNormalPointer(GL_FLOAT, sizeof(PxVec3), &batch.normals.front());
+					glColorPointer(4, GL_FLOAT, sizeof(PxVec4), &batch.colors.front());
+					glDrawElements(GL_TRIANGLES, (GLsizei)batch.indices.size(), GL_UNSIGNED_INT, &batch.indices.front());
+					Count(1, (PxU32)batch.indices.size());
+				}
+			}
+			glDisableClientState(GL_COLOR_ARRAY);
 			glDisableClientState(GL_NORMAL_ARRAY);
+
+			if (show_shadows)
+			{
+				const PxReal shadowMat[]={ 1,0,0,0, -shadow_direction.x/shadow_direction.y,0,-shadow_direction.z/shadow_direction.y,0, 0,0,1,0, 0,0,0,1 };
+				glPushMatrix();
+				glMultMatrixf(shadowMat);
+				glDisable(GL_LIGHTING);
+				glColor4f(shadow_color.x, shadow_color.y, shadow_color.z, shadow_color.w);
+				shadow_pass = true;
+				for (PxU32 pass = 0; pass < 2; pass++)
+				{
+					for (PxU32 type = 0; type < BATCH_TYPES; type++)
+					{
+						ShapeBatch& batch = batches[pass][type];
+						if (batch.indices.empty())
+							continue;
+						glVertexPointer(3, GL_FLOAT, sizeof(PxVec3), &batch.positions.front());
+						glDrawElements(GL_TRIANGLES, (GLsizei)batch.indices.size(), GL_UNSIGNED_INT, &batch.indices.front());
+						Count(1, (PxU32)batch.indices.size());
+					}
+				}
+				shadow_pass = false;
+				glEnable(GL_LIGHTING);
+				glPopMatrix();
+			}
 			glDisableClientState(GL_VERTEX_ARRAY);
 
-			glPopMatrix();
+			for (PxU32 pass = 0; pass < 2; pass++)
+			{
+				for (PxU32 type = 0; type < BATCH_TYPES; type++)
+					batches[pass][type].Clear();
+			}
+		}
+
+		void BatchShapes(bool value)
+		{
+			batch_shapes = value;
 		}
 
+		bool BatchShapes() { return batch_shapes; }
+
+		FrameLimiter frame_limiter(60.0);
+		bool on_demand = false;
+		bool redraw = true;
+
 		void reshapeCallback(int width, int height)
 		{
+			window_width = width;
+			window_height = height;
 			glViewport(0, 0, width, height);
+			redraw = true;
 		}
 
 		void idleCallback()
 		{
 			glClearColor(background_color.x, background_color.y, background_color.z, 1.f);
+			//nothing has changed, look again a little later instead of spinning
+			if (on_demand && !redraw)
+			{
+				frame_limiter.Idle(10000.0);
+				return;
+			}
+			frame_limiter.Wait();
+			frame_limiter.Frame();
+			redraw = false;
 			glutPostRedisplay();
 		}
 
-		void InitWindow(const char *name, int width, int height)
+		void FrameRate(PxReal fps)
+		{
+			frame_limiter.Target(fps);
+		}
+
+		PxReal FrameRate() { return (PxReal)frame_limiter.Target(); }
+
+		void OnDemand(bool value)
+		{
+			on_demand = value;
+			redraw = true;
+		}
+
+		bool OnDemand() { return on_demand; }
+
+		void Redraw()
+		{
+			redraw = true;
+		}
+
+		FrameTiming Timing() { return frame_limiter.Timing(); }
+
+		void InitGlut(const char *name)
 		{
 			char* namestr = new char[strlen(name)+1];
 			strcpy_s(namestr, strlen(name)+1, name);
@@ -237,13 +1546,52 @@ namespace VisualDebugger
 
 			glutInit(&argc, argv);
 
+			delete[] namestr;
+		}
+
+		void InitWindow(const char *name, int width, int height)
+		{
+			InitGlut(name);
+
+			window_width = width;
+			window_height = height;
 			glutInitWindowSize(width, height);
 			glutInitDisplayMode(GLUT_RGB|GLUT_DOUBLE|GLUT_DEPTH);
 			glutSetWindow(glutCreateWindow(name));
 			glutReshapeFunc(reshapeCallback);
 			glutIdleFunc(idleCallback);
+		}
 
-			delete[] namestr;
+		void InitOffscreen(int width, int height)
+		{
+#ifdef USE_OSMESA
+			//no GLUT on this path, so no display is needed
+			osmesa_context = OSMesaCreateContextExt(OSMESA_RGBA, 24, 0, 0, NULL);
+			if (!osmesa_context)
+				throw new Exception("Renderer::InitOffscreen, could not create an OSMesa context.");
+
+			osmesa_buffer.resize(width*height*4);
+			if (!OSMesaMakeCurrent(osmesa_context, &osmesa_buffer.front(), GL_UNSIGNED_BYTE, width, height))
+				throw new Exception("Renderer::InitOffscreen, could not make the OSMesa context current.");
+#else
+			InitWindow("offscreen", width, height);
+			glutHideWindow();
+#endif
+			offscreen = true;
+			window_width = width;
+			window_height = height;
+			glViewport(0, 0, width, height);
+		}
+
+		void ReleaseOffscreen()
+		{
+#ifdef USE_OSMESA
+			if (osmesa_context)
+				OSMesaDestroyContext(osmesa_context);
+			osmesa_context = 0;
+			osmesa_buffer.clear();
+#endif
+			offscreen = false;
 		}
 
 		void Init()
@@ -268,16 +1616,33 @@ namespace VisualDebugger
 			glLightfv(GL_LIGHT0, GL_DIFFUSE, diffuseColor);
 			glLightfv(GL_LIGHT0, GL_POSITION, position);
 			glEnable(GL_LIGHT0);
+
+			const char* extensions = (const char*)glGetString(GL_EXTENSIONS);
+			vertex_array_bgra = extensions && (strstr(extensions, "GL_ARB_vertex_array_bgra") || strstr(extensions, "GL_EXT_vertex_array_bgra"));
+
+			//once per SDK, Init may run again for another context
+			PxPhysics* physics = &PxGetPhysics();
+			if (released_geometry_physics != physics)
+			{
+				physics->registerDeletionListener(released_geometry, PxDeletionEventFlag::eMEMORY_RELEASE);
+				released_geometry_physics = physics;
+			}
 		}
 
 		void Start(const PxVec3& cameraEye, const PxVec3& cameraDir)
 		{
+			DropReleasedGeometry();
+
 			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 			// Setup camera
 			glMatrixMode(GL_PROJECTION);
 			glLoadIdentity();
-			gluPerspective(60.f, (float)glutGet(GLUT_WINDOW_WIDTH)/(float)glutGet(GLUT_WINDOW_HEIGHT), 1.f, 10000.f);
+			gluPerspective(60.f, (float)window_width/(float)window_height, 1.f, 10000.f);
+
+			camera_eye = cameraEye;
+			camera_dir = cameraDir;
+			frustum.Set(cameraEye, cameraDir, (PxReal)window_width / (PxReal)window_height, 1.f, 10000.f);
 
 			glMatrixMode(GL_MODELVIEW);
 			glLoadIdentity();
@@ -286,11 +1651,114 @@ namespace VisualDebugger
 		
 		}
 
+		void PickRay(int x, int y, PxVec3& origin, PxVec3& dir)
+		{
+			//the view of Start, with its 60 degree vertical field of view
+			const PxVec3 f = camera_dir.getNormalized();
+			const PxVec3 r = f.cross(PxVec3(0.f, 1.f, 0.f)).getNormalized();
+			const PxVec3 u = r.cross(f);
+			const PxReal v = PxTan(PxPi / 6.f);
+			const PxReal h = v * (PxReal)window_width / (PxReal)window_height;
+			//window rows go down
+			const PxReal sx = 2.f * (x + .5f) / window_width - 1.f;
+			const PxReal sy = 1.f - 2.f * (y + .5f) / window_height;
+			origin = camera_eye;
+			dir = (f + r * (sx * h) + u * (sy * v)).getNormalized();
+		}
+
 		void BackgroundColor(const PxVec3& color)
 		{
 			background_color = color;
 		}
 
+		///Bounds grown by the shadow the box casts onto the ground, if shadows are on
+		PxBounds3 CastingBounds(const PxBounds3& box)
+		{
+			if (!show_shadows || (box.maximum.y <= 0.f))
+				return box;
+			PxBounds3 bounds = box;
+			for (PxU32 i = 0; i < 8; i++)
+			{
+				const PxVec3 corner((i & 1) ? box.maximum.x : box.minimum.x, PxMax((i & 2) ? box.maximum.y : box.minimum.y, 0.f),
+					(i & 4) ? box.maximum.z : box.minimum.z);
+				bounds.include(ProjectShadow(corner));
+			}
+			return bounds;
+		}
+
+		///False if the bounds are out of view, counts the shape either way
+		bool Cull(const PxBounds3& bounds)
+		{
+			if (!Visible(CastingBounds(bounds)))
+			{
+				stats.culled_shapes++;
+				return false;
+			}
+			stats.drawn_shapes++;
+			return true;
+		}
+
+		///Draw a shape and its shadow, or queue it for its batch
+		void RenderShape(const PxGeometryHolder& h, PxTransform pose, PxU32 id, const PxVec4& shape_color, PxVec4& shadow_color)
+		{
+			//drawn with the other shapes of its kind
+			if (batch_shapes && Batch(h, pose, shape_color))
+				return;
+			//move the plane slightly down to avoid visual artefacts
+			if (h.getType() == PxGeometryType::ePLANE)
+			{
+				pose.q *= PxQuat(PxHalfPi, PxVec3(0.f, 0.f, 1.f));
+				pose.p += PxVec3(0,-0.01,0);
+			}
+
+			if (h.getType() == PxGeometryType::eSPHERE)
+				current_lod = SelectLod(pose.p, h.sphere().radius);
+			else if (h.getType() == PxGeometryType::eCAPSULE)
+				current_lod = SelectLod(pose.p, h.capsule().radius + h.capsule().halfHeight);
+			current_pose = pose;
+			current_id = id;
+
+			PxMat44 shapePose(pose);
+			// render object
+			glPushMatrix();						
+			glMultMatrixf((float*)&shapePose);
+
+			if ((id != RenderTable::NONE) && (h.getType() == PxGeometryType::ePLANE))
+			{
+				shadow_color = shape_color*0.9;
+			}
+
+			if (h.getType() == PxGeometryType::ePLANE)
+				glDisable(GL_LIGHTING);
+
+			glEnable(GL_BLEND);
+
+			glColor4f(shape_color.x, shape_color.y, shape_color.z, shape_color.w);
+
+			RenderGeometry(h);
+
+			if (h.getType() == PxGeometryType::ePLANE)
+				glEnable(GL_LIGHTING);
+
+			glPopMatrix();
+
+			//a heightfield is ground itself, nothing to cast onto
+			if(show_shadows && (h.getType() != PxGeometryType::ePLANE) && (h.getType() != PxGeometryType::eHEIGHTFIELD))
+			{
+				const PxReal shadowMat[]={ 1,0,0,0, -shadow_direction.x/shadow_direction.y,0,-shadow_direction.z/shadow_direction.y,0, 0,0,1,0, 0,0,0,1 };
+				glPushMatrix();						
+				glMultMatrixf(shadowMat);
+				glMultMatrixf((float*)&shapePose);
+				glDisable(GL_LIGHTING);
+				glColor4f(shadow_color.x, shadow_color.y, shadow_color.z, shadow_color.w);
+				shadow_pass = true;
+				RenderGeometry(h);
+				shadow_pass = false;
+				glEnable(GL_LIGHTING);
+				glPopMatrix();
+			}
+		}
+
 		void Render(PxActor** actors, const PxU32 numActors)
 		{
 			PxVec4 shadow_color = default_color*0.9;
@@ -298,7 +1766,8 @@ namespace VisualDebugger
 			{
 				if (actors[i]->isCloth())
 				{
-					RenderCloth((PxCloth*)actors[i]);
+					if (Cull(actors[i]->getWorldBounds()))
+						RenderCloth((PxCloth*)actors[i]);
 				}
 				else if (actors[i]->isRigidActor())
 				{
@@ -309,67 +1778,72 @@ namespace VisualDebugger
 					for(PxU32 j = 0; j < shapes.size(); j++)
 					{
 						const PxShape* shape = shapes[j];
-						PxTransform pose = PxShapeExt::getGlobalPose(*shape, *shape->getActor());
-						PxGeometryHolder h = shape->getGeometry();
-						//move the plane slightly down to avoid visual artefacts
-						if (h.getType() == PxGeometryType::ePLANE)
-						{
-							pose.q *= PxQuat(PxHalfPi, PxVec3(0.f, 0.f, 1.f));
-							pose.p += PxVec3(0,-0.01,0);
-						}
-
-						PxMat44 shapePose(pose);
-						// render object
-						glPushMatrix();						
-						glMultMatrixf((float*)&shapePose);
-
-						PxVec4 shape_color = default_color;
-
-						if (shape->userData)
-						{
-							shape_color = *(((UserData*)shape->userData)->color);
-							if (h.getType() == PxGeometryType::ePLANE)
-							{
-								shadow_color = shape_color*0.9;
-							}
-						}
+						PxU32 id = RenderTable::FromUserData(shape->userData);
+						//drawn with its chunk
+						if (retain_static && (id != RenderTable::NONE) && (RenderTable::Flags(id) & RenderTable::RETAINED))
+							continue;
 
-						if (h.getType() == PxGeometryType::ePLANE)
-							glDisable(GL_LIGHTING);
+						//planes are unbounded
+						if ((shape->getGeometryType() != PxGeometryType::ePLANE) && !Cull(PxShapeExt::getWorldBounds(*shape, *rigid_actor)))
+							continue;
 
-						glEnable(GL_BLEND);
+						RenderShape(shape->getGeometry(), PxShapeExt::getGlobalPose(*shape, *shape->getActor()), id,
+							(id != RenderTable::NONE) ? ShapeColor(id) : default_color, shadow_color);
+					}
+				}
 
-						glColor4f(shape_color.x, shape_color.y, shape_color.z, shape_color.w);
+			}
 
-						RenderGeometry(h);
+			if (retain_static)
+				RenderStatic(shadow_color);
+			if (batch_shapes)
+				RenderBatches(shadow_color);
+		}
 
-						if (h.getType() == PxGeometryType::ePLANE)
-							glEnable(GL_LIGHTING);
+		void Render(const PhysicsEngine::Snapshot& snapshot, PxReal alpha)
+		{
+			PxVec4 shadow_color = default_color*0.9;
+			for (PxU32 i = 0; i < snapshot.cloths.size(); i++)
+			{
+				const PhysicsEngine::ClothSnapshot& cloth = snapshot.cloths[i];
+				if (Cull(cloth.bounds))
+					RenderCloth(cloth.cloth, cloth.render_id, cloth.pose, cloth.sleeping, (PxU32)cloth.particles.size(),
+						cloth.particles.size() ? &cloth.particles.front() : 0);
+			}
 
-						glPopMatrix();
+			for (PxU32 i = 0; i < snapshot.shapes.size(); i++)
+			{
+				const PhysicsEngine::ShapeSnapshot& shape = snapshot.shapes[i];
+				if (retain_static && (shape.flags & RenderTable::RETAINED))
+					continue;
 
-						if(show_shadows && (h.getType() != PxGeometryType::ePLANE))
-						{
-							const PxVec3 shadowDir(-1.0f, -0.7071067f, 1.f);
-							const PxReal shadowMat[]={ 1,0,0,0, -shadowDir.x/shadowDir.y,0,-shadowDir.z/shadowDir.y,0, 0,0,1,0, 0,0,0,1 };
-							glPushMatrix();						
-							glMultMatrixf(shadowMat);
-							glMultMatrixf((float*)&shapePose);
-							glDisable(GL_LIGHTING);
-							glColor4f(shadow_color.x, shadow_color.y, shadow_color.z, shadow_color.w);
-							RenderGeometry(h);
-							glEnable(GL_LIGHTING);
-							glPopMatrix();
-						}
-					}
+				const PxTransform pose = PhysicsEngine::Interpolate(shape.previous_pose, shape.pose, alpha);
+				if (shape.geometry.getType() != PxGeometryType::ePLANE)
+				{
+					//the bounds are at the snapshot pose, cover the way back to the drawn one
+					PxBounds3 bounds = shape.bounds;
+					const PxVec3 offset = pose.p - shape.pose.p;
+					bounds.include(PxBounds3(shape.bounds.minimum + offset, shape.bounds.maximum + offset));
+					if (!Cull(bounds))
+						continue;
 				}
 
+				RenderShape(shape.geometry, pose, shape.render_id, DrawColor(shape.color, shape.flags), shadow_color);
 			}
+
+			if (retain_static)
+				RenderStatic(shadow_color);
+			if (batch_shapes)
+				RenderBatches(shadow_color);
 		}
 
 		void Finish()
 		{
-			glutSwapBuffers();
+			//nothing to present offscreen, wait for the frame instead
+			if (offscreen)
+				glFinish();
+			else
+				glutSwapBuffers();
 		}
 
 		void SetRenderDetail(int value)
@@ -384,15 +1858,84 @@ namespace VisualDebugger
 
 		bool ShowShadows() { return show_shadows; }
 
-		void RenderBuffer(float* pVertList, float* pColorList, int type, int num)
+		const RenderStats& Stats() { return stats; }
+
+		void ResetStats()
 		{
+			RenderStats zero = { 0, 0, 0, 0, 0, 0 };
+			stats = zero;
+		}
+
+		///Vertex of the PhysX debug primitives, points, lines and triangles are runs of these
+		struct DebugVertex
+		{
+			PxVec3 pos;
+			PxU32 color;		// 0xAARRGGBB
+		};
+
+		static_assert(sizeof(PxDebugPoint) == sizeof(DebugVertex), "PxDebugPoint layout changed");
+		static_assert(sizeof(PxDebugLine) == 2 * sizeof(DebugVertex), "PxDebugLine layout changed");
+		static_assert(sizeof(PxDebugTriangle) == 3 * sizeof(DebugVertex), "PxDebugTriangle layout changed");
+
+		//staging for the debug buffer, grows to the largest frame and is kept
+		std::vector<DebugVertex> debug_vertices;
+		//GL takes the PhysX colours as they are, no staging needed
+		bool vertex_array_bgra = false;
+
+		///Copy debug vertices with the colours reordered to RGBA bytes, made opaque
+		const DebugVertex* UnpackDebugVertices(const void* source, PxU32 count)
+		{
+			if (debug_vertices.size() < count)
+				debug_vertices.resize(count);
+			const DebugVertex* in = (const DebugVertex*)source;
+			DebugVertex* out = &debug_vertices.front();
+
+#ifdef RENDERER_SSE2
+			//one vertex per register, the colour is the last lane
+			const __m128i position_mask = _mm_set_epi32(0, -1, -1, -1);
+			const __m128i green_mask = _mm_set_epi32(0x0000ff00, 0, 0, 0);
+			const __m128i low_byte_mask = _mm_set_epi32(0x000000ff, 0, 0, 0);
+			const __m128i alpha = _mm_set_epi32((int)0xff000000, 0, 0, 0);
+			for (PxU32 i = 0; i < count; i++)
+			{
+				const __m128i v = _mm_loadu_si128((const __m128i*)(in + i));
+				const __m128i red = _mm_and_si128(_mm_srli_epi32(v, 16), low_byte_mask);
+				const __m128i blue = _mm_slli_epi32(_mm_and_si128(v, low_byte_mask), 16);
+				__m128i result = _mm_or_si128(_mm_and_si128(v, position_mask), _mm_and_si128(v, green_mask));
+				result = _mm_or_si128(result, _mm_or_si128(_mm_or_si128(red, blue), alpha));
+				_mm_storeu_si128((__m128i*)(out + i), result);
+			}
+#else
+			for (PxU32 i = 0; i < count; i++)
+			{
+				const PxU32 c = in[i].color;
+				out[i].pos = in[i].pos;
+				out[i].color = 0xff000000 | (c & 0x0000ff00) | ((c >> 16) & 0xff) | ((c & 0xff) << 16);
+			}
+#endif
+			return out;
+		}
+
+		void RenderBuffer(const void* source, int type, PxU32 count)
+		{
+			const DebugVertex* vertices = vertex_array_bgra ? (const DebugVertex*)source : UnpackDebugVertices(source, count);
+			//PhysX alpha goes through as it is on the BGRA path, debug geometry is drawn opaque either way
+			const GLboolean blend = glIsEnabled(GL_BLEND);
+			glDisable(GL_BLEND);
+
 			glEnableClientState(GL_VERTEX_ARRAY);
-			glVertexPointer(3,GL_FLOAT, 0, pVertList);
+			glVertexPointer(3, GL_FLOAT, sizeof(DebugVertex), &vertices->pos);
 			glEnableClientState(GL_COLOR_ARRAY);
-			glColorPointer(4, GL_FLOAT, 0, pColorList);
-			glDrawArrays(type, 0, num);
+			if (vertex_array_bgra)
+				glColorPointer(GL_BGRA, GL_UNSIGNED_BYTE, sizeof(DebugVertex), &vertices->color);
+			else
+				glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(DebugVertex), &vertices->color);
+			glDrawArrays(type, 0, count);
 			glDisableClientState(GL_COLOR_ARRAY);
 			glDisableClientState(GL_VERTEX_ARRAY);
+			if (blend)
+				glEnable(GL_BLEND);
+			Count(1, count);
 		}
 
 		///Render PxRenderBuffer
@@ -401,109 +1944,14 @@ namespace VisualDebugger
 		{
 			glLineWidth(line_width);
 
-			//render points
+			if (data.getNbPoints())
+				RenderBuffer(data.getPoints(), GL_POINTS, data.getNbPoints());
 
-			unsigned int NbPoints = data.getNbPoints();
-			if(NbPoints)
-			{
-				std::vector<float> pVertList(NbPoints*3);
-				std::vector<float> pColorList(NbPoints*4);
-				int vertIndex = 0;
-				int colorIndex = 0;
-				const physx::PxDebugPoint* Points = data.getPoints();
-				while(NbPoints--)
-				{
-					pVertList[vertIndex++] = Points->pos.x;
-					pVertList[vertIndex++] = Points->pos.y;
-					pVertList[vertIndex++] = Points->pos.z;
-					pColorList[colorIndex++] = (float)((Points->color>>16)&0xff)/255.f;
-					pColorList[colorIndex++] = (float)((Points->color>>8)&0xff)/255.f;
-					pColorList[colorIndex++] = (float)(Points->color&0xff)/255.f;
-					pColorList[colorIndex++] = 1.f;
-					Points++;
-				}
-
-				RenderBuffer(&pVertList.front(), &pColorList.front(), GL_POINTS, data.getNbPoints());
-			}
-
-			//render lines
-
-			unsigned int NbLines = data.getNbLines();
-			if(NbLines)
-			{
-				std::vector<float> pVertList(NbLines*3*2);
-				std::vector<float> pColorList(NbLines*4*2);
-				int vertIndex = 0;
-				int colorIndex = 0;
-				const PxDebugLine* Lines = data.getLines();
-				while(NbLines--)
-				{
-					pVertList[vertIndex++] = Lines->pos0.x;
-					pVertList[vertIndex++] = Lines->pos0.y;
-					pVertList[vertIndex++] = Lines->pos0.z;
-					pColorList[colorIndex++] = (float)((Lines->color0>>16)&0xff)/255.f;
-					pColorList[colorIndex++] = (float)((Lines->color0>>8)&0xff)/255.f;
-					pColorList[colorIndex++] = (float)(Lines->color0&0xff)/255.f;
-					pColorList[colorIndex++] = 1.f;
-
-					pVertList[vertIndex++] = Lines->pos1.x;
-					pVertList[vertIndex++] = Lines->pos1.y;
-					pVertList[vertIndex++] = Lines->pos1.z;
-					pColorList[colorIndex++] = (float)((Lines->color1>>16)&0xff)/255.f;
-					pColorList[colorIndex++] = (float)((Lines->color1>>8)&0xff)/255.f;
-					pColorList[colorIndex++] = (float)(Lines->color1&0xff)/255.f;
-					pColorList[colorIndex++] = 1.f;
-
-					Lines++;
-				}
-
-				RenderBuffer(&pVertList.front(), &pColorList.front(), GL_LINES, data.getNbLines()*2);
-			}
-
-			//render triangles
-
-			unsigned int NbTris = data.getNbTriangles();
-			if(NbTris)
-			{
-				std::vector<float> pVertList(NbTris*3*3);
-				std::vector<float> pColorList(NbTris*4*3);
-				int vertIndex = 0;
-				int colorIndex = 0;
-				const PxDebugTriangle* Triangles = data.getTriangles();
-				while(NbTris--)
-				{
-					pVertList[vertIndex++] = Triangles->pos0.x;
-					pVertList[vertIndex++] = Triangles->pos0.y;
-					pVertList[vertIndex++] = Triangles->pos0.z;
-
-					pVertList[vertIndex++] = Triangles->pos1.x;
-					pVertList[vertIndex++] = Triangles->pos1.y;
-					pVertList[vertIndex++] = Triangles->pos1.z;
-
-					pVertList[vertIndex++] = Triangles->pos2.x;
-					pVertList[vertIndex++] = Triangles->pos2.y;
-					pVertList[vertIndex++] = Triangles->pos2.z;
-
-					pColorList[colorIndex++] = (float)((Triangles->color0>>16)&0xff)/255.f;
-					pColorList[colorIndex++] = (float)((Triangles->color0>>8)&0xff)/255.f;
-					pColorList[colorIndex++] = (float)(Triangles->color0&0xff)/255.f;
-					pColorList[colorIndex++] = 1.f;
-
-					pColorList[colorIndex++] = (float)((Triangles->color1>>16)&0xff)/255.f;
-					pColorList[colorIndex++] = (float)((Triangles->color1>>8)&0xff)/255.f;
-					pColorList[colorIndex++] = (float)(Triangles->color1&0xff)/255.f;
-					pColorList[colorIndex++] = 1.f;
-
-					pColorList[colorIndex++] = (float)((Triangles->color2>>16)&0xff)/255.f;
-					pColorList[colorIndex++] = (float)((Triangles->color2>>8)&0xff)/255.f;
-					pColorList[colorIndex++] = (float)(Triangles->color2&0xff)/255.f;
-					pColorList[colorIndex++] = 1.f;
-
-					Triangles++;
-				}
+			if (data.getNbLines())
+				RenderBuffer(data.getLines(), GL_LINES, data.getNbLines() * 2);
 
-				RenderBuffer(&pVertList.front(), &pColorList.front(), GL_TRIANGLES, data.getNbTriangles()*3);
-			}
+			if (data.getNbTriangles())
+				RenderBuffer(data.getTriangles(), GL_TRIANGLES, data.getNbTriangles() * 3);
 
 			//TODO: render texts ?
 		}
@@ -512,8 +1960,40 @@ namespace VisualDebugger
 			const PxVec3& color, PxReal size)
 		{
 			GLFontRenderer::setColor(color.x, color.y, color.z, 1.f);
-			GLFontRenderer::setScreenResolution(glutGet(GLUT_WINDOW_WIDTH), glutGet(GLUT_WINDOW_HEIGHT));
+			GLFontRenderer::setScreenResolution(window_width, window_height);
 			GLFontRenderer::print(location.x, location.y, size, text.c_str());
+			//two triangles per glyph
+			Count(text.size() ? 1 : 0, (PxU32)text.size()*6);
+		}
+
+		void ClearText(TextLayout& layout)
+		{
+			layout.vertices.clear();
+			layout.uvs.clear();
+			layout.width = window_width;
+			layout.height = window_height;
+		}
+
+		void LayoutText(TextLayout& layout, const std::string& text, const physx::PxVec2& location, PxReal size)
+		{
+			GLFontRenderer::setScreenResolution(layout.width, layout.height);
+			GLFontRenderer::layout(location.x, location.y, size, text.c_str(), layout.vertices, layout.uvs);
+		}
+
+		bool TextCurrent(const TextLayout& layout)
+		{
+			return (layout.width == window_width) && (layout.height == window_height);
+		}
+
+		void RenderText(const TextLayout& layout, const PxVec3& color)
+		{
+			const PxU32 count = (PxU32)layout.vertices.size() / 3;
+			if (!count)
+				return;
+			GLFontRenderer::setColor(color.x, color.y, color.z, 1.f);
+			GLFontRenderer::setScreenResolution(layout.width, layout.height);
+			GLFontRenderer::draw(&layout.vertices.front(), &layout.uvs.front(), count);
+			Count(1, count);
 		}
 	}
 }
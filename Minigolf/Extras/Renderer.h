@@ -2,8 +2,11 @@
 
 #include "PxPhysicsAPI.h"
 #include "GLFontRenderer.h"
+#include "..\FrameLimiter.h"
+#include "..\Snapshot.h"
 #include <GL/glut.h>
 #include <string>
+#include <vector>
 
 namespace VisualDebugger
 {
@@ -11,18 +14,89 @@ namespace VisualDebugger
 	{
 		using namespace physx;
 
+		///Draw calls and vertices submitted since the last ResetStats,
+		///the shadow counters are a subset of the totals
+		struct RenderStats {
+			PxU32 draw_calls;
+			PxU32 vertices;
+			PxU32 shadow_draw_calls;
+			PxU32 shadow_vertices;
+			PxU32 culled_shapes;		// outside the view frustum or the cull distance
+			PxU32 drawn_shapes;			// passed culling, planes are not counted
+		};
+
+		///Glyph triangles of a block of text in window pixels, kept until the text changes
+		struct TextLayout {
+			std::vector<float> vertices;
+			std::vector<float> uvs;
+			int width;				// window size it was laid out for
+			int height;
+
+			TextLayout() : width(0), height(0) {}
+		};
+
 		///Init rendering window
 		void InitWindow(const char *name, int width, int height);
 
+		///Init an offscreen context of the given size instead of a window,
+		///OSMesa when built with USE_OSMESA, which needs no display, a hidden GLUT window otherwise
+		void InitOffscreen(int width, int height);
+
+		///Release the offscreen context
+		void ReleaseOffscreen();
+
 		///Init renderer
 		void Init();
 
 		///Start rendering a single frame
 		void Start(const PxVec3& cameraEye, const PxVec3& cameraDir);
 
+		///Ray from the eye of the current frame through a window pixel, for picking
+		void PickRay(int x, int y, PxVec3& origin, PxVec3& dir);
+
 		///Render actors
 		void Render(PxActor** actors, const PxU32 numActors);
 
+		///Render a scene snapshot, alpha blends from the previous step's poses (0) to the snapshot's (1)
+		void Render(const PhysicsEngine::Snapshot& snapshot, PxReal alpha=1.f);
+
+		///Bake the boxes and meshes of the static actors into retained chunks drawn with
+		///one call each, call again whenever the static actors change
+		void BuildStatic(PxActor** actors, const PxU32 numActors);
+
+		///Drop the retained chunks
+		void ReleaseStatic();
+
+		///Draw static actors from the retained chunks (default) or shape by shape
+		void RetainStatic(bool value);
+
+		///Get retain static
+		bool RetainStatic();
+
+		///Draw boxes, spheres and capsules merged per type (default) or shape by shape
+		void BatchShapes(bool value);
+
+		///Get batch shapes
+		bool BatchShapes();
+
+		///Keep the positions and normals of sleeping cloth from the frame it fell asleep (default)
+		void CacheSleepingCloth(bool value);
+
+		///Get cache sleeping cloth
+		bool CacheSleepingCloth();
+
+		///Skip shapes and static chunks outside the camera frustum (default)
+		void Culling(bool value);
+
+		///Get culling
+		bool Culling();
+
+		///Also skip shapes further than the given distance from the camera, 0 for no limit (default)
+		void CullDistance(PxReal value);
+
+		///Get cull distance
+		PxReal CullDistance();
+
 		///Render debug information
 		void Render(const PxRenderBuffer& data, PxReal line_width=1.f);
 
@@ -30,13 +104,44 @@ namespace VisualDebugger
 		void RenderText(const std::string& text, const physx::PxVec2& location, 
 			const PxVec3& color, PxReal size);
 
+		///Start a new text layout for the current window size
+		void ClearText(TextLayout& layout);
+
+		///Append a line to a text layout, location and size as in RenderText
+		void LayoutText(TextLayout& layout, const std::string& text, const physx::PxVec2& location, PxReal size);
+
+		///Was the layout made for the current window size
+		bool TextCurrent(const TextLayout& layout);
+
+		///Render a text layout with one call
+		void RenderText(const TextLayout& layout, const PxVec3& color);
+
 		///Set background color
 		void BackgroundColor(const PxVec3& background_color);
 
+		///Frames per second the window loop is paced to, 0 for no limit (60 by default)
+		void FrameRate(PxReal fps);
+
+		///Get frame rate
+		PxReal FrameRate();
+
+		///Draw only frames asked for with Redraw, sleep otherwise (off by default)
+		void OnDemand(bool value);
+
+		///Get on demand
+		bool OnDemand();
+
+		///Ask for another frame in on demand mode
+		void Redraw();
+
+		///Frame intervals and CPU use of the window loop
+		FrameTiming Timing();
+
 		///Finish rendering a single frame
 		void Finish();
 
-		///Set rendering detail for spheres and capsules.
+		///Set rendering detail for spheres and capsules close to the camera,
+		///distant ones go down to a quarter of it.
 		void SetRenderDetail(int value);
 
 		///Set show shadows
@@ -44,5 +149,11 @@ namespace VisualDebugger
 
 		///Get show shadows
 		bool ShowShadows();
+
+		///Get the counters of submitted geometry
+		const RenderStats& Stats();
+
+		///Zero the counters of submitted geometry
+		void ResetStats();
 	}
 }
\ No newline at end of file
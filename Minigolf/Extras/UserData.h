@@ -1,14 +1,108 @@
 #pragma once
 
 #include "PxPhysicsAPI.h"
+#include "..\Exception.h"
+#include <vector>
+#include <mutex>
 
 //add here any other structures that you want to pass from your simulation to the renderer
-class UserData
+
+///Render attributes of every shape and cloth, stored as arrays per attribute.
+///
+///A shape's userData holds only its entry index (plus one, so that 0 means no entry).
+///Entries live in fixed pages that never move, so the renderer and the owning actor
+///can keep reading and writing them while other scenes add entries on other threads.
+class RenderTable
 {
 public:
-	physx::PxVec4* color;
-	physx::PxClothMeshDesc* cloth_mesh_desc;
+	static const physx::PxU32 NONE = 0xffffffff;
+
+	///Render flags
+	enum RenderFlags {
+		HIGHLIGHT = (1 << 0),		// drawn brighter, the selected actor
+		RETAINED = (1 << 1)			// baked into a static chunk, not drawn one by one
+	};
+
+private:
+	static const physx::PxU32 page_bits = 10;
+	static const physx::PxU32 page_size = 1 << page_bits;
+	static const physx::PxU32 max_pages = 1024;
+
+	struct Page {
+		physx::PxVec4 colors[page_size];
+		physx::PxU32 flags[page_size];
+		physx::PxClothMeshDesc* cloth_meshes[page_size];
+		const std::vector<physx::PxVec4>* material_colors[page_size];
+	};
+
+	struct Storage {
+		Page* pages[max_pages];
+		physx::PxU32 count;
+		std::vector<physx::PxU32> free_entries;
+		std::mutex mutex;
+
+		Storage() : count(0) {
+			for (physx::PxU32 i = 0; i < max_pages; i++)
+				pages[i] = 0;
+		}
+
+		~Storage() {
+			for (physx::PxU32 i = 0; i < max_pages; i++)
+				delete pages[i];
+		}
+	};
+
+	static Storage& Get() {
+		static Storage storage;
+		return storage;
+	}
+
+	static Page& PageOf(physx::PxU32 id) { return *Get().pages[id >> page_bits]; }
+
+public:
+	///New entry, reusing a removed one if there is any
+	static physx::PxU32 Add(const physx::PxVec4& color, physx::PxClothMeshDesc* cloth_mesh = 0) {
+		Storage& storage = Get();
+		physx::PxU32 id;
+		{
+			std::lock_guard<std::mutex> lock(storage.mutex);
+			if (storage.free_entries.size()) {
+				id = storage.free_entries.back();
+				storage.free_entries.pop_back();
+			}
+			else {
+				if (storage.count == page_size * max_pages)
+					throw new Exception("RenderTable::Add, too many shapes.");
+				id = storage.count++;
+				if (!storage.pages[id >> page_bits])
+					storage.pages[id >> page_bits] = new Page();
+			}
+		}
+		Color(id) = color;
+		Flags(id) = 0;
+		ClothMesh(id) = cloth_mesh;
+		MaterialColors(id) = 0;
+		return id;
+	}
+
+	static void Remove(physx::PxU32 id) {
+		Storage& storage = Get();
+		std::lock_guard<std::mutex> lock(storage.mutex);
+		storage.free_entries.push_back(id);
+	}
+
+	static physx::PxVec4& Color(physx::PxU32 id) { return PageOf(id).colors[id & (page_size - 1)]; }
+
+	static physx::PxU32& Flags(physx::PxU32 id) { return PageOf(id).flags[id & (page_size - 1)]; }
+
+	static physx::PxClothMeshDesc*& ClothMesh(physx::PxU32 id) { return PageOf(id).cloth_meshes[id & (page_size - 1)]; }
+
+	///Colours by material index for shapes with a material per sample, such as heightfields, 0 for the shape colour
+	static const std::vector<physx::PxVec4>*& MaterialColors(physx::PxU32 id) { return PageOf(id).material_colors[id & (page_size - 1)]; }
+
+	///Value for PxShape::userData and PxActor::userData
+	static void* ToUserData(physx::PxU32 id) { return (void*)((size_t)id + 1); }
 
-	UserData(physx::PxVec4* _color=0, physx::PxClothMeshDesc* _cloth_mesh_desc=0) :
-		color(_color), cloth_mesh_desc(_cloth_mesh_desc) {}
-};
\ No newline at end of file
+	///Entry of a shape or cloth, NONE if it has none
+	static physx::PxU32 FromUserData(const void* user_data) { return user_data ? (physx::PxU32)((size_t)user_data - 1) : NONE; }
+};
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <mmsystem.h>
+#pragma comment(lib, "winmm.lib")
+#else
+#include <sys/resource.h>
+#endif
+
+namespace VisualDebugger
+{
+	using namespace std;
+
+	///Frame intervals and CPU use over the last frames
+	struct FrameTiming {
+		double interval_p50_us;
+		double interval_p99_us;
+		double cpu_percent;			// process CPU time over wall time, 100 is one full core
+	};
+
+	///Paces a loop to a target frame rate by sleeping, and times the frames it lets through.
+	///
+	///Sleeps straight to the frame's deadline without spinning. On Windows the timer runs at
+	///1 ms while a limiter exists, so a frame starts at most about a millisecond late.
+	class FrameLimiter
+	{
+		typedef chrono::steady_clock Clock;
+
+		double period_us;
+		Clock::time_point next_frame;
+		Clock::time_point last_frame;
+		vector<double> intervals;
+		size_t next_interval;
+
+		Clock::time_point cpu_wall;
+		double cpu_time;
+		double cpu_percent;
+
+		static const size_t window = 120;
+
+		///User and kernel time of the whole process in microseconds
+		static double ProcessCpuTime() {
+#ifdef _WIN32
+			FILETIME creation, exit, kernel, user;
+			if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user))
+				return 0.0;
+			ULARGE_INTEGER k, u;
+			k.LowPart = kernel.dwLowDateTime;
+			k.HighPart = kernel.dwHighDateTime;
+			u.LowPart = user.dwLowDateTime;
+			u.HighPart = user.dwHighDateTime;
+			return (double)(k.QuadPart + u.QuadPart) / 10.0;
+#else
+			rusage usage;
+			getrusage(RUSAGE_SELF, &usage);
+			return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1e6 + usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+#endif
+		}
+
+	public:
+		FrameLimiter(double fps = 60.0) : next_interval(0), cpu_time(ProcessCpuTime()), cpu_percent(0.0) {
+			Target(fps);
+			next_frame = last_frame = cpu_wall = Clock::now();
+#ifdef _WIN32
+			timeBeginPeriod(1);
+#endif
+		}
+
+		~FrameLimiter() {
+#ifdef _WIN32
+			timeEndPeriod(1);
+#endif
+		}
+
+		///Target frames per second, 0 for no limit
+		void Target(double fps) {
+			period_us = (fps > 0.0) ? 1e6 / fps : 0.0;
+		}
+
+		double Target() const { return (period_us > 0.0) ? 1e6 / period_us : 0.0; }
+
+		///Time until the next frame is due in microseconds, 0 if it is due
+		double Remaining() const {
+			return (max)(chrono::duration<double, micro>(next_frame - Clock::now()).count(), 0.0);
+		}
+
+		///Block until the next frame is due
+		void Wait() {
+			this_thread::sleep_until(next_frame);
+		}
+
+		///Sleep for at most the given time, less if a frame is due sooner
+		void Idle(double microseconds) {
+			this_thread::sleep_for(chrono::microseconds((long long)(min)(microseconds, (max)(Remaining(), 1000.0))));
+		}
+
+		///Mark the start of a frame, schedules the next one
+		void Frame() {
+			Clock::time_point now = Clock::now();
+
+			if (intervals.size() < window)
+				intervals.push_back(chrono::duration<double, micro>(now - last_frame).count());
+			else
+				intervals[next_interval++ % window] = chrono::duration<double, micro>(now - last_frame).count();
+			last_frame = now;
+
+			//keep the cadence, but do not try to catch up after a stall
+			next_frame += chrono::microseconds((long long)period_us);
+			if (next_frame < now)
+				next_frame = now + chrono::microseconds((long long)period_us);
+
+			//CPU use over about a second
+			double wall = chrono::duration<double, micro>(now - cpu_wall).count();
+			if (wall > 1e6) {
+				double cpu = ProcessCpuTime();
+				cpu_percent = 100.0 * (cpu - cpu_time) / wall;
+				cpu_time = cpu;
+				cpu_wall = now;
+			}
+		}
+
+		FrameTiming Timing() const {
+			FrameTiming timing = { 0.0, 0.0, cpu_percent };
+			if (intervals.empty())
+				return timing;
+			vector<double> sorted(intervals);
+			sort(sorted.begin(), sorted.end());
+			timing.interval_p50_us = sorted[(size_t)(.50 * (sorted.size() - 1) + .5)];
+			timing.interval_p99_us = sorted[(size_t)(.99 * (sorted.size() - 1) + .5)];
+			return timing;
+		}
+	};
+}
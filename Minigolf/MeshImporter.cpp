@@ -0,0 +1,563 @@
+#include "MeshImporter.h"
+#include <fstream>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <functional>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+namespace PhysicsEngine
+{
+	///Cooked data of one request, filled in by a worker
+	struct CookJob {
+		const MeshRequest* request;
+		string cache_file;
+		vector<PxU8> data;
+		bool cached;
+		string error;
+
+		CookJob() : request(0), cached(false) {}
+	};
+
+	static bool ReadFile(const string& file, vector<char>& bytes)
+	{
+		ifstream in(file.c_str(), ios::binary);
+		if (!in)
+			return false;
+		in.seekg(0, ios::end);
+		bytes.resize((size_t)in.tellg());
+		in.seekg(0, ios::beg);
+		return bytes.empty() || (bool)in.read(&bytes.front(), bytes.size());
+	}
+
+	///Write under a temporary name first, so a reader never sees half a file
+	static void WriteFile(const string& file, const vector<PxU8>& bytes)
+	{
+		//an empty mesh is not worth a cache entry
+		if (bytes.empty())
+			return;
+		const string temporary = file + ".tmp" + to_string((size_t)hash<thread::id>()(this_thread::get_id()));
+		{
+			ofstream out(temporary.c_str(), ios::binary);
+			if (!out || !out.write((const char*)&bytes.front(), bytes.size()))
+				return;
+		}
+		//another thread may have written the same key already, either copy will do
+		if (rename(temporary.c_str(), file.c_str()) != 0)
+			remove(temporary.c_str());
+	}
+
+	///Create a directory if it does not exist yet, its parent has to exist
+	static void MakeDirectory(const string& path)
+	{
+#ifdef _WIN32
+		_mkdir(path.c_str());
+#else
+		mkdir(path.c_str(), 0755);
+#endif
+	}
+
+	static bool EndsWith(const string& text, const string& ending)
+	{
+		if (text.size() < ending.size())
+			return false;
+		for (size_t i = 0; i < ending.size(); i++)
+		{
+			if (tolower(text[text.size() - ending.size() + i]) != ending[i])
+				return false;
+		}
+		return true;
+	}
+
+	///Fan of a polygon, as triangles
+	static void AddPolygon(const vector<PxU32>& polygon, vector<PxU32>& indices)
+	{
+		for (size_t i = 2; i < polygon.size(); i++)
+		{
+			indices.push_back(polygon[0]);
+			indices.push_back(polygon[i - 1]);
+			indices.push_back(polygon[i]);
+		}
+	}
+
+	///"v x y z" and "f a/b/c ..." lines, other lines are skipped.
+	///Negative indices count back from the last vertex read.
+	static void ParseObj(const vector<char>& bytes, const string& file, vector<PxVec3>& vertices, vector<PxU32>& indices)
+	{
+		//terminated copy, so strtof and strtol stop at the end
+		vector<char> text(bytes);
+		text.push_back('\0');
+		const char* p = &text.front();
+		vector<PxU32> polygon;
+
+		while (*p)
+		{
+			while ((*p == ' ') || (*p == '\t'))
+				p++;
+
+			if ((p[0] == 'v') && ((p[1] == ' ') || (p[1] == '\t')))
+			{
+				char* end;
+				PxVec3 v;
+				v.x = strtof(p + 2, &end);
+				v.y = strtof(end, &end);
+				v.z = strtof(end, &end);
+				vertices.push_back(v);
+				p = end;
+			}
+			else if ((p[0] == 'f') && ((p[1] == ' ') || (p[1] == '\t')))
+			{
+				polygon.clear();
+				p += 2;
+				while (*p && (*p != '\n') && (*p != '\r'))
+				{
+					char* end;
+					long index = strtol(p, &end, 10);
+					if (end == p)
+					{
+						p++;
+						continue;
+					}
+					if (index < 0)
+						index += (long)vertices.size();
+					else
+						index -= 1;
+					if ((index < 0) || (index >= (long)vertices.size()))
+						throw new Exception("MeshImporter::ParseObj, vertex index out of range in " + file + ".");
+					polygon.push_back((PxU32)index);
+
+					//skip the texture and normal indices
+					p = end;
+					while (*p && (*p != ' ') && (*p != '\t') && (*p != '\n') && (*p != '\r'))
+						p++;
+				}
+				AddPolygon(polygon, indices);
+			}
+
+			while (*p && (*p != '\n'))
+				p++;
+			if (*p)
+				p++;
+		}
+	}
+
+	///Values of a PLY body, ASCII or binary in either byte order
+	class PlyReader
+	{
+		const char* p;
+		const char* end;
+		bool ascii;
+		bool swap;
+		const string& file;
+
+	public:
+		PlyReader(const char* begin, const char* _end, bool _ascii, bool _swap, const string& _file)
+			: p(begin), end(_end), ascii(_ascii), swap(_swap), file(_file) {}
+
+		static PxU32 Size(const string& type)
+		{
+			if ((type == "char") || (type == "uchar") || (type == "int8") || (type == "uint8"))
+				return 1;
+			if ((type == "short") || (type == "ushort") || (type == "int16") || (type == "uint16"))
+				return 2;
+			if ((type == "int") || (type == "uint") || (type == "int32") || (type == "uint32") || (type == "float") || (type == "float32"))
+				return 4;
+			if ((type == "double") || (type == "float64"))
+				return 8;
+			return 0;
+		}
+
+		double Read(const string& type)
+		{
+			if (ascii)
+			{
+				while ((p < end) && isspace((unsigned char)*p))
+					p++;
+				if (p >= end)
+					throw new Exception("MeshImporter::ParsePly, " + file + " is truncated.");
+				char* next;
+				double value = strtod(p, &next);
+				p = next;
+				return value;
+			}
+
+			const PxU32 size = Size(type);
+			if (p + size > end)
+				throw new Exception("MeshImporter::ParsePly, " + file + " is truncated.");
+			unsigned char raw[8];
+			memcpy(raw, p, size);
+			p += size;
+			if (swap)
+				std::reverse(raw, raw + size);
+
+			if ((type == "char") || (type == "int8")) { PxI8 v; memcpy(&v, raw, 1); return v; }
+			if ((type == "uchar") || (type == "uint8")) { PxU8 v; memcpy(&v, raw, 1); return v; }
+			if ((type == "short") || (type == "int16")) { PxI16 v; memcpy(&v, raw, 2); return v; }
+			if ((type == "ushort") || (type == "uint16")) { PxU16 v; memcpy(&v, raw, 2); return v; }
+			if ((type == "int") || (type == "int32")) { PxI32 v; memcpy(&v, raw, 4); return v; }
+			if ((type == "uint") || (type == "uint32")) { PxU32 v; memcpy(&v, raw, 4); return v; }
+			if ((type == "float") || (type == "float32")) { PxF32 v; memcpy(&v, raw, 4); return v; }
+			PxF64 v;
+			memcpy(&v, raw, 8);
+			return v;
+		}
+	};
+
+	///Header of "element" and "property" lines, then the "vertex" and "face" elements.
+	///Only x, y, z and the vertex index list are used, other properties are read past.
+	static void ParsePly(const vector<char>& bytes, const string& file, vector<PxVec3>& vertices, vector<PxU32>& indices)
+	{
+		struct Property {
+			string name;
+			string type;
+			string count_type;		// set for lists
+		};
+		struct Element {
+			string name;
+			PxU32 count;
+			vector<Property> properties;
+		};
+
+		const string text(bytes.begin(), bytes.begin() + std::min(bytes.size(), (size_t)65536));
+		const size_t header_end = text.find("end_header");
+		if ((text.compare(0, 3, "ply") != 0) || (header_end == string::npos))
+			throw new Exception("MeshImporter::ParsePly, " + file + " is not a PLY file.");
+
+		vector<Element> elements;
+		string format;
+		size_t line_start = 0;
+		while (line_start < header_end)
+		{
+			size_t line_end = text.find('\n', line_start);
+			if (line_end == string::npos)
+				throw new Exception("MeshImporter::ParsePly, the header of " + file + " is truncated.");
+			string line = text.substr(line_start, line_end - line_start);
+			line_start = line_end + 1;
+
+			char word[64], a[64], b[64], c[64];
+			unsigned int count;
+			if (sscanf(line.c_str(), "%63s", word) != 1)
+				continue;
+			if ((strcmp(word, "format") == 0) && (sscanf(line.c_str(), "%*s %63s", a) == 1))
+				format = a;
+			else if ((strcmp(word, "element") == 0) && (sscanf(line.c_str(), "%*s %63s %u", a, &count) == 2))
+			{
+				Element element = { a, count };
+				elements.push_back(element);
+			}
+			else if ((strcmp(word, "property") == 0) && elements.size())
+			{
+				Property property;
+				if (sscanf(line.c_str(), "%*s list %63s %63s %63s", a, b, c) == 3)
+				{
+					property.count_type = a;
+					property.type = b;
+					property.name = c;
+				}
+				else if (sscanf(line.c_str(), "%*s %63s %63s", a, b) == 2)
+				{
+					property.type = a;
+					property.name = b;
+				}
+				if (!PlyReader::Size(property.type) || (property.count_type.size() && !PlyReader::Size(property.count_type)))
+					throw new Exception("MeshImporter::ParsePly, unknown property type in " + file + ".");
+				elements.back().properties.push_back(property);
+			}
+		}
+
+		if ((format != "ascii") && (format != "binary_little_endian") && (format != "binary_big_endian"))
+			throw new Exception("MeshImporter::ParsePly, unknown format " + format + " in " + file + ".");
+
+		//the body starts on the line after end_header
+		size_t body = text.find('\n', header_end);
+		if (body == string::npos)
+			throw new Exception("MeshImporter::ParsePly, " + file + " is truncated.");
+		const PxU16 probe = 1;
+		const bool little_endian_host = *(const PxU8*)&probe == 1;
+		PlyReader reader(&bytes.front() + body + 1, &bytes.front() + bytes.size(), format == "ascii",
+			(format == "binary_big_endian") == little_endian_host, file);
+
+		vector<PxU32> polygon;
+		for (size_t e = 0; e < elements.size(); e++)
+		{
+			const Element& element = elements[e];
+			const bool is_vertex = element.name == "vertex";
+			const bool is_face = element.name == "face";
+			if (is_vertex)
+				vertices.reserve(vertices.size() + element.count);
+
+			for (PxU32 i = 0; i < element.count; i++)
+			{
+				PxVec3 v(0.f);
+				for (size_t k = 0; k < element.properties.size(); k++)
+				{
+					const Property& property = element.properties[k];
+					if (property.count_type.size())
+					{
+						const PxU32 count = (PxU32)reader.Read(property.count_type);
+						const bool used = is_face && ((property.name == "vertex_indices") || (property.name == "vertex_index"));
+						polygon.clear();
+						for (PxU32 j = 0; j < count; j++)
+						{
+							const double index = reader.Read(property.type);
+							if (used)
+								polygon.push_back((PxU32)index);
+						}
+						if (used)
+							AddPolygon(polygon, indices);
+					}
+					else
+					{
+						const double value = reader.Read(property.type);
+						if (is_vertex && (property.name == "x"))
+							v.x = (PxReal)value;
+						else if (is_vertex && (property.name == "y"))
+							v.y = (PxReal)value;
+						else if (is_vertex && (property.name == "z"))
+							v.z = (PxReal)value;
+					}
+				}
+				if (is_vertex)
+					vertices.push_back(v);
+			}
+		}
+
+		for (size_t i = 0; i < indices.size(); i++)
+		{
+			if (indices[i] >= vertices.size())
+				throw new Exception("MeshImporter::ParsePly, vertex index out of range in " + file + ".");
+		}
+	}
+
+	static void Parse(const vector<char>& bytes, const string& file, vector<PxVec3>& vertices, vector<PxU32>& indices)
+	{
+		vertices.clear();
+		indices.clear();
+		if (EndsWith(file, ".obj"))
+			ParseObj(bytes, file, vertices, indices);
+		else if (EndsWith(file, ".ply"))
+			ParsePly(bytes, file, vertices, indices);
+		else
+			throw new Exception("MeshImporter::Load, " + file + " is neither an OBJ nor a PLY file.");
+		if (vertices.empty())
+			throw new Exception("MeshImporter::Load, no vertices in " + file + ".");
+	}
+
+	void MeshImporter::Load(const string& file, vector<PxVec3>& vertices, vector<PxU32>& indices)
+	{
+		vector<char> bytes;
+		if (!ReadFile(file, bytes))
+			throw new Exception("MeshImporter::Load, could not open " + file + ".");
+		Parse(bytes, file, vertices, indices);
+	}
+
+	PxU64 MeshImporter::Hash(const void* data, size_t size, PxU64 hash)
+	{
+		const PxU8* bytes = (const PxU8*)data;
+		for (size_t i = 0; i < size; i++)
+		{
+			hash ^= bytes[i];
+			hash *= 1099511628211ULL;
+		}
+		return hash;
+	}
+
+	///Read, parse and cook one file, or take it from the cache
+	static void CookFile(PxCooking* cooking, const ImportDesc& desc, CookJob& job)
+	{
+		const MeshRequest& request = *job.request;
+		vector<char> bytes;
+		if (!ReadFile(request.file, bytes))
+			throw new Exception("MeshImporter::Import, could not open " + request.file + ".");
+
+		//the key covers everything the cooked data depends on
+		if (desc.cache.size())
+		{
+			PxU64 key = MeshImporter::Hash(bytes.size() ? &bytes.front() : 0, bytes.size());
+			const PxU32 settings[] = { PX_PHYSICS_VERSION, (PxU32)request.kind, desc.options.fast_cooking, desc.options.clean };
+			const PxReal tolerances[] = { desc.options.size_tradeoff, desc.options.weld_tolerance };
+			key = MeshImporter::Hash(settings, sizeof(settings), key);
+			key = MeshImporter::Hash(tolerances, sizeof(tolerances), key);
+
+			char name[32];
+			snprintf(name, sizeof(name), "%016llx", (unsigned long long)key);
+			job.cache_file = desc.cache + "/" + name + ((request.kind == MESH_CONVEX) ? ".convex" : ".mesh");
+
+			vector<char> cached;
+			if (ReadFile(job.cache_file, cached) && cached.size())
+			{
+				job.data.assign(cached.begin(), cached.end());
+				job.cached = true;
+				return;
+			}
+		}
+
+		vector<PxVec3> vertices;
+		vector<PxU32> indices;
+		Parse(bytes, request.file, vertices, indices);
+
+		PxDefaultMemoryOutputStream stream;
+		if (request.kind == MESH_CONVEX)
+		{
+			PxConvexMeshDesc mesh_desc;
+			mesh_desc.points.count = (PxU32)vertices.size();
+			mesh_desc.points.stride = sizeof(PxVec3);
+			mesh_desc.points.data = &vertices.front();
+			mesh_desc.flags = PxConvexFlag::eCOMPUTE_CONVEX;
+			mesh_desc.vertexLimit = 256;
+			if (!cooking->cookConvexMesh(mesh_desc, stream))
+				throw new Exception("MeshImporter::Import, cooking " + request.file + " failed.");
+		}
+		else if (!cooking->cookTriangleMesh(TriangleMesh::Describe(vertices, indices), stream))
+			throw new Exception("MeshImporter::Import, cooking " + request.file + " failed.");
+
+		job.data.assign(stream.getData(), stream.getData() + stream.getSize());
+		if (job.cache_file.size())
+			WriteFile(job.cache_file, job.data);
+	}
+
+	vector<ImportedMesh> MeshImporter::Import(const vector<MeshRequest>& requests)
+	{
+		if (desc.cache.size())
+			MakeDirectory(desc.cache);
+
+		vector<CookJob> jobs(requests.size());
+		for (size_t i = 0; i < jobs.size(); i++)
+			jobs[i].request = &requests[i];
+
+		//every worker cooks with its own object, the shared one is not thread safe
+		const PxCookingParams params = TriangleMesh::CookingParams(GetCooking()->getParams(), desc.options);
+		PxU32 threads = desc.threads ? desc.threads : PxMax(thread::hardware_concurrency(), 1u);
+		threads = PxMin(threads, (PxU32)jobs.size());
+
+		atomic<PxU32> next(0);
+		auto worker = [&]() {
+			PxCooking* cooking = PxCreateCooking(PX_PHYSICS_VERSION, GetPhysics()->getFoundation(), params);
+			for (PxU32 i = next++; i < jobs.size(); i = next++)
+			{
+				try
+				{
+					if (!cooking)
+						throw new Exception("MeshImporter::Import, could not create a cooking object.");
+					CookFile(cooking, desc, jobs[i]);
+				}
+				catch (Exception* exc)
+				{
+					jobs[i].error = exc->what();
+					delete exc;
+				}
+				//nothing may leave a pool thread, anything else fails the asset the same way
+				catch (const exception& exc)
+				{
+					jobs[i].error = "MeshImporter::Import, " + jobs[i].request->file + ": " + exc.what();
+				}
+				catch (...)
+				{
+					jobs[i].error = "MeshImporter::Import, " + jobs[i].request->file + " failed.";
+				}
+			}
+			if (cooking)
+				cooking->release();
+		};
+
+		vector<thread> pool;
+		for (PxU32 i = 1; i < threads; i++)
+			pool.push_back(thread(worker));
+		if (threads)
+			worker();
+		for (size_t i = 0; i < pool.size(); i++)
+			pool[i].join();
+
+		for (size_t i = 0; i < jobs.size(); i++)
+		{
+			if (jobs[i].error.size())
+				throw new Exception(jobs[i].error);
+		}
+
+		//PhysX objects are created on this thread only
+		vector<ImportedMesh> meshes(jobs.size());
+		for (size_t i = 0; i < jobs.size(); i++)
+		{
+			meshes[i].convex = 0;
+			meshes[i].triangles = 0;
+		}
+		try
+		{
+			for (size_t i = 0; i < jobs.size(); i++)
+			{
+				CookJob& job = jobs[i];
+				ImportedMesh& mesh = meshes[i];
+				mesh.file = job.request->file;
+				mesh.cached = job.cached;
+
+				for (PxU32 attempt = 0; attempt < 2; attempt++)
+				{
+					if (job.data.size())
+					{
+						PxDefaultMemoryInputData input(&job.data.front(), (PxU32)job.data.size());
+						if (job.request->kind == MESH_CONVEX)
+							mesh.convex = GetPhysics()->createConvexMesh(input);
+						else
+							mesh.triangles = GetPhysics()->createTriangleMesh(input);
+					}
+					if (mesh.convex || mesh.triangles || !job.cached)
+						break;
+
+					//a stale or damaged cache entry, cook it again
+					remove(job.cache_file.c_str());
+					job.cached = mesh.cached = false;
+					const PxCookingParams defaults = GetCooking()->getParams();
+					GetCooking()->setParams(params);
+					try
+					{
+						CookFile(GetCooking(), desc, job);
+					}
+					catch (Exception*)
+					{
+						GetCooking()->setParams(defaults);
+						throw;
+					}
+					GetCooking()->setParams(defaults);
+				}
+				if (!mesh.convex && !mesh.triangles)
+					throw new Exception("MeshImporter::Import, could not create the mesh of " + mesh.file + ".");
+			}
+		}
+		catch (Exception*)
+		{
+			//nothing of a failed batch is handed out
+			for (size_t i = 0; i < meshes.size(); i++)
+			{
+				if (meshes[i].convex)
+					meshes[i].convex->release();
+				if (meshes[i].triangles)
+					meshes[i].triangles->release();
+			}
+			throw;
+		}
+
+		for (size_t i = 0; i < meshes.size(); i++)
+		{
+			if (meshes[i].cached)
+				cache_hits++;
+			else
+				cooked++;
+		}
+		return meshes;
+	}
+
+	ImportedMesh MeshImporter::Import(const MeshRequest& request)
+	{
+		return Import(vector<MeshRequest>(1, request))[0];
+	}
+}
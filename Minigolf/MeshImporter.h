@@ -0,0 +1,73 @@
+#pragma once
+
+#include "BasicActors.h"
+#include <string>
+#include <vector>
+
+namespace PhysicsEngine
+{
+	using namespace std;
+
+	///What a mesh file is cooked into
+	enum MeshKind {
+		MESH_CONVEX,		// convex hull of the vertices, for dynamic actors
+		MESH_TRIANGLES		// the triangles as they are, for static actors
+	};
+
+	///A mesh file to import, OBJ or PLY by extension
+	struct MeshRequest {
+		string file;
+		MeshKind kind;
+
+		MeshRequest(const string& _file = "", MeshKind _kind = MESH_TRIANGLES) : file(_file), kind(_kind) {}
+	};
+
+	///A cooked mesh, owned by PhysX; only the pointer of its kind is set
+	struct ImportedMesh {
+		string file;
+		PxConvexMesh* convex;
+		PxTriangleMesh* triangles;
+		bool cached;				// read from the disk cache instead of cooked
+	};
+
+	///Importer settings
+	struct ImportDesc {
+		string cache;					// directory of cooked meshes, created if missing, empty for no disk cache
+		PxU32 threads;					// cooking threads, 0 for one per core
+		TriangleMeshOptions options;	// for MESH_TRIANGLES
+
+		ImportDesc() : threads(0) {}
+	};
+
+	///Reads OBJ and PLY meshes and cooks them into convex hulls or triangle meshes.
+	///
+	///Files are read, parsed and cooked on a pool of threads, each with a cooking object
+	///of its own, and the meshes are created from the cooked data on the calling thread.
+	///Cooked data is kept on disk under the FNV-1a hash of the file contents and the
+	///cooking settings, so an unchanged file is only cooked once.
+	class MeshImporter
+	{
+		ImportDesc desc;
+		PxU32 cooked;
+		PxU32 cache_hits;
+
+	public:
+		MeshImporter(const ImportDesc& _desc = ImportDesc()) : desc(_desc), cooked(0), cache_hits(0) {}
+
+		///Import the files in parallel, in the order given; throws if any of them fails
+		vector<ImportedMesh> Import(const vector<MeshRequest>& requests);
+
+		///Import a single file
+		ImportedMesh Import(const MeshRequest& request);
+
+		///Files cooked and files read from the cache so far
+		PxU32 Cooked() const { return cooked; }
+		PxU32 CacheHits() const { return cache_hits; }
+
+		///Vertices and triangle indices of an OBJ or PLY file, polygons split into fans
+		static void Load(const string& file, vector<PxVec3>& vertices, vector<PxU32>& indices);
+
+		///64 bit FNV-1a hash, continuing from hash
+		static PxU64 Hash(const void* data, size_t size, PxU64 hash = 14695981039346656037ULL);
+	};
+}
@@ -1,21 +1,290 @@
 #include <iostream>
+#include <string>
+#include <stdexcept>
 #include "VisualDebugger.h"
+#include "Network\GameServer.h"
+#include "Network\LoadGenerator.h"
+#include "Benchmark\PhysicsBenchmark.h"
+#include "Benchmark\RenderBenchmark.h"
+#include "Benchmark\ImportBenchmark.h"
+#include "Replay.h"
+#include "Extras\Renderer.h"
 
 using namespace std;
 
-int main()
+///Value following a command line option, or the default; another option is not a value
+static string Option(int argc, char* argv[], const string& name, const string& default_value = "")
 {
-	try 
-	{ 
-		VisualDebugger::Init("Minigolf - Puetter, David PUE15564059", 1280, 720); 
+	for (int i = 1; i < argc - 1; i++)
+		if ((name == argv[i]) && (string(argv[i + 1]).compare(0, 2, "--") != 0))
+			return argv[i + 1];
+	return default_value;
+}
+
+///Whole number following a command line option, or the default
+static int IntOption(int argc, char* argv[], const string& name, int default_value)
+{
+	const string value = Option(argc, argv, name, to_string(default_value));
+	try
+	{
+		size_t used = 0;
+		const int number = stoi(value, &used);
+		if (used == value.size())
+			return number;
+	}
+	catch (const exception&)
+	{
+	}
+	throw new Exception("Minigolf::IntOption, " + name + " expects a whole number, not " + value + ".");
+}
+
+///Number following a command line option, or the default
+static float FloatOption(int argc, char* argv[], const string& name, float default_value)
+{
+	const string value = Option(argc, argv, name, to_string(default_value));
+	try
+	{
+		size_t used = 0;
+		const float number = stof(value, &used);
+		if (used == value.size())
+			return number;
+	}
+	catch (const exception&)
+	{
+	}
+	throw new Exception("Minigolf::FloatOption, " + name + " expects a number, not " + value + ".");
+}
+
+///Is the flag present on the command line
+static bool Flag(int argc, char* argv[], const string& name)
+{
+	for (int i = 1; i < argc; i++)
+		if (name == argv[i])
+			return true;
+	return false;
+}
+
+///Visual debugger settings: --pvd [off | socket[:host[:port]] | file[:path]] [--pvd-profile] [--pvd-memory]
+static PhysicsEngine::PvdDesc PvdOptions(int argc, char* argv[])
+{
+	PhysicsEngine::PvdDesc pvd;
+	string option = Option(argc, argv, "--pvd", "off");
+	string kind = option.substr(0, option.find(':'));
+	string rest = (option.find(':') == string::npos) ? "" : option.substr(option.find(':') + 1);
+
+	if (kind == "socket")
+	{
+		pvd.mode = PhysicsEngine::PVD_SOCKET;
+		if (rest.size())
+		{
+			pvd.host = rest.substr(0, rest.find(':'));
+			if (rest.find(':') != string::npos)
+			{
+				try
+				{
+					pvd.port = stoi(rest.substr(rest.find(':') + 1));
+				}
+				catch (const exception&)
+				{
+					throw new Exception("Minigolf::PvdOptions, bad port in " + option + ".");
+				}
+			}
+		}
+	}
+	else if (kind == "file")
+	{
+		pvd.mode = PhysicsEngine::PVD_FILE;
+		if (rest.size())
+			pvd.file = rest;
+	}
+	else if (kind != "off")
+		throw new Exception("Minigolf::PvdOptions, unknown PVD mode " + option + ".");
+
+	pvd.profile = Flag(argc, argv, "--pvd-profile");
+	pvd.memory = Flag(argc, argv, "--pvd-memory");
+	return pvd;
+}
+
+///Headless game server: Minigolf --server [unix:path | tcp:port]
+static int RunServer(int argc, char* argv[])
+{
+	Network::ServerDesc desc;
+	desc.endpoint = Network::Endpoint::Parse(Option(argc, argv, "--server", "5500"));
+	desc.max_sessions = IntOption(argc, argv, "--max-sessions", 64);
+
+	PhysicsEngine::PxInit(PvdOptions(argc, argv));
+	Network::Socket::Startup();
+	Network::GameServer server(desc);
+	server.Run();
+	Network::Socket::Shutdown();
+	PhysicsEngine::PxRelease();
+	return 0;
+}
+
+///Loopback load generator: Minigolf --loadgen [unix:path | tcp:port]
+static int RunLoadGenerator(int argc, char* argv[])
+{
+	Network::LoadDesc desc;
+	desc.endpoint = Network::Endpoint::Parse(Option(argc, argv, "--loadgen", "5500"));
+	const int clients = IntOption(argc, argv, "--clients", 4);
+	//the sessions are shared out between the clients
+	if (clients < 1)
+		throw new Exception("Minigolf::RunLoadGenerator, --clients needs at least one client.");
+	desc.clients = clients;
+	desc.sessions = IntOption(argc, argv, "--sessions", 100);
+	desc.shots = IntOption(argc, argv, "--shots", 5);
+	desc.steps = IntOption(argc, argv, "--steps", 120);
+	desc.seed = IntOption(argc, argv, "--seed", 1);
+	desc.stream = Flag(argc, argv, "--stream");
+
+	Network::Socket::Startup();
+	Network::LoadGenerator(desc).Run();
+	Network::Socket::Shutdown();
+	return 0;
+}
+
+///Headless physics benchmark: Minigolf --bench [scenario | all | soak]
+static int RunPhysicsBenchmark(int argc, char* argv[])
+{
+	Benchmark::PhysicsBenchDesc desc;
+	desc.scenario = Option(argc, argv, "--bench", "all");
+	if (desc.scenario.compare(0, 2, "--") == 0)
+		desc.scenario = "all";
+	desc.output = Option(argc, argv, "--out");
+	desc.warmup = IntOption(argc, argv, "--warmup", desc.warmup);
+	desc.steps = IntOption(argc, argv, "--steps", desc.steps);
+	desc.spheres = IntOption(argc, argv, "--spheres", desc.spheres);
+	desc.copies = IntOption(argc, argv, "--copies", desc.copies);
+	desc.flags = IntOption(argc, argv, "--flags", desc.flags);
+	desc.cloth_size = IntOption(argc, argv, "--cloth-size", desc.cloth_size);
+	desc.tiles = IntOption(argc, argv, "--tiles", desc.tiles);
+	desc.seed = IntOption(argc, argv, "--seed", desc.seed);
+	desc.resets = IntOption(argc, argv, "--resets", desc.resets);
+	desc.visualise = Flag(argc, argv, "--visualise");
+
+	PhysicsEngine::PxInit(PvdOptions(argc, argv));
+	Benchmark::RunPhysicsBenchmark(desc);
+	PhysicsEngine::PxRelease();
+	return 0;
+}
+
+///Mesh import benchmark: Minigolf --import-bench [directory]
+static int RunImportBenchmark(int argc, char* argv[])
+{
+	Benchmark::ImportBenchDesc desc;
+	desc.directory = Option(argc, argv, "--import-bench", desc.directory);
+	if (desc.directory.compare(0, 2, "--") == 0)
+		desc.directory = Benchmark::ImportBenchDesc().directory;
+	desc.output = Option(argc, argv, "--out");
+	desc.assets = IntOption(argc, argv, "--assets", desc.assets);
+	desc.triangles = IntOption(argc, argv, "--triangles", desc.triangles);
+	desc.threads = IntOption(argc, argv, "--threads", desc.threads);
+	desc.seed = IntOption(argc, argv, "--seed", desc.seed);
+
+	PhysicsEngine::PxInit(PvdOptions(argc, argv));
+	Benchmark::RunImportBenchmark(desc);
+	PhysicsEngine::PxRelease();
+	return 0;
+}
+
+///Offscreen render benchmark: Minigolf --render-bench [course | generated | green | all]
+static int RunRenderBenchmark(int argc, char* argv[])
+{
+	Benchmark::RenderBenchDesc desc;
+	desc.course = Option(argc, argv, "--render-bench", "all");
+	if (desc.course.compare(0, 2, "--") == 0)
+		desc.course = "all";
+	desc.camera_path = Option(argc, argv, "--camera");
+	desc.output = Option(argc, argv, "--out");
+	desc.frames = IntOption(argc, argv, "--frames", desc.frames);
+	desc.width = IntOption(argc, argv, "--width", desc.width);
+	desc.height = IntOption(argc, argv, "--height", desc.height);
+	desc.tiles = IntOption(argc, argv, "--tiles", desc.tiles);
+	desc.seed = IntOption(argc, argv, "--seed", desc.seed);
+	desc.green_size = IntOption(argc, argv, "--green-size", desc.green_size);
+
+	PhysicsEngine::PxInit(PvdOptions(argc, argv));
+	VisualDebugger::Renderer::RetainStatic(!Flag(argc, argv, "--immediate"));
+	VisualDebugger::Renderer::BatchShapes(!Flag(argc, argv, "--immediate"));
+	VisualDebugger::Renderer::Culling(!Flag(argc, argv, "--no-cull"));
+	VisualDebugger::Renderer::CullDistance(FloatOption(argc, argv, "--cull-distance", 0.f));
+	VisualDebugger::Renderer::BackgroundColor(physx::PxVec3(178.0f / 255.f, 232.f / 255.f, 255.f / 255.f));
+	VisualDebugger::Renderer::SetRenderDetail(20);
+	VisualDebugger::Renderer::InitOffscreen(desc.width, desc.height);
+	VisualDebugger::Renderer::Init();
+	Benchmark::RunRenderBenchmark(desc);
+	VisualDebugger::Renderer::ReleaseOffscreen();
+	PhysicsEngine::PxRelease();
+	return 0;
+}
+
+///Offscreen replay to video frames: Minigolf --capture [file | name%05d.ppm | pipe:command] [--replay recording]
+static int RunCapture(int argc, char* argv[])
+{
+	VisualDebugger::CaptureDesc desc;
+	desc.output = Option(argc, argv, "--capture");
+	if (desc.output.empty() || (desc.output.compare(0, 2, "--") == 0))
+		throw new Exception("Minigolf::RunCapture, no output given.");
+	desc.recording = Option(argc, argv, "--replay");
+	desc.course = Option(argc, argv, "--course", desc.course);
+	desc.width = IntOption(argc, argv, "--width", desc.width);
+	desc.height = IntOption(argc, argv, "--height", desc.height);
+	desc.tiles = IntOption(argc, argv, "--tiles", desc.tiles);
+	desc.seed = IntOption(argc, argv, "--seed", desc.seed);
+	desc.fps = FloatOption(argc, argv, "--fps", desc.fps);
+	desc.duration = FloatOption(argc, argv, "--duration", desc.duration);
+
+	PhysicsEngine::PxInit(PvdOptions(argc, argv));
+	VisualDebugger::Renderer::RetainStatic(!Flag(argc, argv, "--immediate"));
+	VisualDebugger::Renderer::BatchShapes(!Flag(argc, argv, "--immediate"));
+	VisualDebugger::Renderer::BackgroundColor(physx::PxVec3(178.0f / 255.f, 232.f / 255.f, 255.f / 255.f));
+	VisualDebugger::Renderer::SetRenderDetail(20);
+	VisualDebugger::Renderer::InitOffscreen(desc.width, desc.height);
+	VisualDebugger::Renderer::Init();
+	VisualDebugger::RunCapture(desc);
+	VisualDebugger::Renderer::ReleaseOffscreen();
+	PhysicsEngine::PxRelease();
+	return 0;
+}
+
+int main(int argc, char* argv[])
+{
+	try
+	{
+		PhysicsEngine::ArenaMode(Flag(argc, argv, "--arena"));
+
+		if (Flag(argc, argv, "--server"))
+			return RunServer(argc, argv);
+		if (Flag(argc, argv, "--loadgen"))
+			return RunLoadGenerator(argc, argv);
+		if (Flag(argc, argv, "--bench"))
+			return RunPhysicsBenchmark(argc, argv);
+		if (Flag(argc, argv, "--render-bench"))
+			return RunRenderBenchmark(argc, argv);
+		if (Flag(argc, argv, "--import-bench"))
+			return RunImportBenchmark(argc, argv);
+		if (Flag(argc, argv, "--capture"))
+			return RunCapture(argc, argv);
+
+		VisualDebugger::RecordCamera(Option(argc, argv, "--record-camera"));
+		VisualDebugger::Threaded(Flag(argc, argv, "--threaded"));
+		VisualDebugger::Renderer::RetainStatic(!Flag(argc, argv, "--immediate"));
+		VisualDebugger::Renderer::BatchShapes(!Flag(argc, argv, "--immediate"));
+		VisualDebugger::Renderer::Culling(!Flag(argc, argv, "--no-cull"));
+		VisualDebugger::Renderer::CullDistance(FloatOption(argc, argv, "--cull-distance", 0.f));
+		VisualDebugger::Renderer::FrameRate(FloatOption(argc, argv, "--fps", 60.f));
+		VisualDebugger::Renderer::OnDemand(Flag(argc, argv, "--on-demand"));
+
+		VisualDebugger::Init("Minigolf - Puetter, David PUE15564059", 1280, 720, PvdOptions(argc, argv));
 	}
-	catch (Exception exc) 
-	{ 
-		cerr << exc.what() << endl;
-		return 0; 
+	catch (Exception* exc)
+	{
+		cerr << exc->what() << endl;
+		delete exc;
+		return 0;
 	}
 
 	VisualDebugger::Start();
 
 	return 0;
-}
\ No newline at end of file
+}
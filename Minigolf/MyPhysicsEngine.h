@@ -112,6 +112,12 @@ namespace PhysicsEngine
 
 		PxVec3 lastPos = PxVec3(0, 0, 0);
 
+		//force applied per unit of shot strength
+		PxReal shot_force = 3.0f;
+
+		//drive target of the sliding bars, relative to the joint frame on their tile
+		PxTransform slider_target = PxTransform(-3.4f, 1.6f, -12.0f);
+
 		struct FilterGroup {
 			enum Enum {
 				ePLAYERBALL			= (1 << 0),
@@ -125,23 +131,82 @@ namespace PhysicsEngine
 		CollisionCallback* cCallback;
 		bool hasGameEnded;
 
-		MyScene() : Scene() {
+		///Debug visualisation categories
+		enum VisualisationFlags {
+			VIS_COLLISION_SHAPES = (1 << 0),
+			VIS_ACTOR_AXES = (1 << 1),
+			VIS_JOINTS = (1 << 2),
+			VIS_CLOTH = (1 << 3),
+			VIS_ALL = VIS_COLLISION_SHAPES | VIS_ACTOR_AXES | VIS_JOINTS | VIS_CLOTH
+		};
+
+	private:
+		//off unless the debug buffer is drawn, PhysX skips filling it at scale 0
+		bool visualise;
+		PxU32 visualisation;
+		PxBounds3 visualisation_box;
+
+	public:
+		MyScene() : Scene(), cCallback(new CollisionCallback()), visualise(false), visualisation(VIS_ALL),
+			visualisation_box(PxBounds3::empty()) {
 			filter_shader = CustomFilterShader;
 		};
 
-		///A custom scene class
+		virtual ~MyScene() {
+			delete cCallback;
+		}
+
+		virtual void Capture(Snapshot& snapshot, bool skip_retained)
+		{
+			Scene::Capture(snapshot, skip_retained);
+			snapshot.game_ended = hasGameEnded;
+		}
+
+		///Apply the visualisation settings to the PhysX scene
 		void SetVisualisation()
 		{
-			px_scene->setVisualizationParameter(PxVisualizationParameter::eSCALE, 1.0f);
-			px_scene->setVisualizationParameter(PxVisualizationParameter::eCOLLISION_SHAPES, 1.0f);
-			px_scene->setVisualizationParameter(PxVisualizationParameter::eACTOR_AXES, 2.0f);
-			px_scene->setVisualizationParameter(PxVisualizationParameter::eJOINT_LOCAL_FRAMES, 2.0f);
-			px_scene->setVisualizationParameter(PxVisualizationParameter::eJOINT_LIMITS, 2.0f);
-
-			px_scene->setVisualizationParameter(PxVisualizationParameter::eCLOTH_HORIZONTAL, 1.0f);
-			px_scene->setVisualizationParameter(PxVisualizationParameter::eCLOTH_VERTICAL, 1.0f);
-			px_scene->setVisualizationParameter(PxVisualizationParameter::eCLOTH_BENDING, 1.0f);
-			px_scene->setVisualizationParameter(PxVisualizationParameter::eCLOTH_SHEARING, 1.0f);
+			const PxReal shapes = (visualisation & VIS_COLLISION_SHAPES) ? 1.0f : 0.0f;
+			const PxReal axes = (visualisation & VIS_ACTOR_AXES) ? 2.0f : 0.0f;
+			const PxReal joints = (visualisation & VIS_JOINTS) ? 2.0f : 0.0f;
+			const PxReal cloth = (visualisation & VIS_CLOTH) ? 1.0f : 0.0f;
+
+			px_scene->setVisualizationParameter(PxVisualizationParameter::eSCALE, (visualise && visualisation) ? 1.0f : 0.0f);
+			px_scene->setVisualizationParameter(PxVisualizationParameter::eCOLLISION_SHAPES, shapes);
+			px_scene->setVisualizationParameter(PxVisualizationParameter::eACTOR_AXES, axes);
+			px_scene->setVisualizationParameter(PxVisualizationParameter::eJOINT_LOCAL_FRAMES, joints);
+			px_scene->setVisualizationParameter(PxVisualizationParameter::eJOINT_LIMITS, joints);
+
+			px_scene->setVisualizationParameter(PxVisualizationParameter::eCLOTH_HORIZONTAL, cloth);
+			px_scene->setVisualizationParameter(PxVisualizationParameter::eCLOTH_VERTICAL, cloth);
+			px_scene->setVisualizationParameter(PxVisualizationParameter::eCLOTH_BENDING, cloth);
+			px_scene->setVisualizationParameter(PxVisualizationParameter::eCLOTH_SHEARING, cloth);
+
+			px_scene->setVisualizationCullingBox(visualisation_box);
+		}
+
+		///Fill the debug render buffer every step (off by default)
+		void Visualise(bool value)
+		{
+			visualise = value;
+			SetVisualisation();
+		}
+
+		bool Visualise() { return visualise; }
+
+		///Visualisation categories to generate, VIS_ALL by default
+		void Visualisation(PxU32 categories)
+		{
+			visualisation = categories;
+			SetVisualisation();
+		}
+
+		PxU32 Visualisation() { return visualisation; }
+
+		///Generate the debug geometry only within the box, empty for the whole scene
+		void VisualisationBox(const PxBounds3& box)
+		{
+			visualisation_box = box;
+			px_scene->setVisualizationCullingBox(box);
 		}
 
 		//Custom scene initialisation
@@ -151,9 +216,10 @@ namespace PhysicsEngine
 
 			GetMaterial()->setDynamicFriction(.2f);
 
-			cCallback = new CollisionCallback();
+			//one callback for the lifetime of the scene, cleared on every reset
+			*cCallback = CollisionCallback();
 			px_scene->setSimulationEventCallback(cCallback);
-			
+			hasGameEnded = false;
 
 			CreateScene();
 		}
@@ -169,15 +235,36 @@ namespace PhysicsEngine
 			}
 		}
 
-		void CreateScene() {
-			Plane* plane = new Plane();
+		///Hit the player ball along the horizontal part of dir
+		void Shoot(const PxVec3& dir, PxReal strength) {
+			PxRigidDynamic* ball = GetSelectedActor();
+			if (!ball)
+				return;
+			lastPos = ball->getGlobalPose().p;
+			ball->addForce(PxVec3(dir.x, 0.0f, dir.z).getNormalized() * shot_force * strength);
+		}
+
+		///The ball has stopped and can be hit again
+		bool BallAtRest() {
+			PxRigidDynamic* ball = GetSelectedActor();
+			return !ball || ball->isSleeping() || (ball->getLinearVelocity() == PxVec3(0.0f, 0.0f, 0.0f));
+		}
+
+		///Ground plane, the ball is reset when it touches it
+		Plane* AddGround() {
+			Plane* plane = Create<Plane>();
 			plane->Color(PxVec4(171.0f / 255.0f, 226.0f / 255.0f, 158.0f / 255.0f, 1.0f));
 			plane->Name("plane");
+			plane->SetupFiltering(FilterGroup::ePLANE, FilterGroup::ePLAYERBALL);
 			Add(plane);
+			return plane;
+		}
 
-			Sphere* playerBall = new Sphere(PxTransform(PxVec3(0.0f, 1.7f, 0.0f)), 0.3f, 1.0f);
+		///Player ball, add it before any other dynamic actor so that it gets selected
+		Sphere* AddBall(const PxVec3& pos) {
+			Sphere* playerBall = Create<Sphere>(PxTransform(pos), 0.3f, 1.0f);
 			playerBall->Color(PxVec4(1.0f, 1.0f, 1.0f, 1.0f));
-			PxMaterial* ballMat = CreateMaterial(0.4f, 0.05f, 0.8f);
+			PxMaterial* ballMat = SharedMaterial(0.4f, 0.05f, 0.8f);
 			playerBall->GetShape(0)->setMaterials(&ballMat, 1);
 			playerBall->Name("playerball");
 			((PxRigidBody*)playerBall->Get())->setRigidBodyFlag(PxRigidBodyFlag::eENABLE_CCD, true);
@@ -185,282 +272,287 @@ namespace PhysicsEngine
 			PxRigidDynamic* playerBallRD = ((PxRigidDynamic*)playerBall->Get());
 			playerBallRD->setAngularDamping(2.0f);
 
-			Add(playerBall);						
-
-			/* COURSE STARTS HERE*/
-
-			// TEE 
-			PathStart* tee = new PathStart(PxTransform(PxVec3(0.0f, 1.0f, 0.0f)));
-			Add(tee);
-
-			// STRAIGHT PATH WITH SLIDING d6
-			PathStraight* straight1 = new PathStraight(PxTransform(PxVec3(0.0f, 1.0f, -8.0f)));
-			Add(straight1);
+			playerBall->SetupFiltering(FilterGroup::ePLAYERBALL, FilterGroup::ePLANE);
+			Add(playerBall);
+			return playerBall;
+		}
 
-			Box* d6Box = new Box(PxTransform(3.4f, 1.9f, -12.0f), PxVec3(0.2f, 0.2f, 4.0f));	
-			D6Joint* d6joint1 = new D6Joint(nullptr, PxTransform(3.4f, 1.6f, -12.0f), d6Box->Get(), PxTransform(0.0f, 0.0f, 0.0f));
+		///Bar sliding across a straight, driven by a D6 joint
+		void AddSlider(const PxVec3& tile) {
+			Box* d6Box = Create<Box>(PxTransform(tile + PxVec3(3.4f, 0.9f, -4.0f)), PxVec3(0.2f, 0.2f, 4.0f));
+			D6Joint* d6joint1 = Create<D6Joint>(nullptr, PxTransform(tile + PxVec3(3.4f, 0.6f, -4.0f)), d6Box->Get(), PxTransform(0.0f, 0.0f, 0.0f));
 			((PxD6Joint*)d6joint1->Get())->setMotion(PxD6Axis::eX, PxD6Motion::eFREE);
 
 			PxD6JointDrive drive = PxD6JointDrive(PX_MAX_REAL, 0.0f, 1.0f);
 
 			((PxD6Joint*)d6joint1->Get())->setDrive(PxD6Drive::eX, drive);
 
-			((PxD6Joint*)d6joint1->Get())->setDrivePosition(PxTransform(-3.4f, 1.6f, -12.0f));
+			((PxD6Joint*)d6joint1->Get())->setDrivePosition(slider_target);
 			((PxD6Joint*)d6joint1->Get())->setDriveVelocity(PxVec3(1.0f, 0.0f, 0.0f), PxVec3(0.0f, 0.0f, 0.0f));
 			Add(d6Box);
+		}
+
+		///Windmill lying flat on a straight rotated by 90 degrees
+		void AddFlatWindmill(const PxVec3& tile) {
+			WindMill* wmPS = Create<WindMill>(PxTransform(tile + PxVec3(0.0f, 0.6f, 0.0f), PxQuat(1.5708f, PxVec3(1, 0, 0))));
+			wmPS->Get()->setActorFlag(PxActorFlag::eDISABLE_GRAVITY, true);
+			Add(wmPS);
+			RevoluteJoint* WindmillFlatJoint = Create<RevoluteJoint>(nullptr, PxTransform(tile + PxVec3(0.0f, 0.6f, 0.0f), PxQuat(PxPi / 2, PxVec3(0, 0, 1))), wmPS, PxTransform(PxTransform(0.0f, 0.0f, 0.0f)));
+			WindmillFlatJoint->DriveVelocity(1.0f);
+		}
+
+		///Windmill turning in the frame of a PathWindMill
+		void AddTallWindmill(const PxVec3& tile) {
+			WindMill* wm = Create<WindMill>(PxTransform(tile + PxVec3(0.0f, 3.9f, -0.1f)));
+			wm->Get()->setActorFlag(PxActorFlag::eDISABLE_GRAVITY, true);
+			Add(wm);
+			RevoluteJoint* WindmillJoint = Create<RevoluteJoint>(nullptr, PxTransform(tile + PxVec3(0.0f, 3.9f, -0.65f), PxQuat(PxPi / 2, PxVec3(0.0f, 1.0f, 0.0f))), wm, PxTransform(PxVec3(0.0f, 0.0f, 0.0f)));
+			WindmillJoint->DriveVelocity(1.0f);
+		}
+
+		///Free bar on a prismatic joint, for a corner rotated by -90 degrees
+		void AddPrismaticSlider(const PxVec3& tile) {
+			Box* prismaticSlider = Create<Box>(PxTransform(tile + PxVec3(-4.0f, 0.65f, 0.0f)), PxVec3(0.2f, 0.2f, 3.55f));
+			PrismaticJoint* prismaticSliderJoint = Create<PrismaticJoint>(nullptr, PxTransform(tile + PxVec3(-4.0f, 0.65f, 0.0f)), prismaticSlider->Get(), PxTransform(0.0f, 0.0f, 0.0f));
+			Add(prismaticSlider);
+		}
+
+		///Two doors held shut by a breakable fixed joint and hinged with D6 joints
+		void AddDoors(const PxVec3& tile) {
+			Box* doorright = Create<Box>(PxTransform(tile + PxVec3(1.8f, 2.2f, 0.0f)), PxVec3(1.60f, 1.8f, 0.2f), 0.01f);
+			Box* doorleft = Create<Box>(PxTransform(tile + PxVec3(-1.8f, 2.2f, 0.0f)), PxVec3(1.60f, 1.8f, 0.2f), 0.01f);
+
+			FixedJoint* doorFixedJoint = Create<FixedJoint>(doorleft->Get(), PxTransform(0.0f, 0.0f, 0.0f), doorright->Get(), PxTransform(0.0f, 0.0f, 0.0f));
+			((PxFixedJoint*)doorFixedJoint->Get())->setBreakForce(500.0f, 500.0f);
+
+			D6Joint* doorrightd6 = Create<D6Joint>(nullptr, PxTransform(tile + PxVec3(3.5f, 2.2f, 0.0f)), doorright->Get(), PxTransform(1.8f, 0.0f, 0.0f));
+			((PxD6Joint*)doorrightd6->Get())->setMotion(PxD6Axis::eSWING1, PxD6Motion::eFREE);
+
+			D6Joint* doorleftd6 = Create<D6Joint>(nullptr, PxTransform(tile + PxVec3(-3.5f, 2.2f, 0.0f)), doorleft->Get(), PxTransform(-1.8f, 0.0f, 0.0f));
+			((PxD6Joint*)doorleftd6->Get())->setMotion(PxD6Axis::eSWING1, PxD6Motion::eFREE);
+
+			Add(doorright);
+			Add(doorleft);
+		}
+
+		///Five bars dangling from spherical joints across a straight rotated by 90 degrees
+		void AddDangles(const PxVec3& tile) {
+			const PxReal offsets[] = { 0.0f, 1.0f, -1.0f, -2.0f, 2.0f };
+			for (PxU32 i = 0; i < 5; i++) {
+				Box* dangle = Create<Box>(PxTransform(tile + PxVec3(0.0f, 2.4f, offsets[i])), PxVec3(0.2f, 2.0f, 0.2f));
+				Create<SphericalJoint>(nullptr, PxTransform(tile + PxVec3(0.0f, 4.5f, offsets[i])), dangle->Get(), PxTransform(0.0f, 2.0f, 0.0f));
+				Add(dangle);
+			}
+		}
+
+		///Pole, flag and the finish trigger in the cup of a PathHole
+		void AddFinish(const PxVec3& tile) {
+			Capsule* pole = Create<Capsule>(PxTransform(tile + PxVec3(0.0f, 3.0f, 0.0f), PxQuat(1.5708f, PxVec3(0, 0, 1))), PxVec2(0.05f, 4.0f));
+			pole->SetKinematic(true);
+			pole->Color(PxVec4(0.9f, 0.0f, 0.0f, 1.0f));
+			pole->GetShape(0)->setFlag(PxShapeFlag::eSIMULATION_SHAPE, false);
+			Add(pole);
+
+			Cloth* flag = Create<Cloth>(PxTransform(tile + PxVec3(0.0f, 5.5f, 0.0f), PxQuat(1.5708f, PxVec3(0, 0, 1))), PxVec2(1.5f, 1.5f), 10, 10);
+			flag->Color(PxVec4(1, 1, 1, 1));
+			((PxCloth*)flag->Get())->setExternalAcceleration(PxVec3(-10.0f, 3.0f, 5.0f));
+			Add(flag);
+
+			Box* holeTrigger = Create<Box>(PxTransform(tile + PxVec3(0.0f, -0.5f, 0.0f)), PxVec3(0.35f, 0.45f, 0.35f));
+			holeTrigger->SetKinematic(true);
+			holeTrigger->SetTrigger(true, 0);
+			holeTrigger->Color(PxVec4(1.0f, 1.0f, 1.0f, 0.0f));
+			Add(holeTrigger);
+		}
+
+		///Two spheres adjoined by a breakable fixed joint
+		void AddSpherePair(const PxVec3& pos) {
+			Sphere* sp1 = Create<Sphere>(PxTransform(pos + PxVec3(0.0f, 0.0f, -1.0f)), 0.5f, 0.1f);
+			Sphere* sp2 = Create<Sphere>(PxTransform(pos + PxVec3(0.0f, 0.0f, 1.0f)), 0.5f, 0.1f);
+			Add(sp1);
+			Add(sp2);
+
+			FixedJoint* fj = Create<FixedJoint>(sp1->Get(), PxTransform(pos + PxVec3(0.0f, 0.0f, -1.0f)), sp2->Get(), PxTransform(pos + PxVec3(0.0f, 0.0f, 1.0f)));
+			((PxFixedJoint*)fj->Get())->setBreakForce(500.0f, 500.0f);
+		}
+
+		///Build the course, override to build a different one
+		virtual void CreateScene() {
+			AddGround();
+			AddBall(PxVec3(0.0f, 1.7f, 0.0f));
+
+			/* COURSE STARTS HERE*/
+
+			// TEE 
+			PathStart* tee = Create<PathStart>(PxTransform(PxVec3(0.0f, 1.0f, 0.0f)));
+			Add(tee);
+
+			// STRAIGHT PATH WITH SLIDING d6
+			PathStraight* straight1 = Create<PathStraight>(PxTransform(PxVec3(0.0f, 1.0f, -8.0f)));
+			Add(straight1);
+			AddSlider(PxVec3(0.0f, 1.0f, -8.0f));
 
 			// EMPTY STRAIGHT PATH
 
-			PathStraight* straight2 = new PathStraight(PxTransform(PxVec3(0.0f, 1.0f, -16.0f)));
+			PathStraight* straight2 = Create<PathStraight>(PxTransform(PxVec3(0.0f, 1.0f, -16.0f)));
 			Add(straight2);
 
 			// SLANTED CORNER
 
-			PathCorner* slantedCorner1 = new PathCorner(PxTransform(PxVec3(0.0f, 1.0f, -24.0f)), true);
+			PathCorner* slantedCorner1 = Create<PathCorner>(PxTransform(PxVec3(0.0f, 1.0f, -24.0f)), true);
 			Add(slantedCorner1);
 
 			// EMPTY STRAIGHT ROT 90
 
-			PathStraight* straight3 = new PathStraight(PxTransform(PxVec3(8.0f, 1.0f, -24.0f), PxQuat(1.5708f, PxVec3(0, 1, 0))));
+			PathStraight* straight3 = Create<PathStraight>(PxTransform(PxVec3(8.0f, 1.0f, -24.0f), PxQuat(1.5708f, PxVec3(0, 1, 0))));
 			Add(straight3);
 
 			// STRAIGHT ROT 90 w/ FLAT WINDMILL
 
-			PathStraight* straight4 = new PathStraight(PxTransform(PxVec3(16.0f, 1.0f, -24.0f), PxQuat(1.5708f, PxVec3(0, 1, 0))));
+			PathStraight* straight4 = Create<PathStraight>(PxTransform(PxVec3(16.0f, 1.0f, -24.0f), PxQuat(1.5708f, PxVec3(0, 1, 0))));
 			Add(straight4);
-
-			WindMill* wmPS = new WindMill(PxTransform(PxVec3(16.0f, 1.6f, -24.0f), PxQuat(1.5708f, PxVec3(1, 0, 0))));
-			wmPS->Get()->setActorFlag(PxActorFlag::eDISABLE_GRAVITY, true);
-			Add(wmPS);
-			RevoluteJoint WindmillFlatJoint = RevoluteJoint(nullptr, PxTransform(PxVec3(16.0f, 1.6f, -24.0f), PxQuat(PxPi / 2, PxVec3(0, 0, 1))), wmPS, PxTransform(PxTransform(0.0f, 0.0f, 0.0f)));
-			WindmillFlatJoint.DriveVelocity(1.0f);
+			AddFlatWindmill(PxVec3(16.0f, 1.0f, -24.0f));
 
 			// EMPTY STRAIGHT ROT 90
 
-			PathStraight* straight5 = new PathStraight(PxTransform(PxVec3(24.0f, 1.0f, -24.0f), PxQuat(1.5708f, PxVec3(0, 1, 0))));
+			PathStraight* straight5 = Create<PathStraight>(PxTransform(PxVec3(24.0f, 1.0f, -24.0f), PxQuat(1.5708f, PxVec3(0, 1, 0))));
 			Add(straight5);
 
 			// CORNER ROT -90 w/ PRISMATIC SLIDER
-			PathCorner* corner1 = new PathCorner(PxTransform(PxVec3(32.0f, 1.0f, -24.0f), PxQuat(-1.5708f, PxVec3(0, 1, 0))));
+			PathCorner* corner1 = Create<PathCorner>(PxTransform(PxVec3(32.0f, 1.0f, -24.0f), PxQuat(-1.5708f, PxVec3(0, 1, 0))));
 			Add(corner1);
-
-			Box* prismaticSlider = new Box(PxTransform(28.0f, 1.65f, -24.0f), PxVec3(0.2f, 0.2f, 3.55f));
-			PrismaticJoint* prismaticSliderJoint = new PrismaticJoint(nullptr, PxTransform(28.0f, 1.65f, -24.0f), prismaticSlider->Get(), PxTransform(0.0f, 0.0f, 0.0f));
-			Add(prismaticSlider);
+			AddPrismaticSlider(PxVec3(32.0f, 1.0f, -24.0f));
 
 			// EMPTY STRAIGHT 
 
-			PathStraight* straight6 = new PathStraight(PxTransform(PxVec3(32.0f, 1.0f, -16.0f)));
+			PathStraight* straight6 = Create<PathStraight>(PxTransform(PxVec3(32.0f, 1.0f, -16.0f)));
 			Add(straight6);
 
 			// STRAIGHT WITH D6JOINT DOORS
 
-			PathStraight* straight7 = new PathStraight(PxTransform(PxVec3(32.0f, 1.0f, -8.0f)));
+			PathStraight* straight7 = Create<PathStraight>(PxTransform(PxVec3(32.0f, 1.0f, -8.0f)));
 			Add(straight7);
-
-			Box* doorright = new Box(PxTransform(33.8f, 3.2f, -8.0f), PxVec3(1.60f, 1.8f, 0.2f), 0.01f);	
-			Box* doorleft = new Box(PxTransform(30.2f, 3.2f, -8.0f), PxVec3(1.60f, 1.8f, 0.2f), 0.01f);
-
-			FixedJoint* doorFixedJoint = new FixedJoint(doorleft->Get(), PxTransform(0.0f, 0.0f, 0.0f), doorright->Get(), PxTransform(0.0f, 0.0f, 0.0f));
-			((PxFixedJoint*)doorFixedJoint->Get())->setBreakForce(500.0f, 500.0f);
-
-			D6Joint* doorrightd6 = new D6Joint(nullptr, PxTransform(35.5f, 3.2f, -8.0f), doorright->Get(), PxTransform(1.8f, 0.0f, 0.0f));
-			((PxD6Joint*)doorrightd6->Get())->setMotion(PxD6Axis::eSWING1, PxD6Motion::eFREE);
-
-			D6Joint* doorleftd6 = new D6Joint(nullptr, PxTransform(28.5f, 3.2f, -8.0f), doorleft->Get(), PxTransform(-1.8f, 0.0f, 0.0f));
-			((PxD6Joint*)doorleftd6->Get())->setMotion(PxD6Axis::eSWING1, PxD6Motion::eFREE);
-
-			Add(doorright);
-			Add(doorleft);
+			AddDoors(PxVec3(32.0f, 1.0f, -8.0f));
 
 			// EMPTY STRAIGHT
 
-			PathStraight* straight8 = new PathStraight(PxTransform(PxVec3(32.0f, 1.0f, 0.0f)));
+			PathStraight* straight8 = Create<PathStraight>(PxTransform(PxVec3(32.0f, 1.0f, 0.0f)));
 			Add(straight8);
 
 			// STRAIGHT w/ TALL WINDMILL
 
-			PathWindMill* windmillPath = new PathWindMill(PxTransform(PxVec3(32.0f, 1.0f, 8.0f)));
+			PathWindMill* windmillPath = Create<PathWindMill>(PxTransform(PxVec3(32.0f, 1.0f, 8.0f)));
 			Add(windmillPath);
-
-			WindMill* wm = new WindMill(PxTransform(32.0f, 4.9f, 7.9f));
-			wm->Get()->setActorFlag(PxActorFlag::eDISABLE_GRAVITY, true);
-			Add(wm);
-			RevoluteJoint WindmillJoint = RevoluteJoint(nullptr, PxTransform(PxVec3(32.0f, 4.9f, 7.35f), PxQuat(PxPi / 2, PxVec3(0.0f, 1.0f, 0.0f))), wm, PxTransform(PxVec3(0.0f, 0.0f, 0.0f)));
-			WindmillJoint.DriveVelocity(1.0f);
+			AddTallWindmill(PxVec3(32.0f, 1.0f, 8.0f));
 
 			// SHARP CORNER
 
-			PathCorner* corner2 = new PathCorner(PxTransform(PxVec3(32.0f, 1.0f, 16.0f), PxQuat(1.5708f, PxVec3(0, 1, 0))));
+			PathCorner* corner2 = Create<PathCorner>(PxTransform(PxVec3(32.0f, 1.0f, 16.0f), PxQuat(1.5708f, PxVec3(0, 1, 0))));
 			Add(corner2);
 
 			// STRAIGHT w/ DANGLING SPHERICAL JOINTS
 
-			PathStraight* straight9 = new PathStraight(PxTransform(PxVec3(40.0f, 1.0f, 16.0f), PxQuat(1.5708f, PxVec3(0, 1, 0))));
+			PathStraight* straight9 = Create<PathStraight>(PxTransform(PxVec3(40.0f, 1.0f, 16.0f), PxQuat(1.5708f, PxVec3(0, 1, 0))));
 			Add(straight9);
-
-			Box* dangle1 = new Box(PxTransform(40.0f, 3.4f, 16.0f), PxVec3(0.2f, 2.0f, 0.2f));
-			Box* dangle2 = new Box(PxTransform(40.0f, 3.4f, 17.0f), PxVec3(0.2f, 2.0f, 0.2f));
-			Box* dangle3 = new Box(PxTransform(40.0f, 3.4f, 15.0f), PxVec3(0.2f, 2.0f, 0.2f));
-			Box* dangle4 = new Box(PxTransform(40.0f, 3.4f, 14.0f), PxVec3(0.2f, 2.0f, 0.2f));
-			Box* dangle5 = new Box(PxTransform(40.0f, 3.4f, 18.0f), PxVec3(0.2f, 2.0f, 0.2f));
-
-			SphericalJoint(nullptr, PxTransform(40.0f, 5.5f, 16.0f), dangle1->Get(), PxTransform(0.0f, 2.0f, 0.0f));
-			SphericalJoint(nullptr, PxTransform(40.0f, 5.5f, 17.0f), dangle2->Get(), PxTransform(0.0f, 2.0f, 0.0f));
-			SphericalJoint(nullptr, PxTransform(40.0f, 5.5f, 15.0f), dangle3->Get(), PxTransform(0.0f, 2.0f, 0.0f));
-			SphericalJoint(nullptr, PxTransform(40.0f, 5.5f, 14.0f), dangle4->Get(), PxTransform(0.0f, 2.0f, 0.0f));
-			SphericalJoint(nullptr, PxTransform(40.0f, 5.5f, 18.0f), dangle5->Get(), PxTransform(0.0f, 2.0f, 0.0f));
-
-			Add(dangle1);
-			Add(dangle2);
-			Add(dangle3);
-			Add(dangle4);
-			Add(dangle5);
+			AddDangles(PxVec3(40.0f, 1.0f, 16.0f));
 
 			// EMPTY STRAIGHT 
 
-			PathStraight* straight10 = new PathStraight(PxTransform(PxVec3(48.0f, 1.0f, 16.0f), PxQuat(1.5708f, PxVec3(0, 1, 0))));
+			PathStraight* straight10 = Create<PathStraight>(PxTransform(PxVec3(48.0f, 1.0f, 16.0f), PxQuat(1.5708f, PxVec3(0, 1, 0))));
 			Add(straight10);
 
 			// STRAIGHT w/ BOUNCY MIDDLE
 
-			Trampoline* tramp1 = new Trampoline(PxTransform(56.0f, 0.0f, 16.0f), PxVec3(3.90f, 2.0f, 4.0f), 4.0f, 0.01f, 0.1f);
+			Trampoline* tramp1 = Create<Trampoline>(this, PxTransform(56.0f, 0.0f, 16.0f), PxVec3(3.90f, 2.0f, 4.0f), 4.0f, 0.01f, 0.1f);
 			tramp1->AddToScene(this);
 			
 			// EMPTY STRAIGHT
 
-			PathStraight* straight11 = new PathStraight(PxTransform(PxVec3(64.0f, 1.0f, 16.0f), PxQuat(1.5708f, PxVec3(0, 1, 0))));
+			PathStraight* straight11 = Create<PathStraight>(PxTransform(PxVec3(64.0f, 1.0f, 16.0f), PxQuat(1.5708f, PxVec3(0, 1, 0))));
 			Add(straight11);
 
 			// SPLIT WEDGE
 
-			PathSplitWedge* splitWedgePath = new PathSplitWedge(PxTransform(PxVec3(72.0f, 1.0f, 16.0f), PxQuat(-1.5708f, PxVec3(0, 1, 0))));
+			PathSplitWedge* splitWedgePath = Create<PathSplitWedge>(PxTransform(PxVec3(72.0f, 1.0f, 16.0f), PxQuat(-1.5708f, PxVec3(0, 1, 0))));
 			Add(splitWedgePath);
 
 			// EMPTY STRAIGHT GOING UP
 
-			PathStraight* straight12 = new PathStraight(PxTransform(PxVec3(72.0f, 1.0f, 8.0f)));
+			PathStraight* straight12 = Create<PathStraight>(PxTransform(PxVec3(72.0f, 1.0f, 8.0f)));
 			Add(straight12);
 
 			// EMPTY STRAIGHT GOING DOWN
 
-			PathStraight* straight13 = new PathStraight(PxTransform(PxVec3(72.0f, 1.0f, 24.0f)));
+			PathStraight* straight13 = Create<PathStraight>(PxTransform(PxVec3(72.0f, 1.0f, 24.0f)));
 			Add(straight13);
 
 			// TUNNEL GOING UP
 
-			PathTunnel* pathTunnelUp = new PathTunnel(PxTransform(72.0f, 1.0f, 0.0f));
+			PathTunnel* pathTunnelUp = Create<PathTunnel>(PxTransform(72.0f, 1.0f, 0.0f));
 			Add(pathTunnelUp);
 
 			// TUNNEL GOING DOWN
 
-			PathTunnel* pathTunnelDown = new PathTunnel(PxTransform(72.0f, 1.0f, 32.0f));
+			PathTunnel* pathTunnelDown = Create<PathTunnel>(PxTransform(72.0f, 1.0f, 32.0f));
 			Add(pathTunnelDown);
 
 			// ICE UP 1
 
-			PathStraight* straight14 = new PathStraight(PxTransform(PxVec3(72.0f, 1.0f, -8.0f)), S_ICE);
+			PathStraight* straight14 = Create<PathStraight>(PxTransform(PxVec3(72.0f, 1.0f, -8.0f)), S_ICE);
 			Add(straight14);
 
 			// ICE UP 2
 
-			PathStraight* straight15 = new PathStraight(PxTransform(PxVec3(72.0f, 1.0f, -16.0f)), S_ICE);
+			PathStraight* straight15 = Create<PathStraight>(PxTransform(PxVec3(72.0f, 1.0f, -16.0f)), S_ICE);
 			Add(straight15);
 
 			// ICE UP 3
 
-			PathStraight* straight16 = new PathStraight(PxTransform(PxVec3(72.0f, 1.0f, -24.0f)), S_ICE);
+			PathStraight* straight16 = Create<PathStraight>(PxTransform(PxVec3(72.0f, 1.0f, -24.0f)), S_ICE);
 			Add(straight16);
 
 			// SAND DOWN 1
 
-			PathStraight* straight17 = new PathStraight(PxTransform(PxVec3(72.0f, 1.0f, 40.0f)), S_SAND);
+			PathStraight* straight17 = Create<PathStraight>(PxTransform(PxVec3(72.0f, 1.0f, 40.0f)), S_SAND);
 			Add(straight17);
 
 			// SAND DOWN 2
 
-			PathStraight* straight18 = new PathStraight(PxTransform(PxVec3(72.0f, 1.0f, 48.0f)), S_SAND);
+			PathStraight* straight18 = Create<PathStraight>(PxTransform(PxVec3(72.0f, 1.0f, 48.0f)), S_SAND);
 			Add(straight18);
 
 			// SAND DOWN 3
 
-			PathStraight* straight19 = new PathStraight(PxTransform(PxVec3(72.0f, 1.0f, 56.0f)), S_SAND);
+			PathStraight* straight19 = Create<PathStraight>(PxTransform(PxVec3(72.0f, 1.0f, 56.0f)), S_SAND);
 			Add(straight19);
 
-			Box* sandStopper = new Box(PxTransform(72.0f, 1.0f, 59.8f), PxVec3(3.6f, 1.0f, 0.2f));
+			Box* sandStopper = Create<Box>(PxTransform(72.0f, 1.0f, 59.8f), PxVec3(3.6f, 1.0f, 0.2f));
 			sandStopper->SetKinematic(true);
 			sandStopper->Color(PxVec4(156.f / 255.f, 84.f / 255.f, 16.f / 255.f, 1.0f));
 			Add(sandStopper);
 
 			// SAND TOP TRAP
 
-			PathStraight* straight20 = new PathStraight(PxTransform(PxVec3(72.0f, 1.0f, -32.0f)), S_SAND);
+			PathStraight* straight20 = Create<PathStraight>(PxTransform(PxVec3(72.0f, 1.0f, -32.0f)), S_SAND);
 			Add(straight20);
 
 			// INCLINE PATH
 
-			PathSharpIncline* sharpInclinePath = new PathSharpIncline(PxTransform(PxVec3(72.0f, 1.0f, -40.0f)));
+			PathSharpIncline* sharpInclinePath = Create<PathSharpIncline>(PxTransform(PxVec3(72.0f, 1.0f, -40.0f)));
 			Add(sharpInclinePath);
 
 			// FINISH HOLE
 
-			PathHole* hole = new PathHole(PxTransform(PxVec3(72.0f, 1.0f, -48.0f)));
+			PathHole* hole = Create<PathHole>(PxTransform(PxVec3(72.0f, 1.0f, -48.0f)));
 			Add(hole);
 
-			// FINISH FLAG 
+			// FINISH FLAG AND TRIGGER
 
-			Capsule* pole = new Capsule(PxTransform(PxVec3(72.0f, 4.0f, -48.0f), PxQuat(1.5708f, PxVec3(0, 0, 1))), PxVec2(0.05f, 4.0f));
-			pole->SetKinematic(true);
-			pole->Color(PxVec4(0.9f, 0.0f, 0.0f, 1.0f));
-			Add(pole);
-
-			Cloth* flag = new Cloth(PxTransform(PxVec3(72.0f, 6.5f, -48.f), PxQuat(1.5708f, PxVec3(0, 0, 1))), PxVec2(1.5f, 1.5f), 10, 10);
-			flag->Color(PxVec4(1, 1, 1, 1));
-			((PxCloth*)flag->Get())->setExternalAcceleration(PxVec3(-10.0f, 3.0f, 5.0f));
-			Add(flag);
-
-			// FINISH TRIGGER
-
-			Box* holeTrigger = new Box(PxTransform(PxVec3(72.0f, 0.5f, -48.0f)), PxVec3(0.35f, 0.45f, 0.35f));
-			holeTrigger->SetKinematic(true);
-			holeTrigger->SetTrigger(true, 0);
-			holeTrigger->Color(PxVec4(1.0f, 1.0f, 1.0f, 0.0f));
-			Add(holeTrigger);
+			AddFinish(PxVec3(72.0f, 1.0f, -48.0f));
 
 			// TWO SPHERES ADJOINED BY FIXED JOINT
 
-			Sphere* sp1 = new Sphere(PxTransform(68.0f, 1.9f, 15.0f), 0.5f, 0.1f);
-			Sphere* sp2 = new Sphere(PxTransform(68.0f, 1.9f, 17.0f), 0.5f, 0.1f);
-			Add(sp1);
-			Add(sp2);
-
-			FixedJoint* fj = new FixedJoint(sp1->Get(), PxTransform(68.0f, 1.9f, 15.0f), sp2->Get(), PxTransform(68.0f, 1.9f, 17.0f));
-			((PxFixedJoint*)fj->Get())->setBreakForce(500.0f, 500.0f);
-
-			// COLLISION MECHANICS
-
-			playerBall->SetupFiltering(FilterGroup::ePLAYERBALL, FilterGroup::ePLANE);
-			plane->SetupFiltering(FilterGroup::ePLANE, FilterGroup::ePLAYERBALL);
-
-			pole->GetShape(0)->setFlag(PxShapeFlag::eSIMULATION_SHAPE, false);
-
-			/* Test Cases */
-			//int xpos = 0;
-			//int ypos = 0;
-			//for (int x = 0; x < 100; x++) {
-			//	Sphere* box = new Sphere(PxTransform(PxVec3(xpos, 50, ypos)));
-			//	PxMaterial* boxMat = CreateMaterial(0.0f, 0.0f, 0.8f);
-			//	box->GetShape(0)->setMaterials(&ballMat, 1);
-			//	//box->SetKinematic(true);
-			//	Add(box);
-
-			//	xpos += 4;
-			//	if ((x + 1) % 10 == 0) {
-			//		ypos += 4;
-			//		xpos = 0;
-			//	}
-
-			//}
+			AddSpherePair(PxVec3(68.0f, 1.9f, 16.0f));
 		}
 	};
 }
@@ -0,0 +1,247 @@
+#include "GameServer.h"
+#include "..\MyPhysicsEngine.h"
+#include <thread>
+#include <mutex>
+#include <vector>
+#include <iostream>
+
+namespace Network
+{
+	using namespace std;
+
+	//course construction goes through the shared PxPhysics object,
+	//so sessions build and tear down their scenes one at a time
+	static mutex scene_mutex;
+
+	///A single connected front-end and its scene
+	class Session {
+		Socket socket;
+		const ServerDesc& desc;
+		PhysicsEngine::MyScene* scene;
+		vector<PxRigidDynamic*> bodies;
+		PxU32 frame;
+		PxU32 shots;
+		bool keyframe;
+
+		//packet buffers, allocated once with the session
+		PxU8 recv_buffer[MAX_PACKET_SIZE];
+		PxU8 send_buffer[MAX_PACKET_SIZE];
+		PacketWriter writer;
+
+		///Collect the dynamic bodies, their index is the id on the wire
+		void GatherBodies() {
+			PxScene* px_scene = scene->Get();
+			bodies.resize(px_scene->getNbActors(PxActorTypeSelectionFlag::eRIGID_DYNAMIC));
+			if (bodies.size())
+				px_scene->getActors(PxActorTypeSelectionFlag::eRIGID_DYNAMIC, (PxActor**)&bodies.front(), (PxU32)bodies.size());
+		}
+
+		///Send what is in the writer and start a new packet
+		bool Flush(PacketType next) {
+			writer.Type(PKT_STATE_MORE);
+			writer.End();
+			bool ok = socket.SendAll(writer.Data(), writer.Size());
+			writer.Clear();
+			writer.Begin(next);
+			return ok;
+		}
+
+		///Append the current state of the scene
+		bool WriteFrame() {
+			const PxU32 worst_case = sizeof(FrameHeader) + (PxU32)bodies.size() * sizeof(BodyState);
+			//a frame is never split across packets, a scene too large for one ends the session
+			if (worst_case > MAX_PACKET_SIZE - sizeof(PacketHeader)) {
+				SendError("the scene has too many bodies for a packet");
+				return false;
+			}
+			if ((writer.Remaining() < worst_case) && !Flush(PKT_STATE))
+				return false;
+
+			FrameHeader* header = writer.Append<FrameHeader>();
+			if (!header)
+				return false;
+			header->frame = frame;
+			header->shots = shots;
+			header->reserved = 0;
+			header->flags = 0;
+			if (keyframe)
+				header->flags |= FRAME_KEYFRAME;
+			if (scene->BallAtRest())
+				header->flags |= FRAME_BALL_AT_REST;
+			if (scene->hasGameEnded)
+				header->flags |= FRAME_GAME_ENDED;
+
+			//only moving bodies are sent between keyframes
+			PxU16 count = 0;
+			for (PxU32 i = 0; i < bodies.size(); i++) {
+				if (!keyframe && bodies[i]->isSleeping())
+					continue;
+				BodyState* state = (BodyState*)writer.Reserve(sizeof(BodyState));
+				if (!state)
+					return false;
+				CompressBody((PxU16)i, bodies[i]->getGlobalPose(), *state);
+				count++;
+			}
+			header->body_count = count;
+			keyframe = false;
+			return true;
+		}
+
+		bool SendError(const string& message) {
+			writer.Clear();
+			writer.Begin(PKT_ERROR);
+			writer.Write(message.c_str(), (PxU32)message.size());
+			writer.End();
+			return socket.SendAll(writer.Data(), writer.Size());
+		}
+
+		///Execute a batch of commands, returns false when the session ends
+		bool Execute(const Command* commands, PxU32 count) {
+			bool quit = false;
+
+			writer.Clear();
+			writer.Begin(PKT_STATE);
+
+			for (PxU32 i = 0; i < count; i++) {
+				const Command& command = commands[i];
+				switch (command.op) {
+				case CMD_SHOT:
+					if (scene->BallAtRest() && !scene->hasGameEnded) {
+						scene->Shoot(PxVec3(command.dir_x, 0.f, command.dir_z), command.strength);
+						shots++;
+					}
+					break;
+				case CMD_STEP:
+					for (PxU32 j = 0; j < command.steps; j++) {
+						scene->Update(desc.delta_time);
+						frame++;
+						if ((command.flags & CMD_FLAG_STREAM) && !WriteFrame())
+							return false;
+					}
+					break;
+				case CMD_RESET:
+				{
+					lock_guard<mutex> lock(scene_mutex);
+					scene->Reset();
+					GatherBodies();
+					frame = 0;
+					shots = 0;
+					keyframe = true;
+					break;
+				}
+				case CMD_KEYFRAME:
+					keyframe = true;
+					break;
+				case CMD_QUIT:
+					quit = true;
+					break;
+				default:
+					SendError("unknown command");
+					return false;
+				}
+			}
+
+			//every batch is answered with at least the final state
+			if (!writer.Count() && !WriteFrame())
+				return false;
+
+			writer.End();
+			if (!socket.SendAll(writer.Data(), writer.Size()))
+				return false;
+
+			return !quit;
+		}
+
+	public:
+		Session(Socket _socket, const ServerDesc& _desc)
+			: socket(_socket), desc(_desc), scene(0), frame(0), shots(0), keyframe(true),
+			writer(send_buffer, MAX_PACKET_SIZE) {
+			lock_guard<mutex> lock(scene_mutex);
+			scene = new PhysicsEngine::MyScene();
+			scene->Init();
+			GatherBodies();
+		}
+
+		~Session() {
+			lock_guard<mutex> lock(scene_mutex);
+			delete scene;
+			socket.Close();
+		}
+
+		void Run() {
+			Hello hello = { PROTOCOL_VERSION, (PxU32)bodies.size(), desc.delta_time, POSITION_SCALE };
+			writer.Begin(PKT_HELLO);
+			writer.Write(&hello, sizeof(hello));
+			writer.End();
+			if (!socket.SendAll(writer.Data(), writer.Size()))
+				return;
+
+			PacketHeader header;
+			while (socket.RecvAll(&header, sizeof(header))) {
+				const PxU32 payload = header.size - (PxU32)sizeof(header);
+				if ((header.type != PKT_COMMANDS) || (header.size < sizeof(header)) || (header.size > MAX_PACKET_SIZE) ||
+					(payload != header.count * sizeof(Command))) {
+					SendError("malformed packet");
+					return;
+				}
+
+				if (!socket.RecvAll(recv_buffer, payload))
+					return;
+
+				if (!Execute((const Command*)recv_buffer, header.count))
+					return;
+			}
+		}
+	};
+
+	GameServer::GameServer(const ServerDesc& _desc)
+		: desc(_desc), running(false), active_sessions(0) {
+	}
+
+	void GameServer::Run() {
+		listener = Socket::Listen(desc.endpoint);
+		running = true;
+
+		cerr << "GameServer listening on " << desc.endpoint.ToString() << endl;
+
+		while (running) {
+			Socket client = listener.Accept();
+			if (!client.Valid())
+				continue;
+
+			if (active_sessions >= desc.max_sessions) {
+				client.Close();
+				continue;
+			}
+
+			active_sessions++;
+			thread(&GameServer::RunSession, this, client).detach();
+		}
+
+		listener.Close();
+	}
+
+	void GameServer::Stop() {
+		running = false;
+		listener.Close();
+	}
+
+	void GameServer::RunSession(Socket client) {
+		Session* session = 0;
+		try {
+			if (!desc.endpoint.unix_domain)
+				client.NoDelay();
+			session = new Session(client, desc);
+			session->Run();
+		}
+		catch (Exception* exc) {
+			cerr << exc->what() << endl;
+			delete exc;
+			//a constructed session closes the socket itself
+			if (!session)
+				client.Close();
+		}
+		delete session;
+		active_sessions--;
+	}
+}
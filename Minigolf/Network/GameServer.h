@@ -0,0 +1,36 @@
+#pragma once
+
+#include "Protocol.h"
+#include "Socket.h"
+#include <atomic>
+
+namespace Network
+{
+	///Game server settings
+	struct ServerDesc {
+		Endpoint endpoint;
+		PxReal delta_time;
+		PxU32 max_sessions;
+
+		ServerDesc() : delta_time(1.f / 60.f), max_sessions(64) {}
+	};
+
+	///Runs one headless MyScene per connected front-end
+	class GameServer {
+		ServerDesc desc;
+		Socket listener;
+		std::atomic<bool> running;
+		std::atomic<PxU32> active_sessions;
+
+		void RunSession(Socket client);
+
+	public:
+		GameServer(const ServerDesc& _desc);
+
+		///Accept clients until Stop is called
+		void Run();
+
+		///Stop accepting clients
+		void Stop();
+	};
+}
@@ -0,0 +1,186 @@
+#include "LoadGenerator.h"
+#include "..\Exception.h"
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+
+namespace Network
+{
+	using namespace std;
+	typedef chrono::high_resolution_clock Clock;
+
+	///Counters gathered by a single client thread
+	struct ClientStats {
+		vector<double> latencies;		// microseconds per request
+		PxU64 bytes_received;
+		PxU32 sessions;
+		PxU32 failures;
+
+		ClientStats() : bytes_received(0), sessions(0), failures(0) {}
+	};
+
+	///A single client connection replaying scripted sessions
+	class LoadClient {
+		const LoadDesc& desc;
+		ClientStats& stats;
+		mt19937 random;
+		Socket socket;
+
+		PxU8 send_buffer[MAX_PACKET_SIZE];
+		PxU8 recv_buffer[MAX_PACKET_SIZE];
+		PacketWriter writer;
+
+		Command* AddCommand(CommandOp op) {
+			Command* command = writer.Append<Command>();
+			command->op = (PxU8)op;
+			command->flags = 0;
+			command->steps = 0;
+			command->dir_x = command->dir_z = command->strength = 0.f;
+			return command;
+		}
+
+		///Send the batch in the writer and read the whole reply
+		bool Request() {
+			writer.End();
+
+			Clock::time_point start = Clock::now();
+			if (!socket.SendAll(writer.Data(), writer.Size()))
+				return false;
+
+			PacketHeader header;
+			do {
+				if (!socket.RecvAll(&header, sizeof(header)))
+					return false;
+				if ((header.size < sizeof(header)) || (header.size > MAX_PACKET_SIZE))
+					return false;
+				if (!socket.RecvAll(recv_buffer, header.size - sizeof(header)))
+					return false;
+				stats.bytes_received += header.size;
+				if (header.type == PKT_ERROR)
+					return false;
+			} while (header.type == PKT_STATE_MORE);
+
+			stats.latencies.push_back(chrono::duration<double, micro>(Clock::now() - start).count());
+			writer.Clear();
+			return true;
+		}
+
+		bool PlaySession() {
+			socket = Socket::Connect(desc.endpoint);
+
+			PacketHeader header;
+			if (!socket.RecvAll(&header, sizeof(header)) || (header.type != PKT_HELLO) || (header.size > MAX_PACKET_SIZE))
+				return false;
+			if (!socket.RecvAll(recv_buffer, header.size - sizeof(header)))
+				return false;
+
+			uniform_real_distribution<PxReal> angle(0.f, PxTwoPi);
+			uniform_real_distribution<PxReal> strength(5.f, 40.f);
+
+			writer.Begin(PKT_COMMANDS);
+			AddCommand(CMD_KEYFRAME);
+			if (!Request())
+				return false;
+
+			for (PxU32 i = 0; i < desc.shots; i++) {
+				PxReal a = angle(random);
+				writer.Begin(PKT_COMMANDS);
+				Command* shot = AddCommand(CMD_SHOT);
+				shot->dir_x = PxCos(a);
+				shot->dir_z = PxSin(a);
+				shot->strength = strength(random);
+				Command* step = AddCommand(CMD_STEP);
+				step->steps = (PxU16)desc.steps;
+				if (desc.stream)
+					step->flags |= CMD_FLAG_STREAM;
+				if (!Request())
+					return false;
+			}
+
+			writer.Begin(PKT_COMMANDS);
+			AddCommand(CMD_QUIT);
+			return Request();
+		}
+
+	public:
+		LoadClient(const LoadDesc& _desc, ClientStats& _stats, PxU32 seed)
+			: desc(_desc), stats(_stats), random(seed), writer(send_buffer, MAX_PACKET_SIZE) {
+		}
+
+		void Run(atomic<PxU32>& next_session) {
+			while (next_session++ < desc.sessions) {
+				bool ok = false;
+				try {
+					ok = PlaySession();
+				}
+				catch (Exception* exc) {
+					cerr << exc->what() << endl;
+					delete exc;
+				}
+				socket.Close();
+				writer.Clear();
+				if (ok)
+					stats.sessions++;
+				else
+					stats.failures++;
+			}
+		}
+	};
+
+	static double Percentile(const vector<double>& sorted, double p) {
+		if (sorted.empty())
+			return 0.0;
+		size_t index = (size_t)(p * (sorted.size() - 1) + .5);
+		return sorted[index];
+	}
+
+	void LoadGenerator::Run() {
+		vector<ClientStats> stats(desc.clients);
+		for (PxU32 i = 0; i < desc.clients; i++)
+			stats[i].latencies.reserve(desc.sessions * (desc.shots + 2) / desc.clients + 16);
+
+		atomic<PxU32> next_session(0);
+		vector<thread> threads;
+
+		Clock::time_point start = Clock::now();
+		for (PxU32 i = 0; i < desc.clients; i++) {
+			threads.push_back(thread([this, &stats, &next_session, i]() {
+				LoadClient* client = new LoadClient(desc, stats[i], desc.seed + i);
+				client->Run(next_session);
+				delete client;
+			}));
+		}
+		for (PxU32 i = 0; i < threads.size(); i++)
+			threads[i].join();
+		double elapsed = chrono::duration<double>(Clock::now() - start).count();
+
+		vector<double> latencies;
+		PxU64 bytes = 0;
+		PxU32 sessions = 0, failures = 0;
+		for (PxU32 i = 0; i < stats.size(); i++) {
+			latencies.insert(latencies.end(), stats[i].latencies.begin(), stats[i].latencies.end());
+			bytes += stats[i].bytes_received;
+			sessions += stats[i].sessions;
+			failures += stats[i].failures;
+		}
+		sort(latencies.begin(), latencies.end());
+
+		cout << fixed << setprecision(1);
+		cout << "endpoint      " << desc.endpoint.ToString() << endl;
+		cout << "clients       " << desc.clients << endl;
+		cout << "sessions      " << sessions << " (" << failures << " failed)" << endl;
+		cout << "requests      " << latencies.size() << endl;
+		cout << "elapsed       " << elapsed << " s" << endl;
+		cout << "sessions/s    " << (elapsed > 0.0 ? sessions / elapsed : 0.0) << endl;
+		cout << "received      " << bytes / 1024 << " KiB" << endl;
+		cout << "latency p50   " << Percentile(latencies, .50) << " us" << endl;
+		cout << "latency p90   " << Percentile(latencies, .90) << " us" << endl;
+		cout << "latency p99   " << Percentile(latencies, .99) << " us" << endl;
+		cout << "latency max   " << (latencies.size() ? latencies.back() : 0.0) << " us" << endl;
+	}
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "Protocol.h"
+#include "Socket.h"
+
+namespace Network
+{
+	///Load generator settings
+	struct LoadDesc {
+		Endpoint endpoint;
+		PxU32 clients;			// concurrent connections
+		PxU32 sessions;			// sessions in total over all clients
+		PxU32 shots;			// shots per session
+		PxU32 steps;			// simulation steps after every shot
+		bool stream;			// ask for a frame after every step
+		PxU32 seed;
+
+		LoadDesc() : clients(4), sessions(100), shots(5), steps(120), stream(false), seed(1) {}
+	};
+
+	///Plays scripted sessions against a running GameServer and reports
+	///request latency percentiles and sessions per second
+	class LoadGenerator {
+		LoadDesc desc;
+
+	public:
+		LoadGenerator(const LoadDesc& _desc) : desc(_desc) {}
+
+		///Run all sessions and print the report to cout
+		void Run();
+	};
+}
@@ -0,0 +1,225 @@
+#pragma once
+
+#include "foundation/PxTransform.h"
+#include <cstring>
+
+///Binary protocol spoken between the game server and its front-ends.
+///
+///Every packet starts with a PacketHeader. A client packet carries a batch of
+///fixed-size Commands, the server answers every batch with state frames,
+///split over PKT_STATE_MORE packets when they do not fit into one and always
+///closed by a PKT_STATE packet. All values are little-endian and the
+///structures are copied as they are, both ends live on the same machine.
+namespace Network
+{
+	using namespace physx;
+
+	static const PxU32 PROTOCOL_VERSION = 1;
+
+	//largest packet either side will ever send or accept
+	static const PxU32 MAX_PACKET_SIZE = 64 * 1024;
+
+	enum PacketType {
+		PKT_HELLO = 1,			// server -> client, sent once after accept
+		PKT_COMMANDS = 2,		// client -> server, count = number of commands
+		PKT_STATE = 3,			// server -> client, count = number of frames, ends a reply
+		PKT_STATE_MORE = 4,		// server -> client, like PKT_STATE but more packets follow
+		PKT_ERROR = 5			// server -> client, payload is a text message
+	};
+
+	enum CommandOp {
+		CMD_SHOT = 1,			// hit the ball: dir_x, dir_z, strength
+		CMD_STEP = 2,			// advance the simulation by steps frames
+		CMD_RESET = 3,			// rebuild the course
+		CMD_KEYFRAME = 4,		// send all bodies in the next frame
+		CMD_QUIT = 5			// close the session
+	};
+
+	enum CommandFlags {
+		CMD_FLAG_STREAM = (1 << 0)	// CMD_STEP: emit a frame after every step
+	};
+
+	enum FrameFlags {
+		FRAME_KEYFRAME = (1 << 0),	// every body is present
+		FRAME_BALL_AT_REST = (1 << 1),
+		FRAME_GAME_ENDED = (1 << 2)
+	};
+
+#pragma pack(push, 1)
+	struct PacketHeader {
+		PxU32 size;			// whole packet including the header
+		PxU16 type;
+		PxU16 count;
+	};
+
+	struct Hello {
+		PxU32 version;
+		PxU32 body_count;		// number of dynamic bodies in the session
+		PxReal delta_time;
+		PxReal position_scale;
+	};
+
+	struct Command {
+		PxU8 op;
+		PxU8 flags;
+		PxU16 steps;
+		PxReal dir_x;
+		PxReal dir_z;
+		PxReal strength;
+	};
+
+	struct FrameHeader {
+		PxU32 frame;
+		PxU16 body_count;		// number of BodyState records following
+		PxU8 flags;
+		PxU8 reserved;
+		PxU32 shots;
+	};
+
+	///A compressed body transform: 12 bytes instead of 28
+	struct BodyState {
+		PxU16 id;
+		PxI16 position[3];
+		PxU32 rotation;
+	};
+#pragma pack(pop)
+
+	//positions are stored in 1/256 m steps, which covers +-128 m
+	static const PxReal POSITION_SCALE = 256.f;
+
+	inline PxI16 QuantizePosition(PxReal value) {
+		PxReal q = value * POSITION_SCALE;
+		if (q > 32767.f) q = 32767.f;
+		if (q < -32768.f) q = -32768.f;
+		return (PxI16)(q < 0.f ? q - .5f : q + .5f);
+	}
+
+	inline PxReal DequantizePosition(PxI16 value) {
+		return (PxReal)value / POSITION_SCALE;
+	}
+
+	///Pack a unit quaternion with the smallest three method (2 + 3x10 bits)
+	inline PxU32 PackRotation(const PxQuat& q) {
+		const PxReal c[4] = { q.x, q.y, q.z, q.w };
+		PxU32 largest = 0;
+		for (PxU32 i = 1; i < 4; i++)
+			if (PxAbs(c[i]) > PxAbs(c[largest]))
+				largest = i;
+
+		//q and -q are the same rotation, make the dropped component positive
+		const PxReal sign = c[largest] < 0.f ? -1.f : 1.f;
+		PxU32 packed = largest << 30;
+		PxU32 shift = 20;
+		for (PxU32 i = 0; i < 4; i++) {
+			if (i == largest)
+				continue;
+			//remaining components lie in [-1/sqrt(2), 1/sqrt(2)]
+			PxReal v = c[i] * sign * PxSqrt(2.f) * .5f + .5f;
+			v = PxClamp(v, 0.f, 1.f);
+			packed |= ((PxU32)(v * 1023.f + .5f)) << shift;
+			shift -= 10;
+		}
+		return packed;
+	}
+
+	inline PxQuat UnpackRotation(PxU32 packed) {
+		const PxU32 largest = packed >> 30;
+		PxReal c[4];
+		PxReal sum = 0.f;
+		PxU32 shift = 20;
+		for (PxU32 i = 0; i < 4; i++) {
+			if (i == largest)
+				continue;
+			PxReal v = (PxReal)((packed >> shift) & 1023) / 1023.f;
+			c[i] = (v - .5f) * 2.f / PxSqrt(2.f);
+			sum += c[i] * c[i];
+			shift -= 10;
+		}
+		c[largest] = PxSqrt(PxMax(0.f, 1.f - sum));
+		return PxQuat(c[0], c[1], c[2], c[3]).getNormalized();
+	}
+
+	inline void CompressBody(PxU16 id, const PxTransform& pose, BodyState& out) {
+		out.id = id;
+		out.position[0] = QuantizePosition(pose.p.x);
+		out.position[1] = QuantizePosition(pose.p.y);
+		out.position[2] = QuantizePosition(pose.p.z);
+		out.rotation = PackRotation(pose.q);
+	}
+
+	inline PxTransform DecompressBody(const BodyState& state) {
+		return PxTransform(PxVec3(DequantizePosition(state.position[0]), DequantizePosition(state.position[1]),
+			DequantizePosition(state.position[2])), UnpackRotation(state.rotation));
+	}
+
+	///Appends records to a caller owned buffer, no allocation
+	class PacketWriter {
+		PxU8* buffer;
+		PxU32 capacity;
+		PxU32 size;
+		PxU32 header;		// offset of the open packet, -1 if none
+
+	public:
+		PacketWriter(PxU8* _buffer, PxU32 _capacity)
+			: buffer(_buffer), capacity(_capacity), size(0), header(-1) {}
+
+		///Start a new packet in the buffer
+		void Begin(PacketType type) {
+			header = size;
+			PacketHeader h = { 0, (PxU16)type, 0 };
+			Write(&h, sizeof(h));
+		}
+
+		///Write raw bytes, returns false if they do not fit
+		bool Write(const void* data, PxU32 bytes) {
+			if (size + bytes > capacity)
+				return false;
+			memcpy(buffer + size, data, bytes);
+			size += bytes;
+			return true;
+		}
+
+		///Reserve room for a record and count it in the open packet
+		template<class T> T* Append() {
+			if (size + sizeof(T) > capacity)
+				return 0;
+			T* record = (T*)(buffer + size);
+			size += sizeof(T);
+			((PacketHeader*)(buffer + header))->count++;
+			return record;
+		}
+
+		///Reserve room for raw bytes without counting a record
+		void* Reserve(PxU32 bytes) {
+			if (size + bytes > capacity)
+				return 0;
+			void* data = buffer + size;
+			size += bytes;
+			return data;
+		}
+
+		///Type of the open packet
+		void Type(PacketType type) {
+			((PacketHeader*)(buffer + header))->type = (PxU16)type;
+		}
+
+		///Number of records in the open packet
+		PxU16 Count() const {
+			return ((const PacketHeader*)(buffer + header))->count;
+		}
+
+		///Close the open packet
+		void End() {
+			((PacketHeader*)(buffer + header))->size = size - header;
+			header = -1;
+		}
+
+		PxU32 Remaining() const { return capacity - size; }
+
+		PxU32 Size() const { return size; }
+
+		const PxU8* Data() const { return buffer; }
+
+		void Clear() { size = 0; header = -1; }
+	};
+}
@@ -0,0 +1,164 @@
+#include "Socket.h"
+#include "..\Exception.h"
+#include <cstring>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+typedef int socklen_t;
+#define CLOSE_SOCKET closesocket
+#define SEND_FLAGS 0
+#else
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#define CLOSE_SOCKET close
+//report a closed peer as an error instead of raising SIGPIPE
+#define SEND_FLAGS MSG_NOSIGNAL
+#endif
+
+namespace Network
+{
+	Endpoint Endpoint::Parse(const string& text) {
+		Endpoint endpoint;
+		if (text.compare(0, 5, "unix:") == 0) {
+			endpoint.unix_domain = true;
+			endpoint.path = text.substr(5);
+		}
+		else if (text.compare(0, 4, "tcp:") == 0) {
+			endpoint.port = (unsigned short)stoi(text.substr(4));
+		}
+		else if (text.size()) {
+			endpoint.port = (unsigned short)stoi(text);
+		}
+		return endpoint;
+	}
+
+	string Endpoint::ToString() const {
+		if (unix_domain)
+			return "unix:" + path;
+		return "tcp:127.0.0.1:" + to_string(port);
+	}
+
+	void Socket::Startup() {
+#ifdef _WIN32
+		WSADATA data;
+		if (WSAStartup(MAKEWORD(2, 2), &data) != 0)
+			throw new Exception("Network::Socket::Startup, Could not initialise Winsock.");
+#endif
+	}
+
+	void Socket::Shutdown() {
+#ifdef _WIN32
+		WSACleanup();
+#endif
+	}
+
+	//fill in the address for an endpoint, returns its length
+	static socklen_t MakeAddress(const Endpoint& endpoint, sockaddr_storage& storage) {
+		memset(&storage, 0, sizeof(storage));
+#ifndef _WIN32
+		if (endpoint.unix_domain) {
+			sockaddr_un* addr = (sockaddr_un*)&storage;
+			addr->sun_family = AF_UNIX;
+			strncpy(addr->sun_path, endpoint.path.c_str(), sizeof(addr->sun_path) - 1);
+			return sizeof(sockaddr_un);
+		}
+#else
+		if (endpoint.unix_domain)
+			throw new Exception("Network::Socket, UNIX-domain sockets are not supported on this platform.");
+#endif
+		//only ever bind to the loopback interface
+		sockaddr_in* addr = (sockaddr_in*)&storage;
+		addr->sin_family = AF_INET;
+		addr->sin_port = htons(endpoint.port);
+		addr->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		return sizeof(sockaddr_in);
+	}
+
+	Socket Socket::Listen(const Endpoint& endpoint, int backlog) {
+		sockaddr_storage storage;
+		socklen_t length = MakeAddress(endpoint, storage);
+
+		intptr_t s = (intptr_t)socket(storage.ss_family, SOCK_STREAM, 0);
+		if (s == -1)
+			throw new Exception("Network::Socket::Listen, Could not create the socket.");
+
+#ifndef _WIN32
+		if (endpoint.unix_domain)
+			unlink(endpoint.path.c_str());
+#endif
+		int reuse = 1;
+		setsockopt(s, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuse, sizeof(reuse));
+
+		if ((bind(s, (sockaddr*)&storage, length) != 0) || (listen(s, backlog) != 0)) {
+			CLOSE_SOCKET(s);
+			throw new Exception("Network::Socket::Listen, Could not listen on " + endpoint.ToString() + ".");
+		}
+
+		return Socket(s);
+	}
+
+	Socket Socket::Connect(const Endpoint& endpoint) {
+		sockaddr_storage storage;
+		socklen_t length = MakeAddress(endpoint, storage);
+
+		intptr_t s = (intptr_t)socket(storage.ss_family, SOCK_STREAM, 0);
+		if (s == -1)
+			throw new Exception("Network::Socket::Connect, Could not create the socket.");
+
+		if (connect(s, (sockaddr*)&storage, length) != 0) {
+			CLOSE_SOCKET(s);
+			throw new Exception("Network::Socket::Connect, Could not connect to " + endpoint.ToString() + ".");
+		}
+
+		Socket socket(s);
+		if (!endpoint.unix_domain)
+			socket.NoDelay();
+		return socket;
+	}
+
+	Socket Socket::Accept() {
+		intptr_t s = (intptr_t)accept(handle, 0, 0);
+		return Socket(s);
+	}
+
+	bool Socket::SendAll(const void* data, size_t bytes) {
+		const char* ptr = (const char*)data;
+		while (bytes) {
+			int sent = send(handle, ptr, (int)bytes, SEND_FLAGS);
+			if (sent <= 0)
+				return false;
+			ptr += sent;
+			bytes -= sent;
+		}
+		return true;
+	}
+
+	bool Socket::RecvAll(void* data, size_t bytes) {
+		char* ptr = (char*)data;
+		while (bytes) {
+			int received = recv(handle, ptr, (int)bytes, 0);
+			if (received <= 0)
+				return false;
+			ptr += received;
+			bytes -= received;
+		}
+		return true;
+	}
+
+	void Socket::NoDelay() {
+		int value = 1;
+		setsockopt(handle, IPPROTO_TCP, TCP_NODELAY, (const char*)&value, sizeof(value));
+	}
+
+	void Socket::Close() {
+		if (handle != -1)
+			CLOSE_SOCKET(handle);
+		handle = -1;
+	}
+}
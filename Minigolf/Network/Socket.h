@@ -0,0 +1,61 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+
+namespace Network
+{
+	using namespace std;
+
+	///Where the server listens: a loopback TCP port or a UNIX-domain socket path
+	struct Endpoint {
+		bool unix_domain;
+		string path;
+		unsigned short port;
+
+		Endpoint(unsigned short _port = 5500) : unix_domain(false), port(_port) {}
+
+		///Parse "unix:/path/to/socket", "tcp:5500" or a bare port number
+		static Endpoint Parse(const string& text);
+
+		string ToString() const;
+	};
+
+	///Minimal blocking stream socket
+	class Socket {
+		intptr_t handle;
+
+	public:
+		Socket() : handle(-1) {}
+
+		explicit Socket(intptr_t _handle) : handle(_handle) {}
+
+		///Start the socket library (once per process)
+		static void Startup();
+
+		///Stop the socket library
+		static void Shutdown();
+
+		///Create a listening socket bound to the endpoint
+		static Socket Listen(const Endpoint& endpoint, int backlog = 64);
+
+		///Connect to a listening endpoint
+		static Socket Connect(const Endpoint& endpoint);
+
+		///Wait for the next client
+		Socket Accept();
+
+		///Send the whole buffer
+		bool SendAll(const void* data, size_t bytes);
+
+		///Receive exactly the given number of bytes
+		bool RecvAll(void* data, size_t bytes);
+
+		///Disable Nagle's algorithm on TCP sockets
+		void NoDelay();
+
+		bool Valid() const { return handle != -1; }
+
+		void Close();
+	};
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <vector>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <type_traits>
+
+namespace PhysicsEngine
+{
+	///Slots for objects of one type, reused after Destroy.
+	///
+	///Slots come in chunks that are kept until the end of the program, so a scene
+	///that is reset over and over keeps reusing the same memory.
+	template<class T>
+	class ObjectPool
+	{
+		static const size_t chunk_objects = 64;
+
+		union Slot {
+			Slot* next;
+			typename std::aligned_storage<sizeof(T), std::alignment_of<T>::value>::type storage;
+		};
+
+		std::vector<Slot*> chunks;
+		Slot* free_slots;
+		size_t live;
+		std::mutex mutex;
+
+		ObjectPool() : free_slots(0), live(0) {}
+
+		ObjectPool(const ObjectPool&) = delete;
+		ObjectPool& operator=(const ObjectPool&) = delete;
+
+		~ObjectPool() {
+			//objects still out at exit keep their memory
+			if (!live)
+				for (size_t i = 0; i < chunks.size(); i++)
+					delete[] chunks[i];
+		}
+
+		Slot* Take() {
+			std::lock_guard<std::mutex> lock(mutex);
+			if (!free_slots) {
+				Slot* chunk = new Slot[chunk_objects];
+				chunks.push_back(chunk);
+				for (size_t i = 0; i < chunk_objects; i++) {
+					chunk[i].next = free_slots;
+					free_slots = &chunk[i];
+				}
+			}
+			Slot* slot = free_slots;
+			free_slots = slot->next;
+			live++;
+			return slot;
+		}
+
+		void Give(Slot* slot) {
+			std::lock_guard<std::mutex> lock(mutex);
+			slot->next = free_slots;
+			free_slots = slot;
+			live--;
+		}
+
+	public:
+		///The pool of this type
+		static ObjectPool& Get() {
+			static ObjectPool pool;
+			return pool;
+		}
+
+		template<class... Args>
+		T* Create(Args&&... args) {
+			Slot* slot = Take();
+			try {
+				return new (&slot->storage) T(std::forward<Args>(args)...);
+			}
+			catch (...) {
+				Give(slot);
+				throw;
+			}
+		}
+
+		void Destroy(T* object) {
+			object->~T();
+			Give((Slot*)object);
+		}
+
+		///Destroy through a plain function pointer, for owners of mixed types
+		static void Release(void* object) {
+			Get().Destroy((T*)object);
+		}
+
+		///Objects currently created
+		size_t Live() {
+			std::lock_guard<std::mutex> lock(mutex);
+			return live;
+		}
+
+		///Slots allocated so far
+		size_t Capacity() {
+			std::lock_guard<std::mutex> lock(mutex);
+			return chunks.size() * chunk_objects;
+		}
+	};
+}
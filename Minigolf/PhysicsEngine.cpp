@@ -1,5 +1,9 @@
 #include "PhysicsEngine.h"
+#include "Profiler.h"
+#include "PvdFileStream.h"
 #include <iostream>
+#include <cstring>
+#include <map>
 
 namespace PhysicsEngine {
 	using namespace physx;
@@ -7,16 +11,45 @@ namespace PhysicsEngine {
 
 	//default error and allocator callbacks
 	PxDefaultErrorCallback gDefaultErrorCallback;
-	PxDefaultAllocator gDefaultAllocatorCallback;
+	TrackingAllocator gDefaultAllocatorCallback;
 
 	//PhysX objects
 	PxFoundation* foundation = 0;
 	debugger::comm::PvdConnection* vd_connection = 0;
+	PvdFileStream* vd_file = 0;
 	PxPhysics* physics = 0;
 	PxCooking* cooking = 0;
+	//meshes and other objects shared between scenes, released with the SDK
+	map<string, PxBase*> shared_objects;
 
 	///PhysX functions
-	void PxInit() {
+	///Connect the visual debugger as configured
+	void PvdConnect(const PvdDesc& pvd) {
+		if (vd_connection || (pvd.mode == PVD_OFF))
+			return;
+
+		PxVisualDebuggerConnectionFlags flags = PxVisualDebuggerConnectionFlag::eDEBUG;
+		if (pvd.profile)
+			flags |= PxVisualDebuggerConnectionFlag::ePROFILE;
+		if (pvd.memory)
+			flags |= PxVisualDebuggerConnectionFlag::eMEMORY;
+
+		if (pvd.mode == PVD_SOCKET) {
+			vd_connection = PxVisualDebuggerExt::createConnection(physics->getPvdConnectionManager(),
+				pvd.host.c_str(), pvd.port, 100, flags);
+		}
+		else {
+			vd_file = new PvdFileStream(pvd.file);
+			vd_connection = physics->getPvdConnectionManager()->connect(gDefaultAllocatorCallback, *vd_file, flags);
+			if (!vd_connection) {
+				delete vd_file;
+				vd_file = 0;
+				throw new Exception("PhysicsEngine::PvdConnect, Could not start the PVD capture to " + pvd.file + ".");
+			}
+		}
+	}
+
+	void PxInit(const PvdDesc& pvd) {
 		//foundation
 		if (!foundation)
 			foundation = PxCreateFoundation(PX_PHYSICS_VERSION, gDefaultAllocatorCallback, gDefaultErrorCallback);
@@ -37,10 +70,8 @@ namespace PhysicsEngine {
 		if (!cooking)
 			throw new Exception("PhysicsEngine::PxInit, Could not initialise the cooking component.");
 
-		//visual debugger
-		if (!vd_connection)
-			vd_connection = PxVisualDebuggerExt::createConnection(physics->getPvdConnectionManager(),
-				"localhost", 5425, 100, PxVisualDebuggerExt::getAllConnectionFlags());
+		//visual debugger, off unless asked for
+		PvdConnect(pvd);
 
 		//create a deafult material
 		CreateMaterial();
@@ -53,12 +84,23 @@ namespace PhysicsEngine {
 	void PxRelease() {
 		if (vd_connection)
 			vd_connection->release();
+		vd_connection = 0;
+		//flushes the capture to disk
+		delete vd_file;
+		vd_file = 0;
+		//the scenes are gone, so the shared objects hold their last references
+		for (map<string, PxBase*>::iterator i = shared_objects.begin(); i != shared_objects.end(); i++)
+			i->second->release();
+		shared_objects.clear();
 		if (cooking)
 			cooking->release();
 		if (physics)
 			physics->release();
 		if (foundation)
 			foundation->release();
+
+		//whatever is left was never released
+		ReportLeaks(cerr);
 	}
 
 	PxPhysics* GetPhysics() {
@@ -81,8 +123,39 @@ namespace PhysicsEngine {
 		return physics->createMaterial(sf, df, cr);
 	}
 
+	PxMaterial* SharedMaterial(PxReal sf, PxReal df, PxReal cr) {
+		std::vector<PxMaterial*> materials(physics->getNbMaterials());
+		physics->getMaterials(materials.data(), (PxU32)materials.size());
+		//skip the default material, scenes change it
+		for (PxU32 i = 1; i < materials.size(); i++) {
+			if ((materials[i]->getStaticFriction() == sf) && (materials[i]->getDynamicFriction() == df) &&
+				(materials[i]->getRestitution() == cr))
+				return materials[i];
+		}
+		return CreateMaterial(sf, df, cr);
+	}
+
+	PxBase* SharedObject(const string& key) {
+		map<string, PxBase*>::iterator found = shared_objects.find(key);
+		return (found != shared_objects.end()) ? found->second : 0;
+	}
+
+	void SharedObject(const string& key, PxBase* object) {
+		PxBase*& entry = shared_objects[key];
+		if (entry)
+			entry->release();
+		entry = object;
+	}
+
 	///Actor methods
 
+	Actor::~Actor() {
+		for (unsigned int i = 0; i < render_ids.size(); i++)
+			RenderTable::Remove(render_ids[i]);
+		if (actor)
+			actor->release();
+	}
+
 	///Constructor
 	PxActor* Actor::Get() {
 		return actor;
@@ -91,18 +164,18 @@ namespace PhysicsEngine {
 	void Actor::Color(PxVec4 new_color, PxU32 shape_index) {
 		//change color of all shapes
 		if (shape_index == -1) {
-			for (unsigned int i = 0; i < colors.size(); i++)
-				colors[i] = new_color;
+			for (unsigned int i = 0; i < render_ids.size(); i++)
+				RenderTable::Color(render_ids[i]) = new_color;
 		}
 		//or only the selected one
-		else if (shape_index < colors.size()) {
-			colors[shape_index] = new_color;
+		else if (shape_index < render_ids.size()) {
+			RenderTable::Color(render_ids[shape_index]) = new_color;
 		}
 	}
 
 	const PxVec4* Actor::Color(PxU32 shape_indx) {
-		if (shape_indx < colors.size())
-			return &colors[shape_indx];
+		if (shape_indx < render_ids.size())
+			return &RenderTable::Color(render_ids[shape_indx]);
 		else
 			return 0;
 	}
@@ -168,19 +241,12 @@ namespace PhysicsEngine {
 		Name("");
 	}
 
-	DynamicActor::~DynamicActor() {
-		for (unsigned int i = 0; i < colors.size(); i++)
-			delete (UserData*)GetShape(i)->userData;
-	}
-
 	void DynamicActor::CreateShape(const PxGeometry& geometry, PxReal density) {
 		PxShape* shape = ((PxRigidDynamic*)actor)->createShape(geometry, *GetMaterial());
 		PxRigidBodyExt::updateMassAndInertia(*(PxRigidDynamic*)actor, density);
-		colors.push_back(default_color);
-		//pass the color pointers to the renderer
-		shape->userData = new UserData();
-		for (unsigned int i = 0; i < colors.size(); i++)
-			((UserData*)GetShape(i)->userData)->color = &colors[i];
+		//pass the render entry to the renderer
+		render_ids.push_back(RenderTable::Add(default_color));
+		shape->userData = RenderTable::ToUserData(render_ids.back());
 	}
 
 	void DynamicActor::SetKinematic(bool value, PxU32 index) {
@@ -192,35 +258,60 @@ namespace PhysicsEngine {
 		Name("");
 	}
 
-	StaticActor::~StaticActor() {
-		for (unsigned int i = 0; i < colors.size(); i++)
-			delete (UserData*)GetShape(i)->userData;
-	}
-
 	void StaticActor::CreateShape(const PxGeometry& geometry, PxReal density) {
 		PxShape* shape = ((PxRigidStatic*)actor)->createShape(geometry, *GetMaterial());
-		colors.push_back(default_color);
-		//pass the color pointers to the renderer
-		shape->userData = new UserData();
-		for (unsigned int i = 0; i < colors.size(); i++)
-			((UserData*)GetShape(i)->userData)->color = &colors[i];
-	}
+		//pass the render entry to the renderer
+		render_ids.push_back(RenderTable::Add(default_color));
+		shape->userData = RenderTable::ToUserData(render_ids.back());
+	}
+
+	//longest pick ray
+	static const PxReal pick_distance = 1000.f;
+	//spring pulling a dragged actor, per unit mass; damping is about critical
+	static const PxReal drag_stiffness = 100.f;
+	static const PxReal drag_damping = 20.f;
+
+	///Scene queries that only hit solid shapes, triggers are passed through
+	class SolidFilter : public PxQueryFilterCallback {
+	public:
+		virtual PxQueryHitType::Enum preFilter(const PxFilterData& filterData, const PxShape* shape, const PxRigidActor* actor, PxHitFlags& queryFlags) {
+			return (shape->getFlags() & PxShapeFlag::eTRIGGER_SHAPE) ? PxQueryHitType::eNONE : PxQueryHitType::eBLOCK;
+		}
+
+		virtual PxQueryHitType::Enum postFilter(const PxFilterData& filterData, const PxQueryHit& hit) {
+			return PxQueryHitType::eBLOCK;
+		}
+	};
+
+	///Camera sweep filter: triggers are not solid and shapes the sweep starts in are the ones the ball rests on
+	class StaticSweepFilter : public SolidFilter {
+	public:
+		virtual PxQueryHitType::Enum postFilter(const PxFilterData& filterData, const PxQueryHit& hit) {
+			return (((const PxSweepHit&)hit).distance <= 0.f) ? PxQueryHitType::eNONE : PxQueryHitType::eBLOCK;
+		}
+	};
 
 	///Scene methods
 	void Scene::Init() {
 		//scene
 		PxSceneDesc sceneDesc(GetPhysics()->getTolerancesScale());
 
-		if (!sceneDesc.cpuDispatcher) {
-			PxDefaultCpuDispatcher* mCpuDispatcher = PxDefaultCpuDispatcherCreate(1);
-			sceneDesc.cpuDispatcher = mCpuDispatcher;
-		}
+		if (!cpu_dispatcher)
+			cpu_dispatcher = PxDefaultCpuDispatcherCreate(1);
+
+		sceneDesc.cpuDispatcher = cpu_dispatcher;
 
 		sceneDesc.filterShader = filter_shader;
 
 		sceneDesc.flags |= PxSceneFlag::eENABLE_CCD;
 
-		px_scene = GetPhysics()->createScene(sceneDesc);
+		//the scene's own data goes to its arena, shared objects (materials, meshes, the
+		//SDK's actor pools) stay on the heap
+		arena = CreateArena();
+		{
+			ArenaScope scope(arena);
+			px_scene = GetPhysics()->createScene(sceneDesc);
+		}
 
 		if (!px_scene)
 			throw new Exception("PhysicsEngine::Scene::Init, Could not initialise the scene.");
@@ -237,17 +328,40 @@ namespace PhysicsEngine {
 		SelectNextActor();
 	}
 
+	Scene::~Scene() {
+		ReleaseOwned();
+		if (px_scene)
+			px_scene->release();
+		ReleaseArena(arena);
+		if (cpu_dispatcher)
+			cpu_dispatcher->release();
+	}
+
 	void Scene::Update(PxReal dt) {
 		if (pause)
 			return;
 
-		CustomUpdate();
+		PROFILE_ZONE("Scene::Update");
+
+		{
+			PROFILE_ZONE("CustomUpdate");
+			CustomUpdate();
+		}
+
+		{
+			PROFILE_ZONE("simulate");
+			px_scene->simulate(dt);
+		}
 
-		px_scene->simulate(dt);
-		px_scene->fetchResults(true);
+		{
+			PROFILE_ZONE("fetchResults");
+			px_scene->fetchResults(true);
+		}
 	}
 
 	void Scene::Add(Actor* actor) {
+		//the scene's simulation data of the actor, freed with the scene
+		ArenaScope scope(arena);
 		px_scene->addActor(*actor->Get());
 	}
 
@@ -255,8 +369,19 @@ namespace PhysicsEngine {
 		return px_scene;
 	}
 
+	void Scene::ReleaseOwned() {
+		Unpick();
+		for (size_t i = owned.size(); i-- > 0;)
+			owned[i].destroy(owned[i].object);
+		owned.clear();
+		selected_actor = 0;
+	}
+
 	void Scene::Reset() {
+		ReleaseOwned();
 		px_scene->release();
+		ReleaseArena(arena);
+		arena = 0;
 		Init();
 	}
 
@@ -268,6 +393,121 @@ namespace PhysicsEngine {
 		return pause;
 	}
 
+	bool Scene::Awake() {
+		if (pause)
+			return false;
+		std::vector<PxActor*> actors(px_scene->getNbActors(PxActorTypeSelectionFlag::eRIGID_DYNAMIC | PxActorTypeSelectionFlag::eCLOTH));
+		if (actors.size())
+			px_scene->getActors(PxActorTypeSelectionFlag::eRIGID_DYNAMIC | PxActorTypeSelectionFlag::eCLOTH, &actors.front(), (PxU32)actors.size());
+		for (unsigned int i = 0; i < actors.size(); i++) {
+			if (actors[i]->isCloth() ? !((PxCloth*)actors[i])->isSleeping() : !((PxRigidDynamic*)actors[i])->isSleeping())
+				return true;
+		}
+		return false;
+	}
+
+	void Scene::Capture(Snapshot& snapshot, bool skip_retained) {
+		PROFILE_ZONE("Scene::Capture");
+
+		const PxActorTypeSelectionFlags selection = PxActorTypeSelectionFlag::eRIGID_DYNAMIC | PxActorTypeSelectionFlag::eRIGID_STATIC |
+			PxActorTypeSelectionFlag::eCLOTH;
+		capture_actors.resize(px_scene->getNbActors(selection));
+		if (capture_actors.size())
+			px_scene->getActors(selection, &capture_actors.front(), (PxU32)capture_actors.size());
+
+		snapshot.shapes.clear();
+		PxU32 cloths = 0;
+		for (unsigned int i = 0; i < capture_actors.size(); i++) {
+			if (capture_actors[i]->isCloth()) {
+				PxCloth* cloth = (PxCloth*)capture_actors[i];
+				if (snapshot.cloths.size() <= cloths)
+					snapshot.cloths.resize(cloths + 1);
+				ClothSnapshot& c = snapshot.cloths[cloths++];
+				c.cloth = cloth;
+				c.pose = cloth->getGlobalPose();
+				c.bounds = cloth->getWorldBounds();
+				c.render_id = RenderTable::FromUserData(cloth->userData);
+				c.sleeping = cloth->isSleeping();
+				c.particles.resize(cloth->getNbParticles());
+				PxClothParticleData* particle_data = cloth->lockParticleData();
+				if (particle_data) {
+					if (c.particles.size())
+						memcpy(&c.particles.front(), particle_data->particles, c.particles.size() * sizeof(PxClothParticle));
+					particle_data->unlock();
+				}
+				continue;
+			}
+
+			PxRigidActor* actor = (PxRigidActor*)capture_actors[i];
+			capture_shapes.resize(actor->getNbShapes());
+			if (capture_shapes.empty())
+				continue;
+			actor->getShapes(&capture_shapes.front(), (PxU32)capture_shapes.size());
+			for (unsigned int j = 0; j < capture_shapes.size(); j++) {
+				const PxShape* shape = capture_shapes[j];
+				PxU32 id = RenderTable::FromUserData(shape->userData);
+				if (skip_retained && (id != RenderTable::NONE) && (RenderTable::Flags(id) & RenderTable::RETAINED))
+					continue;
+				ShapeSnapshot s;
+				s.shape = shape;
+				s.geometry = shape->getGeometry();
+				s.pose = PxShapeExt::getGlobalPose(*shape, *actor);
+				s.previous_pose = s.pose;
+				s.bounds = (s.geometry.getType() == PxGeometryType::ePLANE) ? PxBounds3::empty() : PxShapeExt::getWorldBounds(*shape, *actor);
+				s.render_id = id;
+				s.color = (id != RenderTable::NONE) ? RenderTable::Color(id) : default_color;
+				s.flags = (id != RenderTable::NONE) ? RenderTable::Flags(id) : 0;
+				snapshot.shapes.push_back(s);
+			}
+		}
+		snapshot.cloths.resize(cloths);
+
+		//the same shapes in the same order as last time, unless actors came or went
+		for (unsigned int i = 0; (i < snapshot.shapes.size()) && (i < captured_shapes.size()); i++) {
+			if (snapshot.shapes[i].shape == captured_shapes[i])
+				snapshot.shapes[i].previous_pose = captured_poses[i];
+		}
+		captured_shapes.resize(snapshot.shapes.size());
+		captured_poses.resize(snapshot.shapes.size());
+		for (unsigned int i = 0; i < snapshot.shapes.size(); i++) {
+			captured_shapes[i] = snapshot.shapes[i].shape;
+			captured_poses[i] = snapshot.shapes[i].pose;
+		}
+
+		snapshot.debug.clear();
+		if (px_scene->getVisualizationParameter(PxVisualizationParameter::eSCALE) > 0.f)
+			snapshot.debug.append(px_scene->getRenderBuffer());
+
+		PickSnapshot& pick = snapshot.pick;
+		pick.hit = (picked_actor != 0);
+		pick.dragging = (drag_joint != 0);
+		pick.target = drag_target;
+		if (pick.hit) {
+			const char* name = picked_actor->getName();
+			pick.name = name ? name : "";
+			pick.geometry = picked_shape->getGeometry();
+			PxMaterial* material = 0;
+			picked_shape->getMaterials(&material, 1);
+			pick.static_friction = material ? material->getStaticFriction() : 0.f;
+			pick.dynamic_friction = material ? material->getDynamicFriction() : 0.f;
+			pick.restitution = material ? material->getRestitution() : 0.f;
+			pick.point = picked_actor->getGlobalPose().transform(picked_point);
+			PxRigidDynamic* dynamic = picked_actor->is<PxRigidDynamic>();
+			pick.dynamic = (dynamic != 0);
+			pick.sleeping = dynamic ? dynamic->isSleeping() : true;
+			pick.mass = dynamic ? dynamic->getMass() : 0.f;
+			pick.velocity = dynamic ? dynamic->getLinearVelocity() : PxVec3(0.f);
+		}
+
+		snapshot.ball = selected_actor ? selected_actor->getGlobalPose() : PxTransform(PxIdentity);
+		snapshot.previous_ball = captures ? captured_ball : snapshot.ball;
+		captured_ball = snapshot.ball;
+		snapshot.ball_velocity = selected_actor ? selected_actor->getLinearVelocity() : PxVec3(0.f);
+		snapshot.paused = pause;
+		snapshot.awake = Awake();
+		snapshot.step = ++captures;
+	}
+
 	PxRigidDynamic* Scene::GetSelectedActor() {
 		return selected_actor;
 	}
@@ -299,26 +539,90 @@ namespace PhysicsEngine {
 		return actors;
 	}
 
+	bool Scene::Pick(const PxVec3& origin, const PxVec3& dir, bool drag) {
+		PROFILE_ZONE("Scene::Pick");
+		Unpick();
+
+		//a single query against the scene's bounding volume trees
+		SolidFilter filter;
+		const PxQueryFilterData filter_data(PxQueryFlag::eSTATIC | PxQueryFlag::eDYNAMIC | PxQueryFlag::ePREFILTER);
+		PxRaycastBuffer hit;
+		if (!px_scene->raycast(origin, dir.getNormalized(), pick_distance, hit, PxHitFlags(PxHitFlag::eDEFAULT), filter_data, &filter) || !hit.hasBlock)
+			return false;
+
+		picked_actor = hit.block.actor;
+		picked_shape = hit.block.shape;
+		picked_point = picked_actor->getGlobalPose().transformInv(hit.block.position);
+
+		PxRigidDynamic* dynamic = picked_actor->is<PxRigidDynamic>();
+		if (drag && dynamic && !(dynamic->getRigidDynamicFlags() & PxRigidDynamicFlag::eKINEMATIC)) {
+			drag_distance = hit.block.distance;
+			drag_target = hit.block.position;
+			//no first actor, its frame is the spring's end in world space
+			drag_joint = PxDistanceJointCreate(*GetPhysics(), 0, PxTransform(drag_target), dynamic, PxTransform(picked_point));
+			drag_joint->setConstraintFlag(PxConstraintFlag::eVISUALIZATION, true);
+			drag_joint->setMaxDistance(0.f);
+			drag_joint->setDistanceJointFlags(PxDistanceJointFlag::eSPRING_ENABLED | PxDistanceJointFlag::eMAX_DISTANCE_ENABLED);
+			//the same pull on light and heavy actors
+			drag_joint->setStiffness(dynamic->getMass() * drag_stiffness);
+			drag_joint->setDamping(dynamic->getMass() * drag_damping);
+			dynamic->wakeUp();
+		}
+		return true;
+	}
+
+	void Scene::Drag(const PxVec3& origin, const PxVec3& dir) {
+		if (!drag_joint)
+			return;
+		drag_target = origin + dir.getNormalized() * drag_distance;
+		drag_joint->setLocalPose(PxJointActorIndex::eACTOR0, PxTransform(drag_target));
+		((PxRigidDynamic*)picked_actor)->wakeUp();
+	}
+
+	void Scene::Drop() {
+		if (drag_joint)
+			drag_joint->release();
+		drag_joint = 0;
+	}
+
+	void Scene::Unpick() {
+		Drop();
+		picked_actor = 0;
+		picked_shape = 0;
+	}
+
+	PxReal Scene::SweepStatic(const PxVec3& origin, const PxVec3& dir, PxReal distance, PxReal radius) {
+		PROFILE_ZONE("Scene::SweepStatic");
+
+		StaticSweepFilter filter;
+		const PxQueryFilterData filter_data(PxQueryFlag::eSTATIC | PxQueryFlag::ePREFILTER | PxQueryFlag::ePOSTFILTER);
+		PxSweepBuffer hit;
+		if (px_scene->sweep(PxSphereGeometry(radius), PxTransform(origin), dir.getNormalized(), distance, hit, PxHitFlag::eDISTANCE,
+			filter_data, &filter) && hit.hasBlock)
+			return hit.block.distance;
+		return distance;
+	}
+
 	void Scene::HighlightOn(PxRigidDynamic* actor) {
-		//store the original colour and adjust brightness of the selected actor
+		//the renderer brightens highlighted shapes, the colours stay as they are
 		std::vector<PxShape*> shapes(actor->getNbShapes());
 		actor->getShapes((PxShape**)&shapes.front(), (PxU32)shapes.size());
 
-		sactor_color_orig.clear();
-
 		for (unsigned int i = 0; i < shapes.size(); i++) {
-			PxVec4* color = ((UserData*)shapes[i]->userData)->color;
-			sactor_color_orig.push_back(*color);
-			*color += PxVec4(.2f, .2f, .2f, 1.0f);
+			PxU32 id = RenderTable::FromUserData(shapes[i]->userData);
+			if (id != RenderTable::NONE)
+				RenderTable::Flags(id) |= RenderTable::HIGHLIGHT;
 		}
 	}
 
 	void Scene::HighlightOff(PxRigidDynamic* actor) {
-		//restore the original color
 		std::vector<PxShape*> shapes(actor->getNbShapes());
 		actor->getShapes((PxShape**)&shapes.front(), (PxU32)shapes.size());
 
-		for (unsigned int i = 0; i < shapes.size(); i++)
-			*((UserData*)shapes[i]->userData)->color = sactor_color_orig[i];
+		for (unsigned int i = 0; i < shapes.size(); i++) {
+			PxU32 id = RenderTable::FromUserData(shapes[i]->userData);
+			if (id != RenderTable::NONE)
+				RenderTable::Flags(id) &= ~RenderTable::HIGHLIGHT;
+		}
 	}
 }
@@ -3,6 +3,9 @@
 #include <vector>
 #include "PxPhysicsAPI.h"
 #include "Exception.h"
+#include "TrackingAllocator.h"
+#include "ObjectPool.h"
+#include "Snapshot.h"
 #include "Extras\UserData.h"
 #include <string>
 
@@ -10,8 +13,27 @@ namespace PhysicsEngine {
 	using namespace physx;
 	using namespace std;
 
+	///Where PhysX Visual Debugger data goes
+	enum PvdMode {
+		PVD_OFF,
+		PVD_SOCKET,	// live connection to a running PVD
+		PVD_FILE	// capture to a file written in the background
+	};
+
+	///PhysX Visual Debugger settings
+	struct PvdDesc {
+		PvdMode mode;
+		string host;
+		int port;
+		string file;
+		bool profile;		// send profiling events
+		bool memory;		// send memory events
+
+		PvdDesc() : mode(PVD_OFF), host("localhost"), port(5425), file("capture.pxd2"), profile(false), memory(false) {}
+	};
+
 	///Initialise PhysX framework
-	void PxInit();
+	void PxInit(const PvdDesc& pvd = PvdDesc());
 
 	///Release PhysX resources
 	void PxRelease();
@@ -28,6 +50,16 @@ namespace PhysicsEngine {
 	///Create a new material
 	PxMaterial* CreateMaterial(PxReal sf = .0f, PxReal df = .0f, PxReal cr = .0f);
 
+	///An existing material with these coefficients, created on first use.
+	///Shared between actors and scenes, do not modify it.
+	PxMaterial* SharedMaterial(PxReal sf, PxReal df, PxReal cr);
+
+	///An object shared between scenes under a key, 0 if there is none yet
+	PxBase* SharedObject(const string& key);
+
+	///Keep an object under a key; the engine owns it and releases it in PxRelease
+	void SharedObject(const string& key, PxBase* object);
+
 	static const PxVec4 default_color(.8f, .8f, .8f, 1.0f);
 
 	///Abstract Actor class
@@ -35,7 +67,8 @@ namespace PhysicsEngine {
 	class Actor {
 	protected:
 		PxActor* actor;
-		std::vector<PxVec4> colors;
+		//render table entries of the shapes
+		std::vector<PxU32> render_ids;
 		std::string name;
 
 	public:
@@ -44,6 +77,12 @@ namespace PhysicsEngine {
 			: actor(0) {
 		}
 
+		///Release the PhysX actor with its shapes and render entries
+		virtual ~Actor();
+
+		Actor(const Actor&) = delete;
+		Actor& operator=(const Actor&) = delete;
+
 		PxActor* Get();
 
 		void Color(PxVec4 new_color, PxU32 shape_index = -1);
@@ -71,8 +110,6 @@ namespace PhysicsEngine {
 	public:
 		DynamicActor(const PxTransform& pose);
 
-		~DynamicActor();
-
 		void CreateShape(const PxGeometry& geometry, PxReal density);
 
 		void SetKinematic(bool value, PxU32 index = -1);
@@ -82,31 +119,63 @@ namespace PhysicsEngine {
 	public:
 		StaticActor(const PxTransform& pose);
 
-		~StaticActor();
-
 		void CreateShape(const PxGeometry& geometry, PxReal density = 0.f);
 	};
 
 	///Generic scene class
 	class Scene {
+		///An object created by the scene, destroyed through its pool
+		struct Owned {
+			void* object;
+			void (*destroy)(void*);
+		};
+
+		//actors, joints and helpers owned by the scene, in creation order
+		std::vector<Owned> owned;
+
+		///Destroy the owned objects, newest first so joints go before their actors
+		void ReleaseOwned();
+
 	protected:
 		//a PhysX scene object
 		PxScene* px_scene;
+		//worker threads for the scene, kept across resets
+		PxDefaultCpuDispatcher* cpu_dispatcher;
+		//allocations that live exactly as long as the PhysX scene, 0 without arena mode
+		Arena* arena;
 		//pause simulation
 		bool pause;
 		//selected dynamic actor on the scene
 		PxRigidDynamic* selected_actor;
-		//original and modified colour of the selected actor
-		std::vector<PxVec4> sactor_color_orig;
 		//custom filter shader
 		PxSimulationFilterShader filter_shader;
+		//actors and shape poses of the last capture, kept to avoid allocating
+		std::vector<PxActor*> capture_actors;
+		std::vector<PxShape*> capture_shapes;
+		std::vector<const PxShape*> captured_shapes;
+		std::vector<PxTransform> captured_poses;
+		PxTransform captured_ball;
+		PxU64 captures;
+		//picked actor and shape, the picked point in the actor's frame
+		PxRigidActor* picked_actor;
+		PxShape* picked_shape;
+		PxVec3 picked_point;
+		//spring from the pick ray to the picked point while dragging
+		PxDistanceJoint* drag_joint;
+		PxVec3 drag_target;
+		PxReal drag_distance;
 
 		void HighlightOn(PxRigidDynamic* actor);
 
 		void HighlightOff(PxRigidDynamic* actor);
 
 	public:
-		Scene(PxSimulationFilterShader custom_filter_shader = PxDefaultSimulationFilterShader) : filter_shader(custom_filter_shader) {}
+		Scene(PxSimulationFilterShader custom_filter_shader = PxDefaultSimulationFilterShader)
+			: px_scene(0), cpu_dispatcher(0), arena(0), filter_shader(custom_filter_shader), captured_ball(PxIdentity), captures(0),
+			picked_actor(0), picked_shape(0), picked_point(0.f), drag_joint(0), drag_target(0.f), drag_distance(0.f) {}
+
+		///Release the PhysX scene and its dispatcher
+		virtual ~Scene();
 
 		///Init the scene
 		void Init();
@@ -123,6 +192,16 @@ namespace PhysicsEngine {
 		///Add actors
 		void Add(Actor* actor);
 
+		///Create an actor, joint or helper owned by the scene.
+		///It is destroyed on Reset and with the scene, its memory is pooled per type.
+		template<class T, class... Args>
+		T* Create(Args&&... args) {
+			T* object = ObjectPool<T>::Get().Create(std::forward<Args>(args)...);
+			Owned entry = { object, &ObjectPool<T>::Release };
+			owned.push_back(entry);
+			return object;
+		}
+
 		///Get the PxScene object
 		PxScene* Get();
 
@@ -135,6 +214,13 @@ namespace PhysicsEngine {
 		///Get pause
 		bool Pause();
 
+		///Is any dynamic actor or cloth awake, false while paused
+		bool Awake();
+
+		///Copy what is needed to draw the scene and run the game loop into a snapshot,
+		///skip_retained leaves out the shapes baked into the renderer's static chunks
+		virtual void Capture(Snapshot& snapshot, bool skip_retained);
+
 		///Get the selected dynamic actor on the scene
 		PxRigidDynamic* GetSelectedActor();
 
@@ -143,6 +229,24 @@ namespace PhysicsEngine {
 
 		///a list with all actors
 		std::vector<PxActor*> GetAllActors();
+
+		///Pick the first shape along a ray with a single scene query, false if nothing was hit.
+		///With drag a dynamic actor is pulled towards the ray by a spring until Drop.
+		bool Pick(const PxVec3& origin, const PxVec3& dir, bool drag = false);
+
+		///Move the spring to the same distance along a new ray
+		void Drag(const PxVec3& origin, const PxVec3& dir);
+
+		///Release the spring, the actor stays picked
+		void Drop();
+
+		///Forget the picked actor
+		void Unpick();
+
+		///How far a sphere moves from origin along dir before it hits a static shape, distance if nothing
+		///is in the way. Triggers and shapes the sphere starts in are ignored. Call it from the thread
+		///that steps the scene.
+		PxReal SweepStatic(const PxVec3& origin, const PxVec3& dir, PxReal distance, PxReal radius);
 	};
 
 	///Generic Joint class
@@ -153,6 +257,15 @@ namespace PhysicsEngine {
 	public:
 		Joint() : joint(0) {}
 
+		///Release the PhysX joint
+		virtual ~Joint() {
+			if (joint)
+				joint->release();
+		}
+
+		Joint(const Joint&) = delete;
+		Joint& operator=(const Joint&) = delete;
+
 		PxJoint* Get() { return joint; }
 	};
 
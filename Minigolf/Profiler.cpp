@@ -0,0 +1,155 @@
+#include "Profiler.h"
+#include <mutex>
+#include <cmath>
+#include <algorithm>
+
+namespace Profiler
+{
+	//histogram buckets grow by 2^(1/4) from 0.25us, 96 of them reach past 4s
+	static const unsigned int bucket_count = 96;
+	static const double bucket_base = 0.25;
+	static const double buckets_per_octave = 4.0;
+
+	//samples kept per zone
+	static const unsigned int window = 512;
+
+	///The buckets of a zone's last samples on one thread
+	struct ZoneSamples {
+		unsigned int buckets[bucket_count];
+		unsigned char ring[window];
+		float ring_us[window];
+		unsigned int next;
+		unsigned int samples;
+
+		ZoneSamples() : next(0), samples(0) {
+			for (unsigned int i = 0; i < bucket_count; i++)
+				buckets[i] = 0;
+		}
+	};
+
+	///Samples recorded by one thread, its lock is only contended while a report is taken
+	struct ThreadZones {
+		mutex lock;
+		vector<ZoneSamples> zones;
+	};
+
+	//zone names and every thread's samples; threads that exit leave theirs for the next thread
+	static mutex zones_mutex;
+	static vector<string> names;
+	static vector<ThreadZones*> threads;
+	static vector<ThreadZones*> idle_threads;
+
+	///The calling thread's samples, taken on its first sample and handed back when it exits
+	struct ThreadSlot {
+		ThreadZones* zones;
+
+		ThreadSlot() {
+			lock_guard<mutex> lock(zones_mutex);
+			if (idle_threads.size()) {
+				zones = idle_threads.back();
+				idle_threads.pop_back();
+			}
+			else {
+				zones = new ThreadZones();
+				threads.push_back(zones);
+			}
+		}
+
+		~ThreadSlot() {
+			lock_guard<mutex> lock(zones_mutex);
+			idle_threads.push_back(zones);
+		}
+	};
+
+	static thread_local ThreadSlot thread_slot;
+
+	static unsigned int Bucket(double us) {
+		if (us <= bucket_base)
+			return 0;
+		double b = log2(us / bucket_base) * buckets_per_octave;
+		return (b >= bucket_count - 1) ? bucket_count - 1 : (unsigned int)b;
+	}
+
+	///Upper edge of a bucket
+	static double BucketLimit(unsigned int bucket) {
+		return bucket_base * pow(2.0, (bucket + 1) / buckets_per_octave);
+	}
+
+	static double Percentile(const unsigned int* buckets, unsigned int samples, double p) {
+		unsigned int rank = (unsigned int)ceil(p * samples);
+		unsigned int seen = 0;
+		for (unsigned int i = 0; i < bucket_count; i++) {
+			seen += buckets[i];
+			if (seen >= rank)
+				return BucketLimit(i);
+		}
+		return BucketLimit(bucket_count - 1);
+	}
+
+	unsigned int Register(const char* name) {
+		lock_guard<mutex> lock(zones_mutex);
+		for (unsigned int i = 0; i < names.size(); i++)
+			if (names[i] == name)
+				return i;
+		names.push_back(name);
+		return (unsigned int)names.size() - 1;
+	}
+
+	void Record(unsigned int zone_id, double microseconds) {
+		ThreadZones& own = *thread_slot.zones;
+		lock_guard<mutex> lock(own.lock);
+		if (zone_id >= own.zones.size())
+			own.zones.resize(zone_id + 1);
+		ZoneSamples& zone = own.zones[zone_id];
+		unsigned int bucket = Bucket(microseconds);
+
+		//drop the sample leaving the window
+		if (zone.samples == window)
+			zone.buckets[zone.ring[zone.next]]--;
+		else
+			zone.samples++;
+
+		zone.ring[zone.next] = (unsigned char)bucket;
+		zone.ring_us[zone.next] = (float)microseconds;
+		zone.buckets[bucket]++;
+		zone.next = (zone.next + 1) % window;
+	}
+
+	vector<ZoneReport> Report() {
+		lock_guard<mutex> lock(zones_mutex);
+		vector<ZoneReport> report(names.size());
+		vector<unsigned int> buckets(names.size() * bucket_count, 0);
+		for (unsigned int i = 0; i < names.size(); i++) {
+			report[i].name = names[i];
+			report[i].samples = 0;
+			report[i].max_us = 0.0;
+		}
+
+		//the windows of all threads together
+		for (unsigned int t = 0; t < threads.size(); t++) {
+			lock_guard<mutex> thread_lock(threads[t]->lock);
+			const vector<ZoneSamples>& zones = threads[t]->zones;
+			for (unsigned int i = 0; i < zones.size(); i++) {
+				report[i].samples += zones[i].samples;
+				for (unsigned int j = 0; j < bucket_count; j++)
+					buckets[i * bucket_count + j] += zones[i].buckets[j];
+				for (unsigned int j = 0; j < zones[i].samples; j++)
+					report[i].max_us = max(report[i].max_us, (double)zones[i].ring_us[j]);
+			}
+		}
+
+		for (unsigned int i = 0; i < names.size(); i++) {
+			report[i].p50_us = report[i].samples ? Percentile(&buckets[i * bucket_count], report[i].samples, 0.50) : 0.0;
+			report[i].p99_us = report[i].samples ? Percentile(&buckets[i * bucket_count], report[i].samples, 0.99) : 0.0;
+		}
+		return report;
+	}
+
+	bool Enabled() {
+#ifdef MINIGOLF_PROFILE
+		return true;
+#else
+		return false;
+#endif
+	}
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <chrono>
+
+///Scoped timing zones, compiled in only when MINIGOLF_PROFILE is defined.
+///
+///PROFILE_ZONE("name") times the rest of the enclosing scope. Each zone keeps a
+///rolling histogram of its last samples on each thread, read with Profiler::Report.
+#ifdef MINIGOLF_PROFILE
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_ZONE(name) \
+	static const unsigned int PROFILE_CONCAT(profile_id_, __LINE__) = Profiler::Register(name); \
+	Profiler::ScopedZone PROFILE_CONCAT(profile_zone_, __LINE__)(PROFILE_CONCAT(profile_id_, __LINE__))
+#else
+#define PROFILE_ZONE(name)
+#endif
+
+namespace Profiler
+{
+	using namespace std;
+
+	///Summary of a zone over the rolling windows of all threads
+	struct ZoneReport {
+		string name;
+		unsigned int samples;
+		double p50_us;
+		double p99_us;
+		double max_us;
+	};
+
+	///Get a zone id, the same name always gives the same id
+	unsigned int Register(const char* name);
+
+	///Add a sample to a zone
+	void Record(unsigned int zone, double microseconds);
+
+	///Summaries of all zones in registration order
+	vector<ZoneReport> Report();
+
+	///Is the profiler compiled in
+	bool Enabled();
+
+	///Times a scope into a zone
+	class ScopedZone {
+		unsigned int zone;
+		chrono::high_resolution_clock::time_point start;
+
+	public:
+		ScopedZone(unsigned int _zone) : zone(_zone), start(chrono::high_resolution_clock::now()) {}
+
+		~ScopedZone() {
+			Record(zone, chrono::duration<double, micro>(chrono::high_resolution_clock::now() - start).count());
+		}
+	};
+}
@@ -0,0 +1,91 @@
+#include "PvdFileStream.h"
+#include "Exception.h"
+
+namespace PhysicsEngine
+{
+	PvdFileStream::PvdFileStream(const std::string& filename)
+		: file(filename.c_str(), std::ios::binary), queued_bytes(0), written(0), open(true) {
+		if (!file)
+			throw new Exception("PvdFileStream::PvdFileStream, could not open " + filename + ".");
+		current.reserve(block_size);
+		writer = std::thread(&PvdFileStream::WriterLoop, this);
+	}
+
+	PvdFileStream::~PvdFileStream() {
+		disconnect();
+	}
+
+	void PvdFileStream::WriterLoop() {
+		std::unique_lock<std::mutex> lock(queue_mutex);
+		for (;;) {
+			queue_changed.wait(lock, [this] { return !queue.empty() || !open; });
+			if (queue.empty())
+				return;
+
+			std::vector<PxU8> block;
+			block.swap(queue.front());
+			queue.pop_front();
+
+			//write without holding up the simulation thread
+			lock.unlock();
+			file.write((const char*)&block.front(), block.size());
+			lock.lock();
+
+			queued_bytes -= block.size();
+			queue_changed.notify_all();
+		}
+	}
+
+	//queue_mutex has to be held
+	void PvdFileStream::Push() {
+		if (current.empty())
+			return;
+		queued_bytes += current.size();
+		queue.push_back(std::vector<PxU8>());
+		queue.back().swap(current);
+		current.reserve(block_size);
+		queue_changed.notify_all();
+	}
+
+	debugger::PvdError PvdFileStream::write(const PxU8* bytes, PxU32 length) {
+		std::unique_lock<std::mutex> lock(queue_mutex);
+		if (!open)
+			return debugger::PvdErrorType::NetworkError;
+
+		current.insert(current.end(), bytes, bytes + length);
+		written += length;
+
+		if (current.size() >= block_size) {
+			queue_changed.wait(lock, [this] { return queued_bytes < max_queued; });
+			Push();
+		}
+		return debugger::PvdErrorType::Success;
+	}
+
+	bool PvdFileStream::isConnected() const {
+		return open;
+	}
+
+	void PvdFileStream::disconnect() {
+		{
+			std::lock_guard<std::mutex> lock(queue_mutex);
+			if (!open)
+				return;
+			Push();
+			open = false;
+			queue_changed.notify_all();
+		}
+		//the writer drains the queue before it stops
+		writer.join();
+		file.close();
+	}
+
+	void PvdFileStream::release() {
+		disconnect();
+	}
+
+	PxU64 PvdFileStream::getWrittenDataSize() {
+		std::lock_guard<std::mutex> lock(queue_mutex);
+		return written;
+	}
+}
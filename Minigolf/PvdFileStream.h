@@ -0,0 +1,58 @@
+#pragma once
+
+#include "PxPhysicsAPI.h"
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <fstream>
+
+namespace PhysicsEngine
+{
+	using namespace physx;
+
+	///PVD capture stream writing to a file from a background thread.
+	///
+	///PhysX hands over data on the simulation thread; write only copies it into
+	///a block that the writer thread flushes to disk. When the writer falls more
+	///than max_queued bytes behind, write waits instead of growing the queue.
+	///release() only flushes and closes, the stream is deleted by its creator.
+	class PvdFileStream : public debugger::comm::PvdNetworkOutStream
+	{
+		static const size_t block_size = 1 << 20;
+		static const size_t max_queued = 64 << 20;
+
+		std::ofstream file;
+		std::vector<PxU8> current;
+		std::deque<std::vector<PxU8> > queue;
+		size_t queued_bytes;
+		PxU64 written;
+		bool open;
+
+		std::mutex queue_mutex;
+		std::condition_variable queue_changed;
+		std::thread writer;
+
+		void WriterLoop();
+
+		void Push();
+
+	public:
+		PvdFileStream(const std::string& filename);
+
+		~PvdFileStream();
+
+		virtual debugger::PvdError write(const PxU8* bytes, PxU32 length);
+
+		virtual bool isConnected() const;
+
+		///Flush what is buffered and close the file
+		virtual void disconnect();
+
+		virtual void release();
+
+		virtual PxU64 getWrittenDataSize();
+	};
+}
@@ -0,0 +1,94 @@
+#include "Replay.h"
+#include "MyPhysicsEngine.h"
+#include "CourseGenerator.h"
+#include "CameraPath.h"
+#include "Camera.h"
+#include "Extras\Renderer.h"
+#include "Extras\FrameCapture.h"
+#include <chrono>
+#include <iostream>
+
+namespace VisualDebugger
+{
+	using namespace PhysicsEngine;
+
+	static MyScene* CreateCourse(const CaptureDesc& desc) {
+		if (desc.course == "course")
+			return new MyScene();
+		if (desc.course == "generated")
+			return new GeneratedScene(desc.tiles, desc.seed);
+		throw new Exception("VisualDebugger::CreateCourse, unknown course " + desc.course + ".");
+	}
+
+	void RunCapture(const CaptureDesc& desc) {
+		MyScene* scene = CreateCourse(desc);
+		scene->Init();
+		{
+			vector<PxActor*> actors = scene->GetAllActors();
+			if (actors.size())
+				Renderer::BuildStatic(&actors[0], (PxU32)actors.size());
+		}
+
+		CameraPath recording;
+		if (desc.recording.size())
+			recording = CameraPath::Load(desc.recording);
+		const vector<ShotEvent>& shots = recording.Shots();
+
+		//without a recording the camera follows the ball like in the game
+		Camera camera(PxVec3(10.0f, 5.0f, 15.0f), scene->GetSelectedActor()->getGlobalPose().p, 20.0f);
+
+		const PxReal delta_time = 1.0f / desc.fps;
+		PxReal duration = desc.duration;
+		if ((duration <= 0.0f) && !recording.Empty())
+			duration = recording.Duration();
+		if (duration <= 0.0f)
+			duration = 10.0f;
+		const PxU32 frames = (PxU32)(duration * desc.fps + 0.5f);
+
+		FrameCapture capture(desc.output, desc.width, desc.height);
+		cerr << "capturing " << frames << " frames to " << desc.output
+			<< (capture.Async() ? "" : " without pixel buffer objects") << endl;
+
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		size_t next_shot = 0;
+		for (PxU32 i = 0; i < frames; i++) {
+			const PxReal time = i * delta_time;
+			while ((next_shot < shots.size()) && (shots[next_shot].time <= time)) {
+				scene->Shoot(shots[next_shot].dir, shots[next_shot].strength);
+				next_shot++;
+			}
+
+			PxVec3 eye, dir;
+			if (recording.Empty()) {
+				//one thread here, the sweep can run right before the camera moves
+				const PxVec3 target = scene->GetSelectedActor()->getGlobalPose().p;
+				const PxVec3 offset = camera.Offset();
+				const PxReal length = offset.magnitude();
+				const PxReal clear = (length > 1e-3f) ? scene->SweepStatic(target, offset / length, length, camera.CollisionRadius()) : PX_MAX_F32;
+				camera.UpdatePosition(target, delta_time, clear);
+				eye = camera.getEye();
+				dir = camera.getDir();
+			}
+			else
+				recording.Sample(time, eye, dir);
+
+			Renderer::Start(eye, dir);
+			{
+				vector<PxActor*> actors = scene->GetAllActors();
+				if (actors.size())
+					Renderer::Render(&actors[0], (PxU32)actors.size());
+			}
+			//no Renderer::Finish, it would wait for the frame the capture reads back later
+			capture.Frame();
+
+			scene->Update(delta_time);
+		}
+		capture.Flush();
+
+		const double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+		cerr << "captured " << capture.Written() << " frames (" << duration << " s) in " << seconds << " s" << endl;
+
+		Renderer::ReleaseStatic();
+		delete scene;
+	}
+}
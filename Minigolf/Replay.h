@@ -0,0 +1,29 @@
+#pragma once
+
+#include "foundation/PxSimpleTypes.h"
+#include <string>
+
+namespace VisualDebugger
+{
+	using namespace std;
+	using namespace physx;
+
+	///Replay capture settings
+	struct CaptureDesc {
+		string output;			// FrameCapture output: file, "name%05d.ppm" or "pipe:command"
+		string recording;		// camera and shots from --record-camera, empty to follow the ball
+		string course;			// "course" or "generated"
+		PxU32 width;			// frame size
+		PxU32 height;
+		PxU32 tiles;			// "generated": number of path pieces
+		PxU32 seed;				// "generated": layout seed
+		PxReal fps;				// frame rate of the video, also the simulation rate
+		PxReal duration;		// seconds, 0 for the length of the recording
+
+		CaptureDesc() : course("course"), width(1280), height(720), tiles(200), seed(1), fps(60.f), duration(0.f) {}
+	};
+
+	///Replay a recording offscreen as fast as it renders and capture every frame,
+	///PhysX and an offscreen renderer have to be initialised already
+	void RunCapture(const CaptureDesc& desc);
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+#include "PxPhysicsAPI.h"
+#include <vector>
+#include <string>
+#include <atomic>
+#include <chrono>
+
+namespace PhysicsEngine
+{
+	using namespace physx;
+	using namespace std;
+
+	///A shape as it was at the end of a step
+	struct ShapeSnapshot {
+		const PxShape* shape;			// identity only, not to be read from another thread
+		PxGeometryHolder geometry;
+		PxTransform pose;
+		PxTransform previous_pose;		// pose at the previous capture, for interpolation
+		PxBounds3 bounds;
+		PxU32 render_id;
+		PxVec4 color;					// render attributes copied from the render table,
+		PxU32 flags;					// so that drawing streams through the snapshot alone
+	};
+
+	///A cloth as it was at the end of a step
+	struct ClothSnapshot {
+		const PxCloth* cloth;			// identity only
+		PxTransform pose;
+		PxBounds3 bounds;
+		PxU32 render_id;
+		bool sleeping;
+		vector<PxVec4> particles;		// PxClothParticle layout, inverse weight in w
+	};
+
+	///The picked actor as it was at the end of a step
+	struct PickSnapshot {
+		bool hit;
+		bool dynamic;
+		bool sleeping;
+		bool dragging;
+		string name;
+		PxGeometryHolder geometry;		// of the picked shape
+		PxReal static_friction;
+		PxReal dynamic_friction;
+		PxReal restitution;
+		PxReal mass;
+		PxVec3 point;					// picked point, moving with the actor
+		PxVec3 target;					// where the spring pulls the point while dragging
+		PxVec3 velocity;
+
+		PickSnapshot() : hit(false), dynamic(false), sleeping(false), dragging(false), static_friction(0.f), dynamic_friction(0.f),
+			restitution(0.f), mass(0.f), point(0.f), target(0.f), velocity(0.f) {}
+	};
+
+	///Debug geometry copied out of the scene, drawn like the scene's own buffer
+	class DebugSnapshot : public PxRenderBuffer {
+	public:
+		vector<PxDebugPoint> points;
+		vector<PxDebugLine> lines;
+		vector<PxDebugTriangle> triangles;
+
+		virtual PxU32 getNbPoints() const { return (PxU32)points.size(); }
+		virtual const PxDebugPoint* getPoints() const { return points.size() ? &points.front() : 0; }
+		virtual PxU32 getNbLines() const { return (PxU32)lines.size(); }
+		virtual const PxDebugLine* getLines() const { return lines.size() ? &lines.front() : 0; }
+		virtual PxU32 getNbTriangles() const { return (PxU32)triangles.size(); }
+		virtual const PxDebugTriangle* getTriangles() const { return triangles.size() ? &triangles.front() : 0; }
+		virtual PxU32 getNbTexts() const { return 0; }
+		virtual const PxDebugText* getTexts() const { return 0; }
+
+		virtual void append(const PxRenderBuffer& other) {
+			points.insert(points.end(), other.getPoints(), other.getPoints() + other.getNbPoints());
+			lines.insert(lines.end(), other.getLines(), other.getLines() + other.getNbLines());
+			triangles.insert(triangles.end(), other.getTriangles(), other.getTriangles() + other.getNbTriangles());
+		}
+
+		virtual void clear() {
+			points.clear();
+			lines.clear();
+			triangles.clear();
+		}
+	};
+
+	///Everything the renderer and the game loop read from a scene after a step.
+	///
+	///The vectors keep their capacity between captures, so capturing does not allocate
+	///once the scene has settled.
+	struct Snapshot {
+		PxU64 step;
+		PxReal delta_time;
+		chrono::steady_clock::time_point time;		// when it was published
+		vector<ShapeSnapshot> shapes;
+		vector<ClothSnapshot> cloths;
+		DebugSnapshot debug;
+		PickSnapshot pick;
+		PxTransform ball;
+		PxTransform previous_ball;
+		PxVec3 ball_velocity;
+		PxReal camera_clear;		// how far the follow camera's eye can be from the ball, PX_MAX_F32 if unchecked
+		bool paused;
+		bool awake;
+		bool game_ended;
+
+		Snapshot() : step(0), delta_time(0.f), ball(PxIdentity), previous_ball(PxIdentity), ball_velocity(0.f),
+			camera_clear(PX_MAX_F32), paused(false), awake(false), game_ended(false) {}
+	};
+
+	///Blend of two poses, t = 0 gives a
+	inline PxTransform Interpolate(const PxTransform& a, const PxTransform& b, PxReal t) {
+		//normalised lerp, taking the shorter way round
+		PxQuat q1 = (a.q.dot(b.q) < 0.f) ? -b.q : b.q;
+		PxQuat q = a.q * (1.f - t) + q1 * t;
+		return PxTransform(a.p + (b.p - a.p) * t, q.getNormalized());
+	}
+
+	///Lock-free triple buffer of snapshots, one writer and one reader thread.
+	///
+	///The writer fills Write() and publishes it, the reader takes the latest with Acquire.
+	///Neither waits; the reader skips snapshots it was too slow to see.
+	class SnapshotBuffer {
+		static const PxU32 FRESH = 4;
+
+		Snapshot slots[3];
+		atomic<PxU32> middle;		// slot in between, FRESH when not read yet
+		PxU32 write;
+		PxU32 read;
+
+	public:
+		SnapshotBuffer() : middle(1), write(0), read(2) {}
+
+		///Slot owned by the writer
+		Snapshot& Write() { return slots[write]; }
+
+		///Hand the written slot to the reader
+		void Publish() {
+			slots[write].time = chrono::steady_clock::now();
+			write = middle.exchange(write | FRESH) & ~FRESH;
+		}
+
+		///Latest published snapshot, valid until the next Acquire
+		const Snapshot& Acquire() {
+			if (middle.load() & FRESH)
+				read = middle.exchange(read) & ~FRESH;
+			return slots[read];
+		}
+	};
+}
@@ -0,0 +1,336 @@
+#include "TrackingAllocator.h"
+#include "extensions/PxDefaultAllocator.h"
+#include <atomic>
+#include <mutex>
+#include <deque>
+#include <map>
+#include <unordered_map>
+#include <algorithm>
+
+namespace PhysicsEngine
+{
+	using namespace std;
+
+	class Arena;
+
+	///In front of every block, PhysX wants 16 byte alignment
+	struct BlockHeader {
+		PxU32 size;
+		PxU32 name;
+		Arena* arena;
+	};
+
+	static const size_t header_size = 16;
+	static_assert(sizeof(BlockHeader) <= header_size, "block header does not fit");
+
+	static PxDefaultAllocator system_allocator;
+
+	///Size class free lists carved out of large chunks
+	class Arena {
+		static const PxU32 class_count = 10;	// 32 bytes to 16 KB
+		static const size_t chunk_size = 256 << 10;
+
+		vector<void*> chunks;
+		char* cursor;
+		char* end;
+		void* free_lists[class_count];
+
+	public:
+		//arenas are independent, each scene only waits for its own
+		mutex lock;
+		PxU64 live;
+		bool retired;
+
+		Arena() : cursor(0), end(0), live(0), retired(false) {
+			for (PxU32 i = 0; i < class_count; i++)
+				free_lists[i] = 0;
+		}
+
+		///Bulk free
+		~Arena() {
+			for (size_t i = 0; i < chunks.size(); i++)
+				system_allocator.deallocate(chunks[i]);
+		}
+
+		///Size class of a block including its header, -1 if too big
+		static int SizeClass(size_t bytes) {
+			size_t class_size = 32;
+			for (PxU32 i = 0; i < class_count; i++, class_size <<= 1)
+				if (bytes <= class_size)
+					return i;
+			return -1;
+		}
+
+		size_t Reserved() const { return chunks.size() * chunk_size; }
+
+		void* Allocate(int size_class) {
+			live++;
+			if (free_lists[size_class]) {
+				void* block = free_lists[size_class];
+				free_lists[size_class] = *(void**)block;
+				return block;
+			}
+
+			const size_t class_size = (size_t)32 << size_class;
+			if ((size_t)(end - cursor) < class_size) {
+				//the rest of the old chunk is left unused
+				cursor = (char*)system_allocator.allocate(chunk_size, "Arena", __FILE__, __LINE__);
+				end = cursor + chunk_size;
+				chunks.push_back(cursor);
+			}
+			void* block = cursor;
+			cursor += class_size;
+			return block;
+		}
+
+		void Free(void* block, int size_class) {
+			*(void**)block = free_lists[size_class];
+			free_lists[size_class] = block;
+			live--;
+		}
+	};
+
+	///Counters of one allocation name
+	struct NameStats {
+		string name;
+		atomic<PxU64> allocations;
+		atomic<PxU64> live_count;
+		atomic<PxU64> live_bytes;
+		atomic<PxU64> peak_bytes;
+
+		NameStats(const string& _name) : name(_name), allocations(0), live_count(0), live_bytes(0), peak_bytes(0) {}
+	};
+
+	static atomic<PxU64> allocations(0);
+	static atomic<PxU64> deallocations(0);
+	static atomic<PxU64> live_bytes(0);
+	static atomic<PxU64> peak_bytes(0);
+
+	//names are looked up by pointer first, PhysX passes string literals;
+	//name_table is filled before an index is handed out so reading it needs no lock
+	static const PxU32 max_names = 4096;
+	static mutex names_mutex;
+	static deque<NameStats> names;
+	static NameStats* name_table[max_names];
+	static unordered_map<const char*, PxU32> names_by_pointer;
+	static map<string, PxU32> names_by_string;
+	//per thread cache in front of names_by_pointer, the lock is only taken for a name the thread
+	//has not seen; plain data, so it is still usable while the thread's destructors run
+	struct NameCacheEntry {
+		const char* type_name;
+		PxU32 index;
+	};
+	static const PxU32 name_cache_size = 64;
+	static thread_local NameCacheEntry name_cache[name_cache_size];
+
+	//arenas
+	static atomic<bool> arena_mode(false);
+	static atomic<PxU32> arena_count(0);
+	static atomic<PxU64> arena_bytes(0);
+	//arena the allocations of this thread go to
+	static thread_local Arena* thread_arena = 0;
+
+	static void RaisePeak(atomic<PxU64>& peak, PxU64 live) {
+		PxU64 old = peak;
+		while ((live > old) && !peak.compare_exchange_weak(old, live)) {}
+	}
+
+	static PxU32 LookupName(const char* type_name) {
+		lock_guard<mutex> lock(names_mutex);
+		unordered_map<const char*, PxU32>::iterator found = names_by_pointer.find(type_name);
+		if (found != names_by_pointer.end())
+			return found->second;
+
+		map<string, PxU32>::iterator same = names_by_string.find(type_name);
+		PxU32 index;
+		if (same != names_by_string.end()) {
+			index = same->second;
+		}
+		else if (names.size() < max_names) {
+			index = (PxU32)names.size();
+			names.emplace_back(type_name);
+			name_table[index] = &names.back();
+			names_by_string[type_name] = index;
+		}
+		else {
+			//out of slots, counted under the last name
+			index = max_names - 1;
+		}
+		names_by_pointer[type_name] = index;
+		return index;
+	}
+
+	static PxU32 NameIndex(const char* type_name) {
+		if (!type_name)
+			type_name = "unnamed";
+
+		NameCacheEntry& cached = name_cache[((size_t)type_name >> 3) % name_cache_size];
+		if (cached.type_name == type_name)
+			return cached.index;
+
+		cached.index = LookupName(type_name);
+		cached.type_name = type_name;
+		return cached.index;
+	}
+
+	static void FreeArena(Arena* arena) {
+		arena_bytes -= arena->Reserved();
+		arena_count--;
+		delete arena;
+	}
+
+	void* TrackingAllocator::allocate(size_t size, const char* typeName, const char* filename, int line) {
+		const size_t total = size + header_size;
+		char* block = 0;
+		Arena* arena = 0;
+
+		int size_class = thread_arena ? Arena::SizeClass(total) : -1;
+		if (size_class >= 0) {
+			arena = thread_arena;
+			lock_guard<mutex> lock(arena->lock);
+			size_t reserved = arena->Reserved();
+			block = (char*)arena->Allocate(size_class);
+			arena_bytes += arena->Reserved() - reserved;
+		}
+
+		if (!block)
+			block = (char*)system_allocator.allocate(total, typeName, filename, line);
+		if (!block)
+			return 0;
+
+		BlockHeader* header = (BlockHeader*)block;
+		header->size = (PxU32)size;
+		header->name = NameIndex(typeName);
+		header->arena = arena;
+
+		NameStats& name = *name_table[header->name];
+		name.allocations++;
+		name.live_count++;
+		RaisePeak(name.peak_bytes, name.live_bytes += size);
+
+		allocations++;
+		RaisePeak(peak_bytes, live_bytes += size);
+
+		return block + header_size;
+	}
+
+	void TrackingAllocator::deallocate(void* ptr) {
+		if (!ptr)
+			return;
+
+		char* block = (char*)ptr - header_size;
+		BlockHeader* header = (BlockHeader*)block;
+
+		NameStats& name = *name_table[header->name];
+		name.live_count--;
+		name.live_bytes -= header->size;
+		live_bytes -= header->size;
+		deallocations++;
+
+		if (!header->arena) {
+			system_allocator.deallocate(block);
+			return;
+		}
+
+		Arena* arena = header->arena;
+		bool free_arena;
+		{
+			lock_guard<mutex> lock(arena->lock);
+			arena->Free(block, Arena::SizeClass(header->size + header_size));
+			free_arena = arena->retired && !arena->live;
+		}
+		if (free_arena)
+			FreeArena(arena);
+	}
+
+	MemoryStats GetMemoryStats() {
+		MemoryStats stats;
+		stats.allocations = allocations;
+		stats.deallocations = deallocations;
+		stats.live_bytes = live_bytes;
+		stats.peak_bytes = peak_bytes;
+		stats.arena_bytes = arena_bytes;
+		stats.arenas = arena_count;
+		return stats;
+	}
+
+	void ResetMemoryPeak() {
+		peak_bytes = live_bytes.load();
+
+		lock_guard<mutex> lock(names_mutex);
+		for (size_t i = 0; i < names.size(); i++)
+			names[i].peak_bytes = names[i].live_bytes.load();
+	}
+
+	static bool PeakGreater(const AllocationStats& a, const AllocationStats& b) {
+		return a.peak_bytes > b.peak_bytes;
+	}
+
+	vector<AllocationStats> GetAllocationStats() {
+		vector<AllocationStats> stats;
+		{
+			lock_guard<mutex> lock(names_mutex);
+			for (size_t i = 0; i < names.size(); i++) {
+				AllocationStats s;
+				s.name = names[i].name;
+				s.allocations = names[i].allocations;
+				s.live_count = names[i].live_count;
+				s.live_bytes = names[i].live_bytes;
+				s.peak_bytes = names[i].peak_bytes;
+				stats.push_back(s);
+			}
+		}
+		sort(stats.begin(), stats.end(), PeakGreater);
+		return stats;
+	}
+
+	bool ReportLeaks(ostream& out) {
+		vector<AllocationStats> stats = GetAllocationStats();
+		bool leaks = false;
+		for (size_t i = 0; i < stats.size(); i++) {
+			if (!stats[i].live_count)
+				continue;
+			if (!leaks)
+				out << "PhysX allocations still live:" << endl;
+			leaks = true;
+			out << "  " << stats[i].name << ": " << stats[i].live_count << " blocks, " << stats[i].live_bytes << " bytes" << endl;
+		}
+		return leaks;
+	}
+
+	void ArenaMode(bool value) {
+		arena_mode = value;
+	}
+
+	bool ArenaMode() {
+		return arena_mode;
+	}
+
+	Arena* CreateArena() {
+		if (!arena_mode)
+			return 0;
+		arena_count++;
+		return new Arena();
+	}
+
+	void ReleaseArena(Arena* arena) {
+		if (!arena)
+			return;
+		bool free_arena;
+		{
+			lock_guard<mutex> lock(arena->lock);
+			arena->retired = true;
+			free_arena = !arena->live;
+		}
+		if (free_arena)
+			FreeArena(arena);
+	}
+
+	ArenaScope::ArenaScope(Arena* arena) : previous(thread_arena) {
+		thread_arena = arena;
+	}
+
+	ArenaScope::~ArenaScope() {
+		thread_arena = previous;
+	}
+}
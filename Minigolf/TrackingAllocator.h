@@ -0,0 +1,85 @@
+#pragma once
+
+#include "foundation/PxAllocatorCallback.h"
+#include "foundation/PxSimpleTypes.h"
+#include <string>
+#include <vector>
+#include <ostream>
+
+namespace PhysicsEngine
+{
+	using namespace physx;
+
+	///Counters of the memory handed to PhysX
+	struct MemoryStats {
+		PxU64 allocations;
+		PxU64 deallocations;
+		PxU64 live_bytes;
+		PxU64 peak_bytes;
+		PxU64 arena_bytes;		// reserved by arenas that are not freed yet
+		PxU32 arenas;			// arenas that are not freed yet
+	};
+
+	///Counters of a single allocation name (PhysX type name)
+	struct AllocationStats {
+		std::string name;
+		PxU64 allocations;
+		PxU64 live_count;
+		PxU64 live_bytes;
+		PxU64 peak_bytes;
+	};
+
+	///Get the PhysX memory counters
+	MemoryStats GetMemoryStats();
+
+	///Restart the peaks (total and per name) at the current live sizes
+	void ResetMemoryPeak();
+
+	///Counters per allocation name, largest peak first
+	std::vector<AllocationStats> GetAllocationStats();
+
+	///Write the names with live allocations, returns false if there are none
+	bool ReportLeaks(std::ostream& out);
+
+	///Serve scene allocations from arenas
+	void ArenaMode(bool value);
+
+	///Get arena mode
+	bool ArenaMode();
+
+	///Size class free lists for the allocations of one scene
+	class Arena;
+
+	///A new arena for a scene, 0 when arena mode is off
+	Arena* CreateArena();
+
+	///Free the arena's memory in one go, call once its scene is released.
+	///Blocks still live in it (a bug in what was routed to it) keep it until they are returned.
+	void ReleaseArena(Arena* arena);
+
+	///Routes the allocations made on this thread to an arena while in scope,
+	///for allocations that live exactly as long as the arena's scene
+	class ArenaScope {
+		Arena* previous;
+
+	public:
+		ArenaScope(Arena* arena);
+		~ArenaScope();
+
+		ArenaScope(const ArenaScope&) = delete;
+		ArenaScope& operator=(const ArenaScope&) = delete;
+	};
+
+	///PhysX allocator keeping the counters above.
+	///
+	///Every block carries a 16 byte header with its size, name and arena, so
+	///freeing never needs a lookup. Blocks up to 16 KB made inside an ArenaScope
+	///come from that arena's size class free lists, carved out of 256 KB chunks,
+	///instead of the system heap.
+	class TrackingAllocator : public PxAllocatorCallback {
+	public:
+		void* allocate(size_t size, const char* typeName, const char* filename, int line);
+
+		void deallocate(void* ptr);
+	};
+}
@@ -1,6 +1,13 @@
 #include "VisualDebugger.h"
 #include <vector>
 #include "Camera.h"
+#include "CameraPath.h"
+#include "Profiler.h"
+#include <cstdio>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <functional>
 #include "Extras\Renderer.h"
 #include "Extras\HUD.h"
 
@@ -20,7 +27,8 @@ namespace VisualDebugger
 		EMPTY = 0,
 		HELP = 1,
 		PAUSE = 2,
-		SCORE = 3
+		SCORE = 3,
+		PROFILE = 4
 	};
 
 	
@@ -38,32 +46,70 @@ namespace VisualDebugger
 	void RenderScene();
 	void ToggleRenderMode();
 	void HUDInit();
+	void ProfileHUDUpdate();
+	void PickHUDUpdate(const PhysicsEngine::PickSnapshot& pick);
 	void UpdateCamera();
+	void Command(const std::function<void()>& command);
+	void Step();
 
 	///simulation objects
 	Camera* camera;
 	PhysicsEngine::MyScene* scene;
 	PxReal delta_time = 1.f/60.f;			// 1/60 if at uni, 1/150 if at home
-	PxReal gForceStrength = 3;
 	RenderMode render_mode = NORMAL;
 	const int MAX_KEYS = 256;
 	bool key_state[MAX_KEYS];
 	bool hud_show = true;
+	bool profile_show = false;
+	int profile_hud_frame = 0;
 	HUD hud;
+	//inspection panel of the picked actor, drawn over the other screens
+	HUD pick_hud;
 	float shotstrength = 0.0f;
 	float shotIncrementer = 0.4f; // used to change shot strength
 	bool freecam = false;
+	//half size of the box around the camera that gets debug geometry
+	const PxReal visualisation_extent = 40.0f;
 
 	int shotsTaken = 0;
 	bool clearToShoot = true;
+	//the game end screen is built once, when the game ends
+	bool game_end_shown = false;
+
+	///simulation thread, owns the scene while it runs
+	bool threaded = false;
+	std::thread simulation_thread;
+	std::atomic<bool> simulation_stop(false);
+	//step size, only touched by the simulation side
+	PxReal step_time = 1.f/60.f;
+	//scene state handed from the simulation side to rendering
+	PhysicsEngine::SnapshotBuffer snapshots;
+	//input for the scene, run before the next step
+	std::vector<std::function<void()>> commands;
+	std::vector<std::function<void()>> pending_commands;
+	std::mutex commands_mutex;
+	///Input rendering refreshes every frame, only the latest values matter to the simulation side
+	struct FrameInput {
+		PxVec3 camera_offset;			// follow camera from the ball, zero for the free camera
+		PxReal camera_radius;
+		PxBounds3 visualisation_box;	// around the camera, for the debug geometry of the next step
+		bool visualisation_changed;
+	};
+	FrameInput frame_input = { PxVec3(0.f), 0.f, PxBounds3::empty(), false };
+	std::mutex frame_input_mutex;
+
+	///camera recording
+	std::string camera_record_file;
+	CameraPath camera_record;
+	PxReal camera_record_time = 0.0f;
 
 
 
 	//Init the debugger
-	void Init(const char *window_name, int width, int height)
+	void Init(const char *window_name, int width, int height, const PhysicsEngine::PvdDesc& pvd)
 	{
 		///Init PhysX
-		PhysicsEngine::PxInit();
+		PhysicsEngine::PxInit(pvd);
 		scene = new PhysicsEngine::MyScene();
 		scene->Init();
 
@@ -73,7 +119,18 @@ namespace VisualDebugger
 		Renderer::InitWindow(window_name, width, height);
 		Renderer::Init();
 
-		camera = new Camera(PxVec3(10.0f, 5.0f, 15.0f), scene->GetSelectedActor()->getGlobalPose().p, 20.0f, scene->GetSelectedActor());
+		//the course does not move, bake it once
+		std::vector<PxActor*> actors = scene->GetAllActors();
+		if (actors.size())
+			Renderer::BuildStatic(&actors[0], (PxU32)actors.size());
+
+		camera = new Camera(PxVec3(10.0f, 5.0f, 15.0f), scene->GetSelectedActor()->getGlobalPose().p, 20.0f);
+		scene->Visualise(render_mode != NORMAL);
+
+		//something to draw before the first step
+		scene->Capture(snapshots.Write(), Renderer::RetainStatic());
+		snapshots.Write().delta_time = delta_time;
+		snapshots.Publish();
 		
 		//initialise HUD
 		HUDInit();
@@ -109,6 +166,7 @@ namespace VisualDebugger
 		hud.AddLine(HELP, "   F10 - pause");
 		hud.AddLine(HELP, "Gameplay");
 		hud.AddLine(HELP, "Right click to move camera");
+		hud.AddLine(HELP, "Left click to inspect, drag to pull");
 		hud.AddLine(HELP, "Hold space to increase strength");
 		hud.AddLine(HELP, "    Release to shoot");
 		hud.AddLine(HELP, "");
@@ -117,6 +175,8 @@ namespace VisualDebugger
 		hud.AddLine(HELP, "   F6 - Shadows on/off");
 		hud.AddLine(HELP, "   F7 - Render mode");
 		hud.AddLine(HELP, "   F8 - Free cam on/off");
+		hud.AddLine(HELP, "   F4 - Profiler on/off");
+		hud.AddLine(HELP, "   1-4 - Debug shapes/axes/joints/cloth");
 		hud.AddLine(HELP, "");
 		hud.AddLine(HELP, "Shot Increment Power: " + to_string(shotIncrementer));
 		hud.AddLine(HELP, "Shots taken: 0");
@@ -130,39 +190,232 @@ namespace VisualDebugger
 		hud.FontSize(0.015f);
 		//set font color for all screens
 		hud.Color(PxVec3(0.f,0.f,0.f));
+
+		//pick panel, lines filled in by PickHUDUpdate
+		for (int i = 0; i < 5; i++)
+			pick_hud.AddLine(0, "");
+		pick_hud.ActiveScreen(0);
+		pick_hud.FontSize(0.015f);
+		pick_hud.Color(PxVec3(0.f,0.f,0.f));
+		pick_hud.Position(PxVec2(0.6f, 0.98f));
+	}
+
+	///Geometry type and size of a shape
+	std::string ShapeDescription(const PxGeometryHolder& geometry)
+	{
+		char line[128];
+		switch (geometry.getType())
+		{
+		case PxGeometryType::eSPHERE:
+			snprintf(line, sizeof(line), "sphere, radius %.2f", geometry.sphere().radius);
+			break;
+		case PxGeometryType::eBOX:
+		{
+			const PxVec3 size = geometry.box().halfExtents * 2.f;
+			snprintf(line, sizeof(line), "box, %.2f x %.2f x %.2f", size.x, size.y, size.z);
+			break;
+		}
+		case PxGeometryType::eCAPSULE:
+			snprintf(line, sizeof(line), "capsule, radius %.2f, half height %.2f", geometry.capsule().radius, geometry.capsule().halfHeight);
+			break;
+		case PxGeometryType::ePLANE:
+			snprintf(line, sizeof(line), "plane");
+			break;
+		case PxGeometryType::eCONVEXMESH:
+			snprintf(line, sizeof(line), "convex mesh, %u vertices", geometry.convexMesh().convexMesh->getNbVertices());
+			break;
+		case PxGeometryType::eTRIANGLEMESH:
+			snprintf(line, sizeof(line), "triangle mesh, %u triangles", geometry.triangleMesh().triangleMesh->getNbTriangles());
+			break;
+		case PxGeometryType::eHEIGHTFIELD:
+			snprintf(line, sizeof(line), "heightfield, %u x %u samples", geometry.heightField().heightField->getNbRows(),
+				geometry.heightField().heightField->getNbColumns());
+			break;
+		default:
+			snprintf(line, sizeof(line), "unknown");
+			break;
+		}
+		return line;
+	}
+
+	//Show what the last pick hit, lines only change when the values do
+	void PickHUDUpdate(const PhysicsEngine::PickSnapshot& pick)
+	{
+		char line[128];
+		pick_hud.changeLine(0, "Picked: " + (pick.name.size() ? pick.name : std::string("(unnamed)")) + (pick.dragging ? ", dragging" : ""), 0);
+		pick_hud.changeLine(0, "Shape: " + ShapeDescription(pick.geometry), 1);
+		snprintf(line, sizeof(line), "Material: static %.2f, dynamic %.2f, restitution %.2f", pick.static_friction, pick.dynamic_friction,
+			pick.restitution);
+		pick_hud.changeLine(0, line, 2);
+		if (pick.dynamic)
+		{
+			snprintf(line, sizeof(line), "Velocity: %.2f %.2f %.2f (%.2f)", pick.velocity.x, pick.velocity.y, pick.velocity.z,
+				pick.velocity.magnitude());
+			pick_hud.changeLine(0, line, 3);
+			snprintf(line, sizeof(line), "Mass: %.2f, %s", pick.mass, pick.sleeping ? "sleeping" : "awake");
+			pick_hud.changeLine(0, line, 4);
+		}
+		else
+		{
+			pick_hud.changeLine(0, "Static", 3);
+			pick_hud.changeLine(0, "", 4);
+		}
+	}
+
+	//Refresh the profiler screen twice a second
+	void ProfileHUDUpdate()
+	{
+		if (profile_hud_frame++ % 30)
+			return;
+
+		hud.Clear(PROFILE);
+		hud.AddLine(PROFILE, "Profiler (F4)");
+		FrameTiming timing = Renderer::Timing();
+		char frame_line[128];
+		snprintf(frame_line, sizeof(frame_line), "Frame interval: p50 %.1f ms, p99 %.1f ms, CPU %.0f%%", timing.interval_p50_us / 1000.0,
+			timing.interval_p99_us / 1000.0, timing.cpu_percent);
+		hud.AddLine(PROFILE, frame_line);
+		if (!Profiler::Enabled())
+		{
+			hud.AddLine(PROFILE, "Not compiled in, build with MINIGOLF_PROFILE");
+		}
+		else
+		{
+			std::vector<Profiler::ZoneReport> zones = Profiler::Report();
+			for (unsigned int i = 0; i < zones.size(); i++)
+			{
+				char line[128];
+				snprintf(line, sizeof(line), "%s: p50 %.0f us, p99 %.0f us", zones[i].name.c_str(), zones[i].p50_us, zones[i].p99_us);
+				hud.AddLine(PROFILE, line);
+			}
+		}
+		hud.FontSize(0.015f, PROFILE);
+		hud.Color(PxVec3(0.f,0.f,0.f), PROFILE);
 	}
 
 	//Start the main loop
 	void Start()
 	{ 
+		if (threaded)
+		{
+			simulation_thread = std::thread([]()
+			{
+				//fixed rate, independent of the frame rate
+				FrameLimiter limiter(1.0 / step_time);
+				while (!simulation_stop)
+				{
+					limiter.Wait();
+					limiter.Frame();
+					Step();
+					//F9 and F11 change the step, keep one step per step_time
+					if (limiter.Target() != 1.0 / step_time)
+						limiter.Target(1.0 / step_time);
+				}
+			});
+		}
 		glutMainLoop(); 
 	}
 
+	void RecordCamera(const std::string& file)
+	{
+		camera_record_file = file;
+	}
+
+	void Threaded(bool value)
+	{
+		threaded = value;
+	}
+
+	///Queue a change to the scene, run on the simulation side before the next step
+	void Command(const std::function<void()>& command)
+	{
+		std::lock_guard<std::mutex> lock(commands_mutex);
+		commands.push_back(command);
+	}
+
+	///Apply the queued input, step the scene and publish its snapshot
+	void Step()
+	{
+		{
+			std::lock_guard<std::mutex> lock(commands_mutex);
+			pending_commands.swap(commands);
+		}
+		for (unsigned int i = 0; i < pending_commands.size(); i++)
+			pending_commands[i]();
+		pending_commands.clear();
+
+		FrameInput input;
+		{
+			std::lock_guard<std::mutex> lock(frame_input_mutex);
+			input = frame_input;
+			frame_input.visualisation_changed = false;
+		}
+		if (input.visualisation_changed)
+			scene->VisualisationBox(input.visualisation_box);
+
+		scene->Update(step_time);
+
+		PhysicsEngine::Snapshot& snapshot = snapshots.Write();
+		scene->Capture(snapshot, Renderer::RetainStatic());
+		snapshot.delta_time = step_time;
+		//the camera sweep runs here, between steps, so nothing changes the scene under it
+		const PxReal length = input.camera_offset.magnitude();
+		snapshot.camera_clear = (length > 1e-3f) ?
+			scene->SweepStatic(snapshot.ball.p, input.camera_offset / length, length, input.camera_radius) : PX_MAX_F32;
+		snapshots.Publish();
+	}
+
 	//Render the scene and perform a single simulation step
 	void RenderScene()
 	{
+		PROFILE_ZONE("Frame");
+
 		//handle pressed keys
-		KeyHold();
+		{
+			PROFILE_ZONE("KeyHold");
+			KeyHold();
+		}
+
+		//latest state of the scene, blended from the step before when the simulation runs apart
+		const PhysicsEngine::Snapshot& snapshot = snapshots.Acquire();
+		PxReal alpha = 1.f;
+		if (threaded && (snapshot.delta_time > 0.f))
+		{
+			const double since = std::chrono::duration<double>(std::chrono::steady_clock::now() - snapshot.time).count();
+			alpha = PxClamp((PxReal)(since / snapshot.delta_time), 0.f, 1.f);
+		}
 
 		//start rendering
-		Renderer::Start(camera->getEye(), camera->getDir());
+		{
+			PROFILE_ZONE("Renderer::Start");
+			Renderer::Start(camera->getEye(), camera->getDir());
+		}
 
 		if ((render_mode == DEBUG) || (render_mode == BOTH))
 		{
-			Renderer::Render(scene->Get()->getRenderBuffer());
+			PROFILE_ZONE("Render debug");
+			Renderer::Render(snapshot.debug);
+			//generated by the next step
+			std::lock_guard<std::mutex> lock(frame_input_mutex);
+			frame_input.visualisation_box = PxBounds3::centerExtents(camera->getEye(), PxVec3(visualisation_extent));
+			frame_input.visualisation_changed = true;
 		}
 
 		if ((render_mode == NORMAL) || (render_mode == BOTH))
 		{
-			std::vector<PxActor*> actors = scene->GetAllActors();
-			if (actors.size())
-				Renderer::Render(&actors[0], (PxU32)actors.size());
+			PROFILE_ZONE("Render actors");
+			Renderer::Render(snapshot, alpha);
 		}
 
 		//adjust the HUD state
-		if (hud_show)
+		if (profile_show)
 		{
-			if (scene->Pause())
+			ProfileHUDUpdate();
+			hud.ActiveScreen(PROFILE);
+		}
+		else if (hud_show)
+		{
+			if (snapshot.paused)
 				hud.ActiveScreen(PAUSE);
 			else
 				hud.ActiveScreen(HELP);
@@ -171,26 +424,63 @@ namespace VisualDebugger
 			hud.ActiveScreen(EMPTY);
 
 		//render HUD
-		hud.Render();
+		{
+			PROFILE_ZONE("HUD");
+			hud.Render();
+			if (snapshot.pick.hit && hud_show && !profile_show)
+			{
+				PickHUDUpdate(snapshot.pick);
+				pick_hud.Render();
+			}
+		}
 
 		//finish rendering
-		Renderer::Finish();
+		{
+			PROFILE_ZONE("Renderer::Finish");
+			Renderer::Finish();
+		}
 
 		//perform a single simulation step
-		scene->Update(delta_time);
+		if (!threaded)
+			Step();
 
 		if (!freecam) 
-			camera->UpdatePosition(delta_time);	
+		{
+			PROFILE_ZONE("Camera update");
+			camera->UpdatePosition(PhysicsEngine::Interpolate(snapshot.previous_ball, snapshot.ball, alpha).p, delta_time, snapshot.camera_clear);
+		}
+		//swept after the next step, nothing to sweep for the free camera
+		{
+			std::lock_guard<std::mutex> lock(frame_input_mutex);
+			frame_input.camera_offset = freecam ? PxVec3(0.f) : camera->Offset();
+			frame_input.camera_radius = camera->CollisionRadius();
+		}
 
-		PxVec3 vel = scene->GetSelectedActor()->getLinearVelocity();
+		if (camera_record_file.size())
+		{
+			camera_record.Add(camera_record_time, camera->getEye(), camera->getDir());
+			camera_record_time += delta_time;
+		}
+
+		//in on demand mode, keep drawing while anything moves
+		bool keys_held = false;
+		for (int i = 0; i < MAX_KEYS; i++)
+			keys_held = keys_held || key_state[i];
+		if (snapshot.awake || keys_held || profile_show || (!freecam && camera->Moving()))
+			Renderer::Redraw();
+
+		PxVec3 vel = snapshot.ball_velocity;
 
 		if (vel == PxVec3(0.0f, 0.0f, 0.0f)) {
 			clearToShoot = true;
 		}
 			
-		if (scene->hasGameEnded) {
-			hud.Clear();
-			hud.AddLine(HELP, "Game won! You took " + to_string(shotsTaken) + " shots!");
+		if (snapshot.game_ended) {
+			if (!game_end_shown) {
+				hud.Clear();
+				hud.AddLine(HELP, "Game won! You took " + to_string(shotsTaken) + " shots!");
+				game_end_shown = true;
+			}
 			clearToShoot = false;
 		}
 	}
@@ -201,11 +491,21 @@ namespace VisualDebugger
 		switch (toupper(key))
 		{
 		//implement your own
+		case '1':
+		case '2':
+		case '3':
+		case '4':
+		{
+			//debug visualisation categories on/off
+			const PxU32 category = 1 << (key - '1');
+			Command([category]() { scene->Visualisation(scene->Visualisation() ^ category); });
+			break;
+		}
 		case '-':
 		{
 			if(shotIncrementer > 0.0f) {
 				shotIncrementer -= 0.05f;
-				hud.changeLine(HELP, "Shot Increment Power: " + to_string(shotIncrementer), 13);
+				hud.changeLine(HELP, "Shot Increment Power: " + to_string(shotIncrementer), 16);
 			}
 			break;
 			}
@@ -213,7 +513,7 @@ namespace VisualDebugger
 		{
 			if (shotIncrementer < 1.0f) {
 				shotIncrementer += 0.05f;
-				hud.changeLine(HELP, "Shot Increment Power: " + to_string(shotIncrementer), 13);
+				hud.changeLine(HELP, "Shot Increment Power: " + to_string(shotIncrementer), 16);
 			}
 			break;
 		}
@@ -231,11 +531,13 @@ namespace VisualDebugger
 		case ' ':
 		{
 			if (clearToShoot) {
-				scene->lastPos = scene->GetSelectedActor()->getGlobalPose().p;
 				clearToShoot = false;
-				scene->GetSelectedActor()->addForce(PxVec3(dir.x, 0.0f, dir.z).getNormalized()*gForceStrength * shotstrength);
+				const PxReal strength = shotstrength;
+				Command([dir, strength]() { scene->Shoot(dir, strength); });
+				if (camera_record_file.size())
+					camera_record.AddShot(camera_record_time, dir, strength);
 				shotsTaken++;
-				hud.changeLine(HELP, "Shots taken: " + to_string(shotsTaken), 14);
+				hud.changeLine(HELP, "Shots taken: " + to_string(shotsTaken), 17);
 				shotstrength = 0.0f;
 			}
 			break;
@@ -288,7 +590,7 @@ namespace VisualDebugger
 		{
 			if (clearToShoot) {
 				shotstrength += shotIncrementer;
-				hud.changeLine(HELP, "Shot power: " + to_string(int(shotstrength)), 15);
+				hud.changeLine(HELP, "Shot power: " + to_string(int(shotstrength)), 18);
 			}
 			break;
 		}
@@ -300,10 +602,17 @@ namespace VisualDebugger
 	///handle special keys
 	void KeySpecial(int key, int x, int y)
 	{
+		Renderer::Redraw();
+
 		//simulation control
 		switch (key)
 		{
 			//display control
+		case GLUT_KEY_F4:
+			//profiler on/off
+			profile_show = !profile_show;
+			profile_hud_frame = 0;
+			break;
 		case GLUT_KEY_F5:
 			//hud on/off
 			hud_show = !hud_show;
@@ -319,16 +628,18 @@ namespace VisualDebugger
 			//simulation control
 		case GLUT_KEY_F10:
 			//toggle scene pause
-			scene->Pause(!scene->Pause());
+			Command([]() { scene->Pause(!scene->Pause()); });
 			break;
 		case GLUT_KEY_F8:
 			freecam = !freecam;
 			break;
 		case GLUT_KEY_F9:
 			delta_time = 1.0f/1500.0f;
+			Command([]() { step_time = 1.0f/1500.0f; });
 			break;
 		case GLUT_KEY_F11:
 			delta_time = 1.0/60.0f;
+			Command([]() { step_time = 1.0f/60.0f; });
 			break;
 		default:
 			break;
@@ -343,6 +654,7 @@ namespace VisualDebugger
 			return;
 
 		key_state[key] = true;
+		Renderer::Redraw();
 
 		//exit
 		if (key == 27)
@@ -355,6 +667,7 @@ namespace VisualDebugger
 	void KeyRelease(unsigned char key, int x, int y)
 	{
 		key_state[key] = false;
+		Renderer::Redraw();
 		UserKeyRelease(key);
 	}
 
@@ -374,12 +687,20 @@ namespace VisualDebugger
 	///mouse handling
 	int mMouseX = 0;
 	int mMouseY = 0;
+	//left button held, dragging the picked actor
+	bool picking = false;
 
 	void motionCallback(int x, int y) {
 		int dx = mMouseX - x;
 		int dy = mMouseY - y;
 
-		if (!freecam) {
+		if (picking) {
+			//pull the picked actor along the ray under the cursor
+			PxVec3 origin, dir;
+			Renderer::PickRay(x, y, origin, dir);
+			Command([origin, dir]() { scene->Drag(origin, dir); });
+		}
+		else if (!freecam) {
 			camera->UpdateCamera(dx, dy);
 		} 
 		else {
@@ -388,12 +709,28 @@ namespace VisualDebugger
 
 		mMouseX = x;
 		mMouseY = y;
+		Renderer::Redraw();
 	}
 
 	void mouseCallback(int button, int state, int x, int y)
 	{		
 		mMouseX = x;
 		mMouseY = y;
+
+		//left click picks through the view of the last frame, a miss clears the pick
+		if (button == GLUT_LEFT_BUTTON)
+		{
+			picking = (state == GLUT_DOWN);
+			if (picking)
+			{
+				PxVec3 origin, dir;
+				Renderer::PickRay(x, y, origin, dir);
+				Command([origin, dir]() { scene->Pick(origin, dir, true); });
+			}
+			else
+				Command([]() { scene->Drop(); });
+		}
+		Renderer::Redraw();
 	}
 
 	void ToggleRenderMode()
@@ -404,11 +741,35 @@ namespace VisualDebugger
 			render_mode = BOTH;
 		else if (render_mode == BOTH)
 			render_mode = NORMAL;
+
+		//nothing to generate when the debug buffer is not drawn
+		const bool visualise = (render_mode != NORMAL);
+		Command([visualise]() { scene->Visualise(visualise); });
 	}
 
 	///exit callback
 	void exitCallback(void)
 	{
+		if (camera_record_file.size() && !camera_record.Empty())
+		{
+			try
+			{
+				camera_record.Save(camera_record_file);
+			}
+			catch (Exception* exc)
+			{
+				std::cerr << exc->what() << std::endl;
+				delete exc;
+			}
+		}
+
+		if (simulation_thread.joinable())
+		{
+			simulation_stop = true;
+			simulation_thread.join();
+		}
+
+		Renderer::ReleaseStatic();
 		delete camera;
 		delete scene;
 		PhysicsEngine::PxRelease();
@@ -8,9 +8,15 @@ namespace VisualDebugger
 	extern PxVec3 lastPos;
 
 	///Init visualisation
-	void Init(const char *window_name, int width=512, int height=512);
+	void Init(const char *window_name, int width=512, int height=512, const PhysicsEngine::PvdDesc& pvd=PhysicsEngine::PvdDesc());
 
 	///Start visualisation
 	void Start();
+
+	///Record the camera and the shots to a file on exit, for the render benchmark and capture
+	void RecordCamera(const std::string& file);
+
+	///Run the simulation on its own thread at a fixed rate (off by default), call before Start
+	void Threaded(bool value);
 }
 